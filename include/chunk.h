@@ -70,6 +70,7 @@ typedef enum {
   // Arithmetic (quickened)
   OP_ADD_NUM,
   OP_ADD_STR,
+  OP_CONCAT_N,            // Concatenate the top N strings (operand: count byte)
 
   // Comparison
   OP_EQUAL,
@@ -144,6 +145,17 @@ typedef enum {
   // Fiber operations
   OP_YIELD,               // Yield from fiber with N values (operand: count byte)
 
+  // Lazy for-in iteration
+  OP_ITER_INIT,           // Replace iterable TOS with its iteration limit
+  OP_ITER_NEXT,           // Advance cursor, loop back while elements remain
+  OP_ITER_VALUE,          // push(element or key at cursor)
+  OP_FOREACH_PREP,        // ITER_NEXT + ITER_VALUE on loop entry, exits when empty
+  OP_FOREACH_NEXT,        // ITER_NEXT + ITER_VALUE, loop back with element pushed
+
+  // Modules
+  OP_IMPORT,              // push cached module value and skip CALL + IMPORT_STORE, or push closure
+  OP_IMPORT_STORE,        // cache TOS as the module's value (embedded objs only)
+
   OP_RETURN = 0xff,
 } OpCode;
 
@@ -153,6 +165,7 @@ typedef struct {
   uint8_t* code;
   uint32_t* lines;
   ValueArray constants;
+  bool borrowed;          // code points into a mapped lxobj, not owned
 } Chunk;
 
 void initChunk(Chunk* chunk);
@@ -5,8 +5,10 @@
 #include <stddef.h>
 #include <stdint.h>
 
-extern int LX_ARGC;
-extern const char** LX_ARGV;
+// Each isolate (see isolate.h) runs its own VM on its own thread, so all
+// interpreter state is thread-local.
+extern _Thread_local int LX_ARGC;
+extern _Thread_local const char** LX_ARGV;
 
 #ifdef DEBUG
 // #define DEBUG_TRACE_EXECUTION
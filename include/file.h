@@ -0,0 +1,34 @@
+#ifndef clox_file_h
+#define clox_file_h
+
+#include "value.h"
+
+// Buffered file handles (Lx.fs.open). A handle is the file's fd; each open
+// handle owns one buffer, so readLine/readChunk/write cost one syscall per
+// buffer rather than per call and a file of any size streams through in
+// constant memory. Handles are opened for reading ("r") or writing ("w",
+// "a"), never both.
+//
+// Handles are per VM, i.e. per isolate. freeVM() flushes and closes
+// whatever is still open.
+
+#define FILE_BUFFER_SIZE (128 * 1024)
+
+// Returns the handle, or -1 with *error set.
+int fileOpen(const char* path, const char* mode, const char** error);
+
+// The next line without its trailing "\n" (or "\r\n"), nil at end of file.
+bool fileReadLine(int handle, Value* result, const char** error);
+// Up to `max` bytes as a string, nil at end of file.
+bool fileReadChunk(int handle, size_t max, Value* result, const char** error);
+
+bool fileWrite(int handle, const uint8_t* bytes, size_t length, const char** error);
+bool fileFlush(int handle, const char** error);
+// Flushes pending output, then closes the fd.
+bool fileClose(int handle, const char** error);
+
+// Before fork(), so pending output isn't written by both processes.
+void flushFiles(void);
+void closeFiles(void);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef clox_isolate_h
+#define clox_isolate_h
+
+#include "common.h"
+#include "value.h"
+
+// Isolates are independent interpreters running on their own threads in one
+// process. Every piece of VM state (the `vm` struct, argv, loader tables) is
+// thread-local, so isolates share nothing but the process: no objects cross
+// between them, messages are deep-copied on send and rebuilt on receive.
+//
+// The main thread is isolate 0. A spawned isolate runs `lx run <path> args...`
+// with the embedded entry program and exits with the same codes `lx` does.
+
+// Call once from main(), after LX_ARGC/LX_ARGV are set.
+void initIsolates(const uint8_t* entryObj);
+
+// Returns the new isolate's id, or -1 when the thread could not be started.
+int isolateSpawn(const char* path, const char** args, int argCount);
+
+int isolateSelf(void);
+// -1 on the main isolate
+int isolateParent(void);
+
+// Copies `message` into the mailbox of isolate `id`. On failure returns false
+// with *error set to a static message.
+bool isolateSend(int id, Value message, const char** error);
+
+// Blocks until a message arrives and pushes it onto the VM stack. A negative
+// timeout waits forever; returns false when the timeout expires first.
+bool isolateReceive(double timeoutSeconds);
+
+// Waits for isolate `id` to finish and forgets it. Returns false when `id` is
+// unknown, already joined or the caller itself.
+bool isolateJoin(int id, int* exitCode);
+
+// Lx.exit() inside a spawned isolate ends only that isolate's thread.
+bool isolateIsSpawned(void);
+void isolateExit(int exitCode) __attribute__((noreturn));
+
+#endif
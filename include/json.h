@@ -0,0 +1,23 @@
+#ifndef clox_json_h
+#define clox_json_h
+
+#include "value.h"
+
+// JSON codec behind Lx.json. Parsing builds lx maps and arrays directly;
+// stringify writes into one growing buffer. String bodies are scanned 16
+// bytes at a time for the characters that need attention (quote, backslash,
+// control characters), so long strings cost a few vector compares per
+// chunk rather than a branch per byte.
+
+#define JSON_MAX_DEPTH 512
+
+// Numbers come back as fixnums when integral, like tonumber(). Returns
+// false with *error set on malformed input.
+bool jsonParse(const uint8_t* text, size_t length, Value* result, const char** error);
+
+// Encodes nil, booleans, numbers, strings, arrays and maps. `indent` > 0
+// pretty-prints with that many spaces per level. NaN and infinities encode
+// as null.
+bool jsonStringify(Value value, int indent, Value* result, const char** error);
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef clox_loop_h
+#define clox_loop_h
+
+#include "object.h"
+
+// Event loop for fibers (Lx.loop). Fibers started with Lx.loop.spawn are
+// tasks; while Lx.loop.run() drives them, an I/O native that would block
+// parks the running task on its fd or timer and yields, and the loop
+// resumes it with the operation's result once epoll reports it ready.
+// Outside a task (or inside pcall, which can't yield) the same operations
+// simply block.
+//
+// State is per VM, i.e. per isolate.
+
+typedef enum {
+  LOOP_OP_READ,
+  LOOP_OP_WRITE,
+  LOOP_OP_ACCEPT,
+  LOOP_OP_CONNECT,
+  LOOP_OP_SLEEP,
+  LOOP_OP_READ_ALL,
+  LOOP_OP_WAIT,
+} LoopOpKind;
+
+typedef struct {
+  LoopOpKind kind;
+  int fd;
+  size_t readMax;       // READ: at most this many bytes
+  Value data;           // WRITE: string or Bytes; READ_ALL: Bytes so far
+  size_t written;       // WRITE: progress so far
+  double deadline;      // SLEEP: loopNow() based
+  int pid;              // WAIT: child pid, -1 for any child
+} LoopOp;
+
+typedef enum {
+  LOOP_DONE,
+  LOOP_AGAIN,
+  LOOP_FAILED,
+} LoopStatus;
+
+typedef struct LoopTask LoopTask;
+
+double loopNow(void);
+
+// Attempts `op` without blocking. LOOP_DONE stores the op's value in
+// *result (READ: string, nil at end of file; WRITE: bytes written;
+// ACCEPT/CONNECT: the socket fd; SLEEP: nil; READ_ALL: the Bytes once the
+// fd hits end of file; WAIT: the exit code, or .{ pid, code } when waiting
+// for any child, nil when there is none). LOOP_FAILED sets *error.
+LoopStatus loopTry(LoopOp* op, Value* result, const char** error);
+// Same, but waits (blocking the whole VM) until the op is no longer AGAIN.
+LoopStatus loopBlock(LoopOp* op, Value* result, const char** error);
+
+// True when the running fiber is a task that may suspend.
+bool loopCanSuspend(void);
+// Parks the current task on `op`; the native then yields the fiber.
+bool loopSuspend(LoopOp* op, const char** error);
+
+// Scheduler interface for Lx.loop.run()
+bool loopIsRunning(void);
+void loopSetRunning(bool running);
+void loopSpawn(ObjFiber* fiber);
+bool loopHasTasks(void);
+// Next runnable task (made current) and the value to resume it with.
+LoopTask* loopNextReady(Value* resumeValue);
+ObjFiber* loopTaskFiber(LoopTask* task);
+// After resuming `task`: requeue it (plain Fiber.yield) or keep it parked.
+void loopTaskSuspended(LoopTask* task);
+void loopTaskFinished(LoopTask* task);
+// Waits for fds and timers, queueing tasks whose op completed. False with
+// *error when a parked op failed.
+bool loopPoll(const char** error);
+// Drops every task (after a failure).
+void loopReset(void);
+
+void markEventLoop(void);
+void freeEventLoop(void);
+
+#endif
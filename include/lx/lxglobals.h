@@ -1,58 +1,37 @@
 #include <stdint.h>
 const uint8_t lxglobals_bytecode[] = {
-  0x4c, 0x58, 0x02, 0x03, 0x90, 0x02, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x13, 0xe0, 0x83, 0x31, 0x0e, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x78, 0x9c, 0x75, 0x53,
-  0x6d, 0x6f, 0x13, 0x31, 0x0c, 0xb6, 0xe3, 0x24, 0x4d, 0x2f, 0xd7, 0x6b,
-  0x9b, 0xba, 0x1b, 0xe3, 0x45, 0xa2, 0x8c, 0xb7, 0x22, 0xa8, 0x28, 0xac,
-  0x9b, 0x10, 0x1f, 0xca, 0xe8, 0x17, 0x84, 0x84, 0x04, 0x5f, 0x36, 0x69,
-  0xe2, 0x4b, 0x37, 0x36, 0x86, 0x74, 0xd0, 0xa9, 0x1d, 0x12, 0xbf, 0x88,
-  0xbf, 0x59, 0x9c, 0xdc, 0x0a, 0xda, 0x26, 0x4e, 0xad, 0xcf, 0x79, 0x62,
-  0x3f, 0xb6, 0x9f, 0xe4, 0x10, 0x32, 0xf8, 0x5a, 0xce, 0x0e, 0xa7, 0xe5,
-  0x62, 0x50, 0xfe, 0x02, 0x84, 0xf8, 0xab, 0x9e, 0x77, 0xf2, 0x6f, 0xa6,
-  0xc7, 0x41, 0x17, 0x83, 0xc3, 0xae, 0x0a, 0x4e, 0x75, 0x29, 0x38, 0xea,
-  0xea, 0xe0, 0x74, 0xd7, 0x04, 0x67, 0xba, 0x36, 0x6c, 0xe7, 0x96, 0x71,
-  0x9c, 0xd7, 0x58, 0x8d, 0x73, 0xc7, 0x34, 0xce, 0xeb, 0xac, 0xc7, 0x79,
-  0xc6, 0x66, 0x9c, 0x7b, 0xb6, 0xe3, 0xa5, 0xb7, 0xb8, 0x3c, 0x14, 0xae,
-  0x1c, 0x08, 0x23, 0x39, 0xa1, 0x4a, 0x96, 0x92, 0xd5, 0xc9, 0x9a, 0x64,
-  0x6d, 0xb4, 0x14, 0xfd, 0x93, 0x6f, 0xf3, 0xc5, 0x39, 0x51, 0xdc, 0x2c,
-  0xa7, 0x2b, 0xef, 0x78, 0x7a, 0x74, 0x5a, 0x79, 0x27, 0xb3, 0xf2, 0x0b,
-  0x51, 0x24, 0xf8, 0x3e, 0x3d, 0xab, 0xa0, 0xc5, 0x6c, 0x7e, 0xbe, 0x9b,
-  0xfa, 0xf6, 0x08, 0x46, 0x81, 0xd1, 0x60, 0x1c, 0x98, 0x06, 0x98, 0x36,
-  0xe0, 0x10, 0xf4, 0x8b, 0x64, 0x5f, 0x26, 0xbb, 0x95, 0xec, 0x28, 0xd9,
-  0xed, 0x64, 0x77, 0x40, 0x0d, 0xa5, 0x01, 0xc0, 0x1d, 0x18, 0x08, 0x45,
-  0xea, 0x53, 0x68, 0xaa, 0x3e, 0x22, 0xfd, 0x01, 0xc2, 0xd2, 0x27, 0x50,
-  0xad, 0xf4, 0x31, 0xc9, 0x6a, 0x84, 0x57, 0x11, 0x57, 0x69, 0x53, 0xa7,
-  0x76, 0x5b, 0xe2, 0xaf, 0x01, 0xa3, 0xc1, 0x02, 0x1f, 0x4d, 0x50, 0x79,
-  0xc4, 0x8b, 0xe4, 0xaa, 0xe9, 0xf2, 0xf8, 0x47, 0x95, 0xdc, 0x52, 0xb0,
-  0x17, 0xf1, 0x08, 0x2a, 0x49, 0x8e, 0x13, 0x3e, 0x11, 0x9f, 0x51, 0xd2,
-  0xc9, 0x20, 0xeb, 0x02, 0xf6, 0xac, 0xc4, 0x86, 0x09, 0x59, 0xae, 0x59,
-  0x85, 0x41, 0xa6, 0xdb, 0x4f, 0x48, 0x68, 0x7a, 0xba, 0x46, 0xeb, 0x12,
-  0x6d, 0xdf, 0x80, 0xe8, 0x7a, 0x14, 0xb7, 0x92, 0xbc, 0xc2, 0x1c, 0x15,
-  0xdb, 0x5a, 0x31, 0x6b, 0x61, 0x36, 0xc2, 0x5c, 0x13, 0xc1, 0x6f, 0x4d,
-  0x74, 0x8d, 0xe5, 0xec, 0xd8, 0x71, 0xdd, 0x12, 0x71, 0xf6, 0x56, 0x79,
-  0x82, 0xfd, 0xb4, 0x15, 0xc4, 0x63, 0x75, 0xb5, 0x86, 0x4f, 0x35, 0x86,
-  0x75, 0x50, 0x19, 0xa0, 0x83, 0xcf, 0x71, 0xd7, 0xa4, 0x01, 0x28, 0x1e,
-  0xc7, 0x50, 0xdc, 0xd1, 0xb5, 0x32, 0xeb, 0xb1, 0x8c, 0x93, 0x01, 0x98,
-  0xb8, 0xfe, 0x26, 0x78, 0x55, 0x95, 0x58, 0x0f, 0x4c, 0x5e, 0xff, 0x67,
-  0x8c, 0xe7, 0x05, 0x60, 0x03, 0x7e, 0xc7, 0x3b, 0x69, 0x2f, 0x04, 0x8a,
-  0xa7, 0xbc, 0x81, 0x2b, 0x75, 0x99, 0x3e, 0x69, 0x14, 0xf1, 0xe4, 0xfe,
-  0x2d, 0x23, 0x88, 0xaf, 0xd5, 0x47, 0xad, 0x62, 0xd5, 0x11, 0xd7, 0x46,
-  0x5c, 0x97, 0xda, 0x5e, 0x32, 0x5b, 0x6b, 0xc4, 0x6e, 0x82, 0xde, 0xa8,
-  0xb0, 0x9f, 0xd6, 0x81, 0x2d, 0x7b, 0xd6, 0x03, 0x92, 0x14, 0xb0, 0xbb,
-  0x5e, 0x54, 0x6a, 0x4b, 0x4c, 0x56, 0xc5, 0x68, 0xe8, 0x04, 0x51, 0x43,
-  0xd5, 0x94, 0x04, 0x65, 0xe9, 0xdd, 0x18, 0x71, 0xb3, 0x80, 0x22, 0x96,
-  0xcd, 0x85, 0xbe, 0xcd, 0x9d, 0x81, 0x9c, 0x29, 0x77, 0x3a, 0x04, 0xcd,
-  0x20, 0x60, 0x21, 0x60, 0x60, 0x8e, 0xa0, 0x8f, 0x0d, 0x0d, 0x27, 0x79,
-  0x7b, 0x52, 0x04, 0xab, 0x14, 0x4b, 0x48, 0xac, 0xdf, 0x12, 0x44, 0xb8,
-  0x77, 0xdb, 0x72, 0xb5, 0x1a, 0x69, 0x5d, 0x84, 0xb8, 0x0e, 0x92, 0x20,
-  0x73, 0x1d, 0x5c, 0x66, 0xbe, 0x9a, 0xa3, 0xa1, 0xf7, 0xb7, 0xca, 0xa5,
-  0x80, 0x15, 0x89, 0x04, 0x70, 0xcb, 0xb7, 0x70, 0x19, 0x6f, 0x8f, 0xfe,
-  0x27, 0x64, 0xf5, 0x6d, 0x7c, 0x98, 0x9e, 0x9f, 0x5e, 0x7c, 0x57, 0xe5,
-  0x6c, 0x36, 0xaf, 0xc0, 0xb3, 0x9f, 0x8b, 0xd3, 0xf7, 0x49, 0x67, 0xd7,
-  0x81, 0x06, 0x83, 0x5f, 0x03, 0x5a, 0x07, 0xba, 0x01, 0x1b, 0x1b, 0xd0,
-  0xbb, 0x09, 0xee, 0x36, 0xb8, 0x3b, 0x40, 0x77, 0x41, 0xf5, 0x40, 0xdd,
-  0x83, 0xfe, 0x26, 0x14, 0xf7, 0x21, 0x7b, 0x00, 0xf4, 0x10, 0x48, 0x9c,
-  0xc7, 0x40, 0x7d, 0xb0, 0x9b, 0xd0, 0x7b, 0x0a, 0xbd, 0x67, 0xa0, 0x06,
-  0xa0, 0xdb, 0xf0, 0x07, 0xb3, 0x00, 0x58, 0xc2
+  0x4c, 0x58, 0x02, 0x03, 0x8e, 0x01, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x37, 0xcd, 0xe9, 0x35, 0x0e, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x78, 0x9c, 0x75, 0x51,
+  0xb1, 0x6e, 0x14, 0x41, 0x0c, 0x7d, 0xb6, 0x67, 0xf6, 0xe6, 0x76, 0x36,
+  0x77, 0xc9, 0xe0, 0xbd, 0x86, 0x0a, 0x1a, 0xa0, 0x39, 0x89, 0x86, 0x84,
+  0x02, 0x69, 0x09, 0xd4, 0x14, 0x88, 0x0e, 0x29, 0x62, 0x0f, 0x12, 0x40,
+  0x5a, 0x08, 0x22, 0x14, 0xfc, 0x5d, 0x7e, 0x84, 0x8f, 0xe0, 0x0f, 0x8e,
+  0xb1, 0x37, 0x29, 0x40, 0x62, 0xa4, 0x7d, 0xe3, 0x79, 0x96, 0x9f, 0x9f,
+  0xbd, 0x84, 0x16, 0x1f, 0xa7, 0xcb, 0xdd, 0x38, 0x5d, 0x6d, 0xa7, 0x9f,
+  0xbf, 0x00, 0x10, 0x6e, 0xce, 0xb3, 0xfa, 0xad, 0xed, 0x24, 0xf4, 0x54,
+  0x12, 0xf5, 0x5c, 0x12, 0xf7, 0x52, 0x92, 0xf4, 0xa1, 0xa4, 0xd0, 0xc7,
+  0x72, 0xdc, 0x45, 0xa5, 0xa1, 0x6b, 0x94, 0x87, 0x6e, 0xa1, 0x32, 0x74,
+  0x49, 0xc3, 0xd0, 0x2d, 0x35, 0x0e, 0xfb, 0x1c, 0x69, 0xff, 0xba, 0x0a,
+  0xb4, 0x10, 0x32, 0x45, 0x21, 0x76, 0x14, 0xc7, 0xe0, 0x18, 0x0d, 0xc5,
+  0xf0, 0xe2, 0xf3, 0xf7, 0xab, 0x1f, 0x22, 0x46, 0x4f, 0xe3, 0x6d, 0x74,
+  0x3e, 0xbe, 0xff, 0x34, 0x47, 0x17, 0x97, 0xd3, 0x07, 0x11, 0x2b, 0xfd,
+  0x32, 0x7e, 0x3b, 0x71, 0x73, 0x2d, 0x21, 0x32, 0x62, 0x40, 0x4c, 0x88,
+  0x07, 0xa0, 0x23, 0x84, 0xe2, 0x78, 0xc7, 0x51, 0x1d, 0x7b, 0xc7, 0x0d,
+  0xf8, 0xa8, 0x76, 0x03, 0x6d, 0xb0, 0xb5, 0xf9, 0xc8, 0x87, 0x8c, 0x73,
+  0x53, 0x93, 0x7f, 0x4b, 0xd8, 0x67, 0x27, 0xf9, 0x76, 0xf6, 0xe8, 0x18,
+  0x08, 0x4f, 0x8d, 0x67, 0x4f, 0x06, 0xf7, 0x76, 0x58, 0xe3, 0x0d, 0x94,
+  0x22, 0xad, 0xe8, 0xc1, 0x4b, 0xe2, 0x4c, 0x74, 0x53, 0x3c, 0x3b, 0x9c,
+  0xce, 0xbf, 0xce, 0xc5, 0x87, 0x8c, 0x57, 0xc6, 0x1b, 0xc9, 0xb5, 0xd8,
+  0xc6, 0xb9, 0x5f, 0x63, 0x25, 0x95, 0xb3, 0x0e, 0xa3, 0x54, 0xf3, 0x6b,
+  0x6d, 0x1a, 0xa6, 0x92, 0x09, 0x3b, 0x7f, 0x96, 0x75, 0x66, 0xfa, 0xdb,
+  0xcb, 0xef, 0xeb, 0xe4, 0xf7, 0xbd, 0x88, 0xba, 0xb6, 0x77, 0x96, 0xf2,
+  0xed, 0x55, 0x45, 0x5b, 0xcb, 0xe3, 0x59, 0x31, 0x9c, 0xad, 0x50, 0x35,
+  0xc3, 0x22, 0xe2, 0xae, 0xd6, 0xff, 0xa1, 0x49, 0x97, 0x8d, 0x88, 0xb6,
+  0x2f, 0x38, 0x0b, 0x4e, 0x1b, 0xda, 0x79, 0xaa, 0xd4, 0x87, 0xf2, 0xbf,
+  0x0d, 0xb2, 0xdf, 0xdb, 0x25, 0xb8, 0x05, 0x25, 0xbc, 0xb1, 0x6c, 0x74,
+  0xd7, 0x62, 0x0b, 0x7f, 0x54, 0xc3, 0x27, 0xde, 0xc3, 0x3a, 0x34, 0x11,
+  0xaa, 0x8b, 0xea, 0x5a, 0x45, 0xd3, 0xf3, 0x92, 0x19, 0x3b, 0xe7, 0x8a,
+  0x4a, 0x96, 0xff, 0x78, 0x7f, 0xb8, 0x02, 0x1d, 0xe0, 0x0f, 0xb9, 0x48,
+  0x35, 0x39
 };
@@ -0,0 +1 @@
+const char* LX_VERSION = "2026.10.18-10a6ff6 (Linux)";
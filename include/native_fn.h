@@ -3,15 +3,23 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <limits.h>
 #include <math.h>
+#include <netdb.h>
+#include <netinet/in.h>
 #include <poll.h>
+#include <spawn.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
 #include <zlib.h>
@@ -22,8 +30,16 @@
 
 #include "lx/lxversion.h"
 
+#include "file.h"
+#include "isolate.h"
+#include "json.h"
+#include "loop.h"
 #include "memory.h"
 #include "object.h"
+#include "print.h"
+#include "regex.h"
+#include "scan.h"
+#include "text.h"
 #include "vm.h"
 
 #define RFC3339 "%Y-%m-%dT%H:%M:%S%z"
@@ -49,6 +65,40 @@ static bool fiberYieldNative(int argCount, Value *args);
 static bool fiberStatusNative(int argCount, Value *args);
 static bool fiberCurrentNative(int argCount, Value *args);
 
+// Event loop natives (implemented in `src/vm.c`; they resume task fibers)
+static bool loopSpawnNative(int argCount, Value *args);
+static bool loopRunNative(int argCount, Value *args);
+
+// Sorting natives (implemented in `src/vm.c`; comparators re-enter the VM)
+static bool sortNative(int argCount, Value *args);
+static bool stableSortNative(int argCount, Value *args);
+static bool sortByNative(int argCount, Value *args);
+
+// Lx.fs.lines (implemented in `src/vm.c`; the callback re-enters the VM)
+static bool fsLinesNative(int argCount, Value *args);
+
+// Lx.re.replace (implemented in `src/vm.c`; a replacement function re-enters
+// the VM)
+static bool reReplaceNative(int argCount, Value *args);
+
+// Raw byte view of a string, Bytes or Uint8Array value. The pointer is only
+// valid until the next allocation (Bytes storage may move when it grows).
+static bool byteView(Value value, const uint8_t **bytes, size_t *length) {
+  if (IS_STRING(value)) {
+    *bytes = (const uint8_t *)AS_STRING(value)->chars;
+    *length = (size_t)AS_STRING(value)->length;
+    return true;
+  }
+  if (IS_TYPED_ARRAY(value)) {
+    ObjTypedArray *array = AS_TYPED_ARRAY(value);
+    if (array->kind != TYPED_BYTES && array->kind != TYPED_UINT8) return false;
+    *bytes = array->as.u8;
+    *length = (size_t)array->count;
+    return true;
+  }
+  return false;
+}
+
 static bool timeNative(int argCount, Value *args) {
   struct timeval tv;
   gettimeofday(&tv, NULL);
@@ -65,6 +115,31 @@ static bool nanotimeNative(int argCount, Value *args) {
   return true;
 }
 
+// Runs an event loop op (see loop.h) the way a blocking native would. Inside
+// a loop task that could block, the task is parked and the fiber yields;
+// the loop resumes it with the op's value as this call's result.
+static bool loopOpNative(LoopOp *op, Value *args) {
+  Value result = NIL_VAL;
+  const char *error = NULL;
+  LoopStatus status = loopTry(op, &result, &error);
+  if (status == LOOP_AGAIN && loopCanSuspend()) {
+    if (!loopSuspend(op, &error)) {
+      args[-1] = CSTRING_VAL(error);
+      return false;
+    }
+    vm.shouldYield = true;
+    args[-1] = NIL_VAL;
+    return true;
+  }
+  if (status == LOOP_AGAIN) status = loopBlock(op, &result, &error);
+  if (status == LOOP_FAILED) {
+    args[-1] = CSTRING_VAL(error);
+    return false;
+  }
+  args[-1] = result;
+  return true;
+}
+
 static bool sleepNative(int argCount, Value *args) {
   if (argCount != 1) {
     args[-1] = CSTRING_VAL("Error: Lx.sleep takes 1 arg (seconds: number).");
@@ -81,15 +156,10 @@ static bool sleepNative(int argCount, Value *args) {
     return false;
   }
 
-  // Use nanosleep for sub-second precision
-  struct timespec req;
-  req.tv_sec = (time_t)seconds;
-  req.tv_nsec = (long)((seconds - req.tv_sec) * 1000000000.0);
-
-  nanosleep(&req, NULL);
-
-  args[-1] = NIL_VAL;
-  return true;
+  // Loop tasks wait on a timer; anything else sleeps (nanosleep precision)
+  LoopOp op = { .kind = LOOP_OP_SLEEP, .fd = -1, .data = NIL_VAL,
+                .deadline = loopNow() + seconds };
+  return loopOpNative(&op, args);
 }
 
 static bool strftimeNative(int argCount, Value *args) {
@@ -143,11 +213,13 @@ static bool strptimeNative(int argCount, Value *args) {
   return true;
 }
 
+// print/println write into stdout's buffer (see initStdout); nothing is
+// flushed here.
 static bool printNative(int argCount, Value *args) {
+  Writer out = writerForFile(stdout);
   for (int i = 0; i < argCount; i++) {
-    if (i > 0)
-      printf(" ");
-    printValue(stdout, args[i]);
+    if (i > 0) writerWrite(&out, " ", 1);
+    writeValue(&out, args[i]);
   }
   args[-1] = NIL_VAL;
   return true;
@@ -155,8 +227,7 @@ static bool printNative(int argCount, Value *args) {
 
 static bool printlnNative(int argCount, Value *args) {
   printNative(argCount, args);
-  printf("\n");
-  fflush(stdout);
+  putc('\n', stdout);
   return true;
 }
 
@@ -200,13 +271,27 @@ static bool stderrIsTtyNative(int argCount, Value *args) {
 
 static bool putcNative(int argCount, Value *args) {
   for (int i = 0; i < argCount; i++) {
-    printf("%c", (int)AS_NUMBER(args[i]));
+    putc((int)AS_NUMBER(args[i]), stdout);
+  }
+  args[-1] = NIL_VAL;
+  return true;
+}
+
+static bool stdoutWriteNative(int argCount, Value *args) {
+  const uint8_t *bytes;
+  size_t length;
+  if (argCount < 1 || !byteView(args[0], &bytes, &length)) {
+    args[-1] = CSTRING_VAL("Error: Lx.stdout.write takes a string or Bytes.");
+    return false;
   }
+  fwrite(bytes, 1, length, stdout);
   args[-1] = NIL_VAL;
   return true;
 }
 
 static bool groanNative(int argCount, Value *args) {
+  // Keep stdout and stderr in order when both go to the same place
+  fflush(stdout);
   for (int i = 0; i < argCount; i++) {
     if (i > 0)
       fprintf(stderr, " ");
@@ -490,6 +575,10 @@ static bool lenNative(int argCount, Value *args) {
     args[-1] = FIXNUM_VAL(count);
     return true;
   }
+  if (IS_TYPED_ARRAY(arg)) {
+    args[-1] = FIXNUM_VAL(AS_TYPED_ARRAY(arg)->count);
+    return true;
+  }
 
   args[-1] = CSTRING_VAL("Error: Arg must be string or array.");
   return false;
@@ -517,6 +606,8 @@ static bool typeNative(int argCount, Value *args) {
     args[-1] = CSTRING_VAL("map");
   } else if (IS_ARRAY(arg)) {
     args[-1] = CSTRING_VAL("array");
+  } else if (IS_TYPED_ARRAY(arg)) {
+    args[-1] = CSTRING_VAL(typedArrayKindName(AS_TYPED_ARRAY(arg)->kind));
   } else if (IS_FIBER(arg)) {
     args[-1] = CSTRING_VAL("fiber");
   } else {
@@ -796,6 +887,12 @@ static uint8_t utf8CharLength(uint8_t val) {
   return 4;
 }
 
+// True for whole numbers in [0, INT_MAX]; NaN and infinities fail every
+// comparison, so the cast to int is only reached for values that fit.
+static bool isIntIndex(double raw) {
+  return raw >= 0 && raw <= INT_MAX && raw == floor(raw);
+}
+
 static bool rangeNative(int argCount, Value *args) {
   if (argCount < 1) {
     args[-1] = CSTRING_VAL("Error: range takes 1 args.");
@@ -806,11 +903,11 @@ static bool rangeNative(int argCount, Value *args) {
     args[-1] = arg;
   } else if (IS_NUMBER(arg)) {
     double dnum = AS_NUMBER(arg);
-    int num = dnum;
-    if (dnum != num || num < 0) {
+    if (!isIntIndex(dnum)) {
       args[-1] = CSTRING_VAL("Error: range number should be positive integer.");
       return false;
     }
+    int num = (int)dnum;
     ObjArray *arr = newArray();
     args[-1] = OBJ_VAL(arr);
     arr->array.capacity = num;
@@ -826,6 +923,11 @@ static bool rangeNative(int argCount, Value *args) {
 
     if (IS_STRING(arg)) {
       ObjString *s = AS_STRING(arg);
+      // One allocation up front: exact for valid UTF-8
+      int count = (int)textUtf8Count(s->chars, s->length);
+      ValueArray *chars = &AS_ARRAY(args[-1]);
+      chars->values = GROW_ARRAY(Value, NULL, 0, count);
+      chars->capacity = count;
       for (size_t i = 0; i < s->length;) {
         uint8_t charlen = utf8CharLength(s->chars[i]);
         if (i + charlen > s->length)
@@ -895,85 +997,194 @@ static bool joinNative(int argCount, Value *args) {
   const char *sep = AS_STRING(args[1])->chars;
   size_t seplen = AS_STRING(args[1])->length;
 
-  // First pass: calculate total length needed
-  // Store parts and lengths. For strings, use their raw bytes (no allocation);
-  // for non-strings, allocate a stringified representation.
-  const char **parts = malloc(sizeof(char*) * array->count);
-  size_t *lengths = malloc(sizeof(size_t) * array->count);
-  char **owned = malloc(sizeof(char*) * array->count);
-  if (parts == NULL || lengths == NULL || owned == NULL) {
-    free(parts);
-    free(lengths);
-    free(owned);
-    args[-1] = CSTRING_VAL("Error: Malloc failed.");
-    return false;
-  }
-
+  // Length pre-pass. Strings are copied straight from their chars later;
+  // anything else is stringified here, once, and kept until the copy.
+  typedef struct {
+    char *chars;
+    size_t length;
+  } Stringified;
+  Stringified *owned = NULL;
   size_t total_length = 0;
   for (int i = 0; i < array->count; i++) {
-    owned[i] = NULL;
     Value v = array->values[i];
     if (IS_STRING(v)) {
-      ObjString* s = AS_STRING(v);
-      parts[i] = s->chars;
-      lengths[i] = (size_t)s->length;
+      total_length += (size_t)AS_STRING(v)->length;
     } else {
-      char* tmp = NULL;
-      int slen = tostring(&tmp, v);
-      if (slen < 0) slen = 0;
-      parts[i] = tmp;
-      lengths[i] = (size_t)slen;
-      owned[i] = tmp;
-    }
-
-    total_length += lengths[i];
-    if (i > 0) {
-      total_length += seplen;
+      if (owned == NULL) {
+        owned = calloc((size_t)array->count, sizeof(Stringified));
+        if (owned == NULL) {
+          args[-1] = CSTRING_VAL("Error: Malloc failed.");
+          return false;
+        }
+      }
+      int slen = tostring(&owned[i].chars, v);
+      owned[i].length = slen < 0 ? 0 : (size_t)slen;
+      total_length += owned[i].length;
     }
+    if (i > 0) total_length += seplen;
   }
 
-  // Single allocation for final result
   if (total_length > (size_t)INT_MAX) {
-    for (int i = 0; i < array->count; i++) {
-      free(owned[i]);
+    if (owned != NULL) {
+      for (int i = 0; i < array->count; i++) free(owned[i].chars);
+      free(owned);
     }
-    free(parts);
-    free(lengths);
-    free(owned);
     args[-1] = CSTRING_VAL("Error: Joined string too long.");
     return false;
   }
 
-  char *result = malloc(total_length + 1);
-  if (result == NULL) {
-    for (int i = 0; i < array->count; i++) {
-      free(owned[i]);
-    }
-    free(parts);
-    free(lengths);
-    free(owned);
-    args[-1] = CSTRING_VAL("Error: Malloc failed.");
-    return false;
-  }
-
-  // Second pass: copy all strings into result
-  size_t offset = 0;
+  // Single allocation, handed to the string without another copy
+  char *result = ALLOCATE(char, total_length + 1);
+  char *at = result;
   for (int i = 0; i < array->count; i++) {
     if (i > 0) {
-      memcpy(result + offset, sep, seplen);
-      offset += seplen;
+      memcpy(at, sep, seplen);
+      at += seplen;
+    }
+    Value v = array->values[i];
+    if (IS_STRING(v)) {
+      memcpy(at, AS_STRING(v)->chars, (size_t)AS_STRING(v)->length);
+      at += AS_STRING(v)->length;
+    } else {
+      memcpy(at, owned[i].chars, owned[i].length);
+      at += owned[i].length;
+      free(owned[i].chars);
     }
-    memcpy(result + offset, parts[i], lengths[i]);
-    offset += lengths[i];
-    free(owned[i]);
   }
   result[total_length] = '\0';
-  free(parts);
-  free(lengths);
   free(owned);
 
-  args[-1] = OBJ_VAL(copyString(result, total_length));
-  free(result);
+  args[-1] = OBJ_VAL(takeString(result, (int)total_length));
+  return true;
+}
+
+// Lx.format(template: String, ...args) -> String
+// `{}` takes the next argument and `{n}` argument n (0-based); `{{` and
+// `}}` are literal braces. Arguments print as str() prints them.
+typedef struct {
+  const char *chars;
+  size_t length;
+  bool owned;
+} FormatArg;
+
+// Walks the template once to size the result (out == NULL) and again to
+// write it. Returns false with `message` filled on a bad template.
+static bool formatTemplate(ObjString *template, const FormatArg *formatArgs, int count,
+                           char *out, size_t *length, char *message, size_t messageSize) {
+  const char *chars = template->chars;
+  int templateLength = template->length;
+  int nextArg = 0;
+  size_t total = 0;
+  int start = 0;
+  for (int i = 0; i < templateLength; i++) {
+    char c = chars[i];
+    if (c != '{' && c != '}') continue;
+
+    // Flush the literal run before the brace
+    if (out != NULL) memcpy(out + total, chars + start, (size_t)(i - start));
+    total += (size_t)(i - start);
+
+    if (i + 1 < templateLength && chars[i + 1] == c) {
+      if (out != NULL) out[total] = c;
+      total++;
+      i++;
+      start = i + 1;
+      continue;
+    }
+    if (c == '}') {
+      snprintf(message, messageSize, "Error: Lx.format: single '}' at offset %d.", i);
+      return false;
+    }
+
+    int close = i + 1;
+    int index = 0;
+    while (close < templateLength && chars[close] >= '0' && chars[close] <= '9') {
+      // Anything past count is out of range anyway; stop growing it
+      if (index <= count) index = index * 10 + (chars[close] - '0');
+      close++;
+    }
+    if (close >= templateLength || chars[close] != '}') {
+      snprintf(message, messageSize, "Error: Lx.format: bad placeholder at offset %d.", i);
+      return false;
+    }
+    if (close == i + 1) index = nextArg++;
+    if (index >= count) {
+      snprintf(message, messageSize,
+               "Error: Lx.format: placeholder at offset %d has no argument.", i);
+      return false;
+    }
+
+    const FormatArg *arg = &formatArgs[index];
+    if (out != NULL) memcpy(out + total, arg->chars, arg->length);
+    total += arg->length;
+    i = close;
+    start = close + 1;
+  }
+  if (out != NULL) memcpy(out + total, chars + start, (size_t)(templateLength - start));
+  total += (size_t)(templateLength - start);
+  *length = total;
+  return true;
+}
+
+static bool lxFormatNative(int argCount, Value *args) {
+  if (argCount < 1 || !IS_STRING(args[0])) {
+    args[-1] = CSTRING_VAL("Error: Lx.format takes a template string.");
+    return false;
+  }
+  ObjString *template = AS_STRING(args[0]);
+  int count = argCount - 1;
+
+  // Strings are copied straight from their chars; anything else is
+  // stringified once here and kept until the result is written.
+  FormatArg inlineArgs[8] = {{NULL, 0, false}};
+  FormatArg *formatArgs = inlineArgs;
+  if (count > 8) {
+    formatArgs = malloc(sizeof(FormatArg) * (size_t)count);
+    if (formatArgs == NULL) {
+      args[-1] = CSTRING_VAL("Error: Malloc failed.");
+      return false;
+    }
+  }
+  for (int i = 0; i < count; i++) {
+    Value v = args[i + 1];
+    if (IS_STRING(v)) {
+      formatArgs[i].chars = AS_STRING(v)->chars;
+      formatArgs[i].length = (size_t)AS_STRING(v)->length;
+      formatArgs[i].owned = false;
+    } else {
+      char *s = NULL;
+      int slen = tostring(&s, v);
+      formatArgs[i].chars = s;
+      formatArgs[i].length = slen < 0 ? 0 : (size_t)slen;
+      formatArgs[i].owned = true;
+    }
+  }
+
+  char message[96];
+  size_t length = 0;
+  bool ok = formatTemplate(template, formatArgs, count, NULL, &length, message,
+                           sizeof(message));
+  if (ok && length > (size_t)INT_MAX) {
+    snprintf(message, sizeof(message), "Error: Lx.format result too long.");
+    ok = false;
+  }
+  char *result = NULL;
+  if (ok) {
+    result = ALLOCATE(char, length + 1);
+    formatTemplate(template, formatArgs, count, result, &length, message, sizeof(message));
+    result[length] = '\0';
+  }
+
+  for (int i = 0; i < count; i++) {
+    if (formatArgs[i].owned) free((char *)formatArgs[i].chars);
+  }
+  if (formatArgs != inlineArgs) free(formatArgs);
+
+  if (!ok) {
+    args[-1] = CSTRING_VAL(message);
+    return false;
+  }
+  args[-1] = OBJ_VAL(takeString(result, (int)length));
   return true;
 }
 
@@ -1002,7 +1213,8 @@ static bool splitNative(int argCount, Value *args) {
   }
 
   const char *start = input->chars;
-  const char *next = strstr(start, delimiter->chars);
+  const char *end = input->chars + input->length;
+  const char *next = textFind(start, input->length, delimiter->chars, delimiter->length);
 
   while (next != NULL) {
     size_t length = next - start;
@@ -1011,13 +1223,12 @@ static bool splitNative(int argCount, Value *args) {
     pop();
 
     start = next + delimiter->length;
-    next = strstr(start, delimiter->chars);
+    next = textFind(start, (size_t)(end - start), delimiter->chars, delimiter->length);
   }
 
   // Add remaining part
-  if (*start != '\0') {
-    size_t length = (input->chars + input->length) - start;
-    push(OBJ_VAL(copyString(start, length)));
+  if (start < end) {
+    push(OBJ_VAL(copyString(start, (size_t)(end - start))));
     writeValueArray(&result->array, vm.stackTop[-1]);
     pop();
   }
@@ -1219,7 +1430,15 @@ static bool containsNative(int argCount, Value *args) {
     }
 
     // Match only at UTF-8 character boundaries (similar to the old lx
-    // implementation which used `range()` over chars).
+    // implementation which used `range()` over chars). In valid UTF-8 every
+    // byte that isn't a continuation byte starts a character, so a plain
+    // search gives the same answer.
+    if (textUtf8Valid(s->chars, s->length)) {
+      bool boundary = ((uint8_t)t->chars[0] & 0xc0) != 0x80;
+      args[-1] = BOOL_VAL(boundary &&
+                          textFind(s->chars, s->length, t->chars, t->length) != NULL);
+      return true;
+    }
     for (size_t i = 0; i < s->length;) {
       if (i + t->length <= s->length &&
           memcmp(s->chars + i, t->chars, t->length) == 0) {
@@ -1288,62 +1507,283 @@ static bool readNative(int argCount, Value *args) {
   return true;
 }
 
+// Subprocesses. Children are started with posix_spawnp; each stdio stream is
+// inherited, piped back to the parent or sent to /dev/null. Parent pipe ends
+// are close-on-exec so no other child ever holds one open.
+
+typedef enum {
+  SPAWN_INHERIT,
+  SPAWN_PIPE,
+  SPAWN_NULL,
+  SPAWN_STDOUT, // stderr only: same as stdout
+} SpawnStdio;
+
+extern char **environ;
+
+static bool spawnProcess(char *const *argv, char *const *envp, SpawnStdio stdio[3],
+                         pid_t *pid, int parentFds[3], const char **error) {
+  int pipes[3][2] = { { -1, -1 }, { -1, -1 }, { -1, -1 } };
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  bool ok = true;
+  *error = NULL;
+
+  for (int i = 0; i < 3 && ok; i++) {
+    parentFds[i] = -1;
+    switch (stdio[i]) {
+      case SPAWN_INHERIT:
+        break;
+      case SPAWN_PIPE: {
+        if (pipe(pipes[i]) != 0) {
+          *error = "Error: pipe() failed.";
+          ok = false;
+          break;
+        }
+        fcntl(pipes[i][0], F_SETFD, FD_CLOEXEC);
+        fcntl(pipes[i][1], F_SETFD, FD_CLOEXEC);
+        int childEnd = i == 0 ? pipes[i][0] : pipes[i][1];
+        posix_spawn_file_actions_adddup2(&actions, childEnd, i);
+        break;
+      }
+      case SPAWN_NULL:
+        posix_spawn_file_actions_addopen(&actions, i, "/dev/null",
+                                         i == 0 ? O_RDONLY : O_WRONLY, 0);
+        break;
+      case SPAWN_STDOUT:
+        posix_spawn_file_actions_adddup2(&actions, 1, 2);
+        break;
+    }
+  }
+
+  if (ok) {
+    int err = posix_spawnp(pid, argv[0], &actions, NULL, argv,
+                           envp != NULL ? envp : environ);
+    if (err != 0) {
+      static _Thread_local char message[256];
+      snprintf(message, sizeof(message), "Error: could not spawn '%s': %s",
+               argv[0], strerror(err));
+      *error = message;
+      ok = false;
+    }
+  }
+  posix_spawn_file_actions_destroy(&actions);
+
+  for (int i = 0; i < 3; i++) {
+    if (pipes[i][0] < 0) continue;
+    int parentEnd = i == 0 ? pipes[i][1] : pipes[i][0];
+    int childEnd = i == 0 ? pipes[i][0] : pipes[i][1];
+    close(childEnd);
+    if (ok) {
+      parentFds[i] = parentEnd;
+    } else {
+      close(parentEnd);
+    }
+  }
+  return ok;
+}
+
+// Lx.proc.exec(cmd): runs `cmd` through /bin/sh and waits for it, capturing
+// stdout. Use Lx.spawn for stderr, stdin or running children concurrently.
 static bool execNative(int argCount, Value *args) {
   if (argCount < 1 || !IS_STRING(args[0])) {
     args[-1] = CSTRING_VAL("Error: Arg must be a string.");
     return false;
   }
-  ObjString *cmd = AS_STRING(args[0]);
-  FILE *fp;
+  char *argv[] = { "/bin/sh", "-c", AS_STRING(args[0])->chars, NULL };
+  SpawnStdio stdio[3] = { SPAWN_INHERIT, SPAWN_PIPE, SPAWN_INHERIT };
+  pid_t pid;
+  int fds[3];
+  const char *error;
+  fflush(stdout);
+  if (!spawnProcess(argv, NULL, stdio, &pid, fds, &error)) {
+    args[-1] = CSTRING_VAL(error);
+    return false;
+  }
+
+  // Output accumulates in a Bytes buffer rooted in the result slot
+  args[-1] = OBJ_VAL(newTypedArray(TYPED_BYTES, 0));
+  LoopOp read = { .kind = LOOP_OP_READ_ALL, .fd = fds[1], .data = args[-1] };
+  Value output = NIL_VAL;
+  LoopStatus status = loopBlock(&read, &output, &error);
+  close(fds[1]);
 
-  if ((fp = popen(cmd->chars, "r")) == NULL) {
-    args[-1] = CSTRING_VAL("Error: Failed to start process.");
+  LoopOp wait = { .kind = LOOP_OP_WAIT, .fd = -1, .data = NIL_VAL, .pid = pid };
+  Value code = NIL_VAL;
+  const char *waitError;
+  if (loopBlock(&wait, &code, &waitError) == LOOP_FAILED && status != LOOP_FAILED) {
+    error = waitError;
+    status = LOOP_FAILED;
+  }
+  if (status == LOOP_FAILED) {
+    args[-1] = CSTRING_VAL(error);
     return false;
   }
 
-  char buf[500];
-  size_t buflen;
-  char *result = NULL;
-  size_t result_size = 0;
+  ObjTypedArray *bytes = AS_TYPED_ARRAY(output);
+  push(OBJ_VAL(copyString((const char *)bytes->as.u8, bytes->count)));
+  args[-1] = OBJ_VAL(newHashmap());
+  push(CSTRING_VAL("code"));
+  tableSet(&AS_HASHMAP(args[-1]), vm.stackTop[-1], code);
+  pop();
+  push(CSTRING_VAL("out"));
+  tableSet(&AS_HASHMAP(args[-1]), vm.stackTop[-1], vm.stackTop[-2]);
+  pop();
+  pop();
 
-  while ((buflen = fread(buf, sizeof(char), sizeof(buf), fp)) > 0) {
-    char *tmp_result = (char *)realloc(result, buflen + result_size + 1);
+  return true;
+}
+
+static bool spawnStdioOpt(ObjHashmap *opts, const char *name, SpawnStdio *stdio) {
+  Value mode;
+  if (opts == NULL || !tableGet(&opts->table, CSTRING_VAL(name), &mode) || IS_NIL(mode)) {
+    *stdio = SPAWN_INHERIT;
+    return true;
+  }
+  const char *chars = IS_STRING(mode) ? AS_STRING(mode)->chars : "";
+  if (strcmp(chars, "inherit") == 0) {
+    *stdio = SPAWN_INHERIT;
+  } else if (strcmp(chars, "pipe") == 0) {
+    *stdio = SPAWN_PIPE;
+  } else if (strcmp(chars, "null") == 0) {
+    *stdio = SPAWN_NULL;
+  } else if (strcmp(chars, "stdout") == 0 && strcmp(name, "stderr") == 0) {
+    *stdio = SPAWN_STDOUT;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static void freeSpawnStrings(char **strings, int count) {
+  for (int i = 0; i < count; i++) free(strings[i]);
+  free(strings);
+}
 
-    if (tmp_result == NULL) {
-      args[-1] = CSTRING_VAL("Error: Realloc failed.");
-      pclose(fp);
-      if (result != NULL)
-        free(result);
+// Lx.spawn(argv, opts?): starts argv[0] (searched in PATH) without waiting.
+// opts.stdin/stdout/stderr are "inherit" (default), "pipe" or "null";
+// stderr may also be "stdout". opts.cwd runs the child in another directory
+// and opts.env replaces its environment. Returns .{ pid, stdin, stdout,
+// stderr } with the parent's pipe fds (nil for streams that aren't piped).
+static bool spawnNative(int argCount, Value *args) {
+  if (argCount < 1 || !IS_ARRAY(args[0]) || AS_ARRAY(args[0]).count == 0) {
+    args[-1] = CSTRING_VAL("Error: Lx.spawn takes a non-empty argv array.");
+    return false;
+  }
+  ObjHashmap *opts = NULL;
+  if (argCount > 1 && !IS_NIL(args[1])) {
+    if (!IS_HASHMAP(args[1])) {
+      args[-1] = CSTRING_VAL("Error: Lx.spawn opts must be a map.");
+      return false;
+    }
+    opts = (ObjHashmap *)AS_OBJ(args[1]);
+  }
+
+  SpawnStdio stdio[3];
+  const char *streams[3] = { "stdin", "stdout", "stderr" };
+  for (int i = 0; i < 3; i++) {
+    if (!spawnStdioOpt(opts, streams[i], &stdio[i])) {
+      char message[128];
+      snprintf(message, sizeof(message),
+               "Error: Lx.spawn opts.%s must be \"inherit\", \"pipe\"%s or \"null\".",
+               streams[i], i == 2 ? ", \"stdout\"" : "");
+      args[-1] = OBJ_VAL(copyString(message, strlen(message)));
       return false;
     }
+  }
 
-    memcpy(tmp_result + result_size, buf, buflen);
-    result = tmp_result;
+  Value cwd = NIL_VAL;
+  Value env = NIL_VAL;
+  if (opts != NULL) {
+    tableGet(&opts->table, CSTRING_VAL("cwd"), &cwd);
+    tableGet(&opts->table, CSTRING_VAL("env"), &env);
+  }
+  if (!IS_NIL(cwd) && !IS_STRING(cwd)) {
+    args[-1] = CSTRING_VAL("Error: Lx.spawn opts.cwd must be a string.");
+    return false;
+  }
+  if (!IS_NIL(env) && !IS_HASHMAP(env)) {
+    args[-1] = CSTRING_VAL("Error: Lx.spawn opts.env must be a map.");
+    return false;
+  }
 
-    result_size += buflen;
-    result[result_size] = '\0';
+  // posix_spawn has no portable chdir action, so a cwd goes through the
+  // shell: sh -c 'cd -- "$0" && exec "$@"' <cwd> argv...
+  ValueArray *argArray = &AS_ARRAY(args[0]);
+  int prefix = IS_NIL(cwd) ? 0 : 4;
+  int argvCount = prefix + argArray->count;
+  char **argv = calloc((size_t)argvCount + 1, sizeof(char *));
+  if (argv == NULL) {
+    args[-1] = CSTRING_VAL("Error: out of memory.");
+    return false;
+  }
+  if (prefix > 0) {
+    argv[0] = "/bin/sh";
+    argv[1] = "-c";
+    argv[2] = "cd -- \"$0\" && exec \"$@\"";
+    argv[3] = AS_STRING(cwd)->chars;
+  }
+  for (int i = 0; i < argArray->count; i++) {
+    if (!IS_STRING(argArray->values[i])) {
+      free(argv);
+      args[-1] = CSTRING_VAL("Error: Lx.spawn argv must be an array of strings.");
+      return false;
+    }
+    argv[prefix + i] = AS_STRING(argArray->values[i])->chars;
   }
 
-  int code = pclose(fp) >> 8;
-  args[-1] = OBJ_VAL(newHashmap());
-  push(CSTRING_VAL("code"));
-  tableSet(&AS_HASHMAP(args[-1]), vm.stackTop[-1], NUMBER_VAL(code));
-  pop();
-  push(CSTRING_VAL("out"));
-  if (result != NULL) {
-    if (result_size > (size_t)INT_MAX) {
-      push(CSTRING_VAL("Error: exec output too large."));
-    } else {
-      push(OBJ_VAL(copyString(result, result_size)));
+  char **envp = NULL;
+  int envCount = 0;
+  if (!IS_NIL(env)) {
+    Table *table = &AS_HASHMAP(env);
+    envp = calloc((size_t)table->capacity + 1, sizeof(char *));
+    for (int i = 0; envp != NULL && i < table->capacity; i++) {
+      Entry *entry = &table->entries[i];
+      if (IS_NIL(entry->key)) continue;
+      if (!IS_STRING(entry->key) || !IS_STRING(entry->value)) {
+        freeSpawnStrings(envp, envCount);
+        free(argv);
+        args[-1] = CSTRING_VAL("Error: Lx.spawn opts.env must map strings to strings.");
+        return false;
+      }
+      ObjString *key = AS_STRING(entry->key);
+      ObjString *value = AS_STRING(entry->value);
+      char *pair = malloc((size_t)key->length + (size_t)value->length + 2);
+      if (pair == NULL) break;
+      memcpy(pair, key->chars, (size_t)key->length);
+      pair[key->length] = '=';
+      memcpy(pair + key->length + 1, value->chars, (size_t)value->length + 1);
+      envp[envCount++] = pair;
+    }
+    if (envp == NULL || envCount < table->count) {
+      if (envp != NULL) freeSpawnStrings(envp, envCount);
+      free(argv);
+      args[-1] = CSTRING_VAL("Error: out of memory.");
+      return false;
     }
-    free(result);
-  } else {
-    push(CSTRING_VAL(""));
   }
-  tableSet(&AS_HASHMAP(args[-1]), vm.stackTop[-2], vm.stackTop[-1]);
-  pop();
-  pop();
 
+  pid_t pid;
+  int fds[3];
+  const char *error;
+  fflush(stdout);
+  bool ok = spawnProcess(argv, envp, stdio, &pid, fds, &error);
+  free(argv);
+  if (envp != NULL) freeSpawnStrings(envp, envCount);
+  if (!ok) {
+    args[-1] = CSTRING_VAL(error);
+    return false;
+  }
+
+  ObjHashmap *child = newHashmap();
+  args[-1] = OBJ_VAL(child);
+  push(CSTRING_VAL("pid"));
+  tableSet(&child->table, vm.stackTop[-1], NUMBER_VAL((double)pid));
+  pop();
+  for (int i = 0; i < 3; i++) {
+    push(CSTRING_VAL(streams[i]));
+    tableSet(&child->table, vm.stackTop[-1], fds[i] < 0 ? NIL_VAL : NUMBER_VAL(fds[i]));
+    pop();
+  }
   return true;
 }
 
@@ -1353,88 +1793,555 @@ static bool systemNative(int argCount, Value *args) {
     return false;
   }
   ObjString *cmd = AS_STRING(args[0]);
+  fflush(stdout);
   int code = system(cmd->chars) >> 8;
   args[-1] = NUMBER_VAL(code);
 
   return true;
 }
 
-static bool exitNative(int argCount, Value *args) {
-  int exitCode = 0;
-  if (argCount == 0) {
-  } else if (argCount < 1 || !IS_NUMBER(args[0])) {
-    args[-1] = CSTRING_VAL("Error: exit takes a number arg.");
+// Process primitives for fanning work out to forked children: fork/pipe
+// to start a worker, write/readAll/close on the pipe, wait for its status.
+
+static bool procFdArg(const char *name, int argCount, Value *args, int *fd) {
+  if (argCount < 1 || !IS_NUMBER(args[0]) || AS_NUMBER(args[0]) < 0 ||
+      AS_NUMBER(args[0]) != trunc(AS_NUMBER(args[0]))) {
+    char message[96];
+    snprintf(message, sizeof(message), "Error: %s takes a file descriptor.", name);
+    args[-1] = OBJ_VAL(copyString(message, strlen(message)));
     return false;
-  } else {
-    exitCode = AS_NUMBER(args[0]);
   }
-  freeVM();
-  exit(exitCode);
+  *fd = (int)AS_NUMBER(args[0]);
   return true;
 }
 
-static bool resolvePathFromCwd(const char* in, char* out, size_t outSize) {
-  if (in == NULL) return false;
-  if (out == NULL || outSize == 0) return false;
-
-  // Absolute paths are used as-is.
-  if (in[0] == '/') {
-    size_t n = strlen(in);
-    if (n + 1 > outSize) return false;
-    memcpy(out, in, n + 1);
-    return true;
+// Lx.proc.fork(): the child's pid in the parent, 0 in the child.
+static bool procForkNative(int argCount, Value *args) {
+  // Pending stdio output would otherwise be written by both processes
+  fflush(stdout);
+  fflush(stderr);
+  flushFiles();
+  pid_t pid = fork();
+  if (pid < 0) {
+    args[-1] = CSTRING_VAL("Error: fork() failed.");
+    return false;
   }
+  args[-1] = NUMBER_VAL((double)pid);
+  return true;
+}
 
-  char cwd[PATH_MAX + 1];
-  if (getcwd(cwd, sizeof(cwd)) == NULL) return false;
+// Lx.proc.pipe(): [readFd, writeFd]. Both ends are close-on-exec so
+// processes started through exec/system never hold a worker pipe open.
+static bool procPipeNative(int argCount, Value *args) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    args[-1] = CSTRING_VAL("Error: pipe() failed.");
+    return false;
+  }
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
 
-  size_t cwdLen = strlen(cwd);
-  size_t inLen = strlen(in);
+  ObjArray *pair = newArray();
+  push(OBJ_VAL(pair));
+  writeValueArray(&pair->array, NUMBER_VAL(fds[0]));
+  writeValueArray(&pair->array, NUMBER_VAL(fds[1]));
+  pop();
+  args[-1] = OBJ_VAL(pair);
+  return true;
+}
 
-  // Need: cwd + "/" + in + "\0"
-  if (cwdLen + 1 + inLen + 1 > outSize) return false;
+static bool procCloseNative(int argCount, Value *args) {
+  int fd;
+  if (!procFdArg("Lx.proc.close", argCount, args, &fd)) return false;
+  args[-1] = BOOL_VAL(close(fd) == 0);
+  return true;
+}
 
-  memcpy(out, cwd, cwdLen);
-  if (cwdLen > 0 && cwd[cwdLen - 1] != '/') {
-    out[cwdLen] = '/';
-    memcpy(out + cwdLen + 1, in, inLen + 1);
-  } else {
-    memcpy(out + cwdLen, in, inLen + 1);
+// Lx.proc.write(fd, data): writes every byte of a string or Bytes.
+static bool procWriteNative(int argCount, Value *args) {
+  int fd;
+  if (!procFdArg("Lx.proc.write", argCount, args, &fd)) return false;
+  const uint8_t *bytes;
+  size_t length;
+  if (argCount < 2 || !byteView(args[1], &bytes, &length)) {
+    args[-1] = CSTRING_VAL("Error: Lx.proc.write takes a string or Bytes.");
+    return false;
+  }
+  size_t written = 0;
+  while (written < length) {
+    ssize_t n = write(fd, bytes + written, length - written);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      args[-1] = CSTRING_VAL("Error: write() failed.");
+      return false;
+    }
+    written += (size_t)n;
   }
-
+  args[-1] = NIL_VAL;
   return true;
 }
 
-static bool slurpNative(int argCount, Value *args) {
-  if (argCount < 1 || !IS_STRING(args[0])) {
-    args[-1] = CSTRING_VAL("Error: slurp takes a string arg.");
-    return false;
-  }
+// Lx.proc.readAll(fd): Bytes read until end of file. Inside a loop task the
+// task waits for the fd instead of blocking the VM.
+static bool procReadAllNative(int argCount, Value *args) {
+  int fd;
+  if (!procFdArg("Lx.proc.readAll", argCount, args, &fd)) return false;
+  // The buffer is rooted in the result slot while the read is pending
+  args[-1] = OBJ_VAL(newTypedArray(TYPED_BYTES, 0));
+  LoopOp op = { .kind = LOOP_OP_READ_ALL, .fd = fd, .data = args[-1] };
+  return loopOpNative(&op, args);
+}
 
-  const char* inPath = AS_STRING(args[0])->chars;
-  char path[PATH_MAX + 1] = "";
-  if (!resolvePathFromCwd(inPath, path, sizeof(path))) {
-    args[-1] = CSTRING_VAL("Error: invalid path.");
+static bool procPidArg(const char *name, int argCount, Value *args, pid_t *pid) {
+  if (argCount < 1 || !IS_NUMBER(args[0]) || AS_NUMBER(args[0]) <= 0 ||
+      AS_NUMBER(args[0]) != trunc(AS_NUMBER(args[0]))) {
+    char message[96];
+    snprintf(message, sizeof(message), "Error: %s takes a pid.", name);
+    args[-1] = OBJ_VAL(copyString(message, strlen(message)));
     return false;
   }
+  *pid = (pid_t)AS_NUMBER(args[0]);
+  return true;
+}
 
-  FILE *file = fopen(path, "rb");
-  if (file == NULL) {
-    // XXX: more unified error reporting
-    fprintf(stderr, "Could not open file \"%s\".\n", path);
-    args[-1] = CSTRING_VAL("Error: failed to open file.");
+// Lx.proc.wait(pid): the child's exit code, or 128 + signal number when it
+// was killed (shell convention).
+static bool procWaitNative(int argCount, Value *args) {
+  pid_t pid;
+  if (!procPidArg("Lx.proc.wait", argCount, args, &pid)) return false;
+  LoopOp op = { .kind = LOOP_OP_WAIT, .fd = -1, .data = NIL_VAL, .pid = pid };
+  return loopOpNative(&op, args);
+}
+
+// Lx.proc.tryWait(pid): like wait, but nil while the child is still running.
+static bool procTryWaitNative(int argCount, Value *args) {
+  pid_t pid;
+  if (!procPidArg("Lx.proc.tryWait", argCount, args, &pid)) return false;
+  LoopOp op = { .kind = LOOP_OP_WAIT, .fd = -1, .data = NIL_VAL, .pid = pid };
+  Value result = NIL_VAL;
+  const char *error;
+  if (loopTry(&op, &result, &error) == LOOP_FAILED) {
+    args[-1] = CSTRING_VAL(error);
     return false;
   }
+  args[-1] = result;
+  return true;
+}
 
-  fseek(file, 0L, SEEK_END);
-  size_t fileSize = ftell(file);
-  rewind(file);
+// Lx.proc.waitAny(): .{ pid, code } for the next child to finish, or nil
+// when there are no children left.
+static bool procWaitAnyNative(int argCount, Value *args) {
+  LoopOp op = { .kind = LOOP_OP_WAIT, .fd = -1, .data = NIL_VAL, .pid = -1 };
+  return loopOpNative(&op, args);
+}
 
-  char *buffer = (char *)malloc(fileSize + 1);
-  if (buffer == NULL) {
-    fprintf(stderr, "Not enough memory to read \"%s\".\n", path);
-    args[-1] = CSTRING_VAL("Error: failed to open file.");
-    fclose(file);
+// Lx.proc.kill(pid, signal = 15)
+static bool procKillNative(int argCount, Value *args) {
+  pid_t pid;
+  if (!procPidArg("Lx.proc.kill", argCount, args, &pid)) return false;
+  int sig = SIGTERM;
+  if (argCount > 1) {
+    if (!IS_NUMBER(args[1])) {
+      args[-1] = CSTRING_VAL("Error: Lx.proc.kill signal must be a number.");
+      return false;
+    }
+    sig = (int)AS_NUMBER(args[1]);
+  }
+  args[-1] = BOOL_VAL(kill(pid, sig) == 0);
+  return true;
+}
+
+// Lx.proc.exit(code): ends a forked child right away. Unlike Lx.exit it
+// skips VM teardown and atexit handlers, which belong to the parent.
+static bool procExitNative(int argCount, Value *args) {
+  int exitCode = 0;
+  if (argCount > 0) {
+    if (!IS_NUMBER(args[0])) {
+      args[-1] = CSTRING_VAL("Error: Lx.proc.exit takes a number arg.");
+      return false;
+    }
+    exitCode = (int)AS_NUMBER(args[0]);
+  }
+  fflush(stdout);
+  fflush(stderr);
+  _exit(exitCode);
+  return true;
+}
+
+static bool procPidNative(int argCount, Value *args) {
+  args[-1] = NUMBER_VAL((double)getpid());
+  return true;
+}
+
+static bool procCpuCountNative(int argCount, Value *args) {
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  args[-1] = NUMBER_VAL(count > 0 ? (double)count : 1);
+  return true;
+}
+
+static bool exitNative(int argCount, Value *args) {
+  int exitCode = 0;
+  if (argCount == 0) {
+  } else if (argCount < 1 || !IS_NUMBER(args[0])) {
+    args[-1] = CSTRING_VAL("Error: exit takes a number arg.");
+    return false;
+  } else {
+    exitCode = AS_NUMBER(args[0]);
+  }
+  freeVM();
+  if (isolateIsSpawned()) isolateExit(exitCode);
+  exit(exitCode);
+  return true;
+}
+
+// Lx.isolate.spawn(path, args?): runs `lx run path args...` on a new thread
+// with its own VM. Returns the isolate id.
+static bool isolateSpawnNative(int argCount, Value *args) {
+  if (argCount < 1 || !IS_STRING(args[0])) {
+    args[-1] = CSTRING_VAL("Error: Lx.isolate.spawn takes a path.");
+    return false;
+  }
+  int extraCount = 0;
+  if (argCount > 1 && !IS_NIL(args[1])) {
+    if (!IS_ARRAY(args[1])) {
+      args[-1] = CSTRING_VAL("Error: Lx.isolate.spawn args must be an array of strings.");
+      return false;
+    }
+    extraCount = AS_ARRAY(args[1]).count;
+  }
+  const char **extra = malloc(sizeof(char *) * (extraCount > 0 ? extraCount : 1));
+  for (int i = 0; i < extraCount; i++) {
+    Value arg = AS_ARRAY(args[1]).values[i];
+    if (!IS_STRING(arg)) {
+      free(extra);
+      args[-1] = CSTRING_VAL("Error: Lx.isolate.spawn args must be an array of strings.");
+      return false;
+    }
+    extra[i] = AS_CSTRING(arg);
+  }
+  int id = isolateSpawn(AS_CSTRING(args[0]), extra, extraCount);
+  free(extra);
+  if (id < 0) {
+    args[-1] = CSTRING_VAL("Error: Lx.isolate.spawn could not start a thread.");
+    return false;
+  }
+  args[-1] = NUMBER_VAL(id);
+  return true;
+}
+
+// Lx.isolate.send(id, message): deep-copies message into the isolate's
+// mailbox. Functions, fibers and enums can't cross isolates.
+static bool isolateSendNative(int argCount, Value *args) {
+  if (argCount < 2 || !IS_NUMBER(args[0])) {
+    args[-1] = CSTRING_VAL("Error: Lx.isolate.send takes an isolate id and a message.");
+    return false;
+  }
+  const char *error = NULL;
+  if (!isolateSend((int)AS_NUMBER(args[0]), args[1], &error)) {
+    args[-1] = CSTRING_VAL(error);
+    return false;
+  }
+  args[-1] = NIL_VAL;
+  return true;
+}
+
+// Lx.isolate.recv(timeoutSeconds?): the next message, or nil on timeout.
+static bool isolateRecvNative(int argCount, Value *args) {
+  double timeout = -1;
+  if (argCount > 0 && !IS_NIL(args[0])) {
+    if (!IS_NUMBER(args[0])) {
+      args[-1] = CSTRING_VAL("Error: Lx.isolate.recv timeout must be a number.");
+      return false;
+    }
+    timeout = AS_NUMBER(args[0]);
+    if (timeout < 0) timeout = 0;
+  }
+  if (isolateReceive(timeout)) {
+    args[-1] = pop();
+  } else {
+    args[-1] = NIL_VAL;
+  }
+  return true;
+}
+
+// Lx.isolate.join(id): waits for the isolate to finish; returns its exit code.
+static bool isolateJoinNative(int argCount, Value *args) {
+  if (argCount < 1 || !IS_NUMBER(args[0])) {
+    args[-1] = CSTRING_VAL("Error: Lx.isolate.join takes an isolate id.");
+    return false;
+  }
+  int exitCode;
+  if (!isolateJoin((int)AS_NUMBER(args[0]), &exitCode)) {
+    args[-1] = CSTRING_VAL("Error: Lx.isolate.join of an unknown or already joined isolate.");
+    return false;
+  }
+  args[-1] = NUMBER_VAL(exitCode);
+  return true;
+}
+
+static bool isolateSelfNative(int argCount, Value *args) {
+  args[-1] = NUMBER_VAL(isolateSelf());
+  return true;
+}
+
+// nil on the main isolate
+static bool isolateParentNative(int argCount, Value *args) {
+  int parent = isolateParent();
+  args[-1] = parent < 0 ? NIL_VAL : NUMBER_VAL(parent);
+  return true;
+}
+
+// Lx.loop.read(fd, max?): up to max (default 65536) bytes as a string, nil
+// at end of file.
+static bool loopReadNative(int argCount, Value *args) {
+  int fd;
+  if (!procFdArg("Lx.loop.read", argCount, args, &fd)) return false;
+  double max = 65536;
+  if (argCount > 1 && !IS_NIL(args[1])) {
+    if (!IS_NUMBER(args[1]) || AS_NUMBER(args[1]) < 1) {
+      args[-1] = CSTRING_VAL("Error: Lx.loop.read max must be a positive number.");
+      return false;
+    }
+    max = AS_NUMBER(args[1]);
+  }
+  LoopOp op = { .kind = LOOP_OP_READ, .fd = fd, .readMax = (size_t)max, .data = NIL_VAL };
+  return loopOpNative(&op, args);
+}
+
+// Lx.loop.write(fd, data): writes all of a string or Bytes; returns the
+// byte count.
+static bool loopWriteNative(int argCount, Value *args) {
+  int fd;
+  if (!procFdArg("Lx.loop.write", argCount, args, &fd)) return false;
+  const uint8_t *bytes;
+  size_t length;
+  if (argCount < 2 || !byteView(args[1], &bytes, &length)) {
+    args[-1] = CSTRING_VAL("Error: Lx.loop.write takes a string or Bytes.");
+    return false;
+  }
+  LoopOp op = { .kind = LOOP_OP_WRITE, .fd = fd, .data = args[1] };
+  return loopOpNative(&op, args);
+}
+
+// Sockets made here are non-blocking and close-on-exec; every blocking step
+// goes through the event loop.
+static int netSocket(int family) {
+  int fd = socket(family, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return fd;
+}
+
+static bool netAddressArgs(const char *name, int argCount, Value *args,
+                           struct addrinfo **out, bool passive) {
+  if (argCount < 2 || !IS_STRING(args[0]) || !IS_NUMBER(args[1])) {
+    char message[128];
+    snprintf(message, sizeof(message), "Error: %s takes a host and a port.", name);
+    args[-1] = CSTRING_VAL(message);
+    return false;
+  }
+  char port[16];
+  snprintf(port, sizeof(port), "%d", (int)AS_NUMBER(args[1]));
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = passive ? AI_PASSIVE : 0;
+  int r = getaddrinfo(AS_CSTRING(args[0]), port, &hints, out);
+  if (r != 0) {
+    char message[256];
+    snprintf(message, sizeof(message), "Error: %s could not resolve %s: %s",
+             name, AS_CSTRING(args[0]), gai_strerror(r));
+    args[-1] = CSTRING_VAL(message);
+    return false;
+  }
+  return true;
+}
+
+static bool netErrno(const char *what, Value *args) {
+  char message[256];
+  snprintf(message, sizeof(message), "Error: %s failed: %s", what, strerror(errno));
+  args[-1] = CSTRING_VAL(message);
+  return false;
+}
+
+static bool netListenOn(int fd, struct sockaddr *addr, socklen_t addrLen, Value *args) {
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (bind(fd, addr, addrLen) != 0 || listen(fd, SOMAXCONN) != 0) {
+    bool ok = netErrno("listen()", args);
+    close(fd);
+    return ok;
+  }
+  args[-1] = NUMBER_VAL(fd);
+  return true;
+}
+
+// Lx.net.listen(host, port): a listening TCP socket fd (port 0 picks one,
+// see Lx.net.port).
+static bool netListenNative(int argCount, Value *args) {
+  struct addrinfo *info;
+  if (!netAddressArgs("Lx.net.listen", argCount, args, &info, true)) return false;
+  int fd = netSocket(info->ai_family);
+  if (fd < 0) {
+    freeaddrinfo(info);
+    return netErrno("socket()", args);
+  }
+  bool ok = netListenOn(fd, info->ai_addr, info->ai_addrlen, args);
+  freeaddrinfo(info);
+  return ok;
+}
+
+static bool netUnixAddress(const char *name, int argCount, Value *args,
+                           struct sockaddr_un *addr) {
+  if (argCount < 1 || !IS_STRING(args[0]) ||
+      AS_STRING(args[0])->length >= sizeof(addr->sun_path)) {
+    char message[128];
+    snprintf(message, sizeof(message), "Error: %s takes a socket path.", name);
+    args[-1] = CSTRING_VAL(message);
+    return false;
+  }
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  memcpy(addr->sun_path, AS_CSTRING(args[0]), AS_STRING(args[0])->length);
+  return true;
+}
+
+// Lx.net.listenUnix(path): a listening Unix domain socket fd.
+static bool netListenUnixNative(int argCount, Value *args) {
+  struct sockaddr_un addr;
+  if (!netUnixAddress("Lx.net.listenUnix", argCount, args, &addr)) return false;
+  int fd = netSocket(AF_UNIX);
+  if (fd < 0) return netErrno("socket()", args);
+  return netListenOn(fd, (struct sockaddr *)&addr, sizeof(addr), args);
+}
+
+static bool netConnectTo(int fd, struct sockaddr *addr, socklen_t addrLen, Value *args) {
+  if (connect(fd, addr, addrLen) == 0) {
+    args[-1] = NUMBER_VAL(fd);
+    return true;
+  }
+  if (errno != EINPROGRESS) {
+    bool ok = netErrno("connect()", args);
+    close(fd);
+    return ok;
+  }
+  LoopOp op = { .kind = LOOP_OP_CONNECT, .fd = fd, .data = NIL_VAL };
+  return loopOpNative(&op, args);
+}
+
+// Lx.net.connect(host, port): a connected TCP socket fd.
+static bool netConnectNative(int argCount, Value *args) {
+  struct addrinfo *info;
+  if (!netAddressArgs("Lx.net.connect", argCount, args, &info, false)) return false;
+  int fd = netSocket(info->ai_family);
+  if (fd < 0) {
+    freeaddrinfo(info);
+    return netErrno("socket()", args);
+  }
+  struct sockaddr_storage addr;
+  socklen_t addrLen = info->ai_addrlen;
+  memcpy(&addr, info->ai_addr, addrLen);
+  freeaddrinfo(info);
+  return netConnectTo(fd, (struct sockaddr *)&addr, addrLen, args);
+}
+
+// Lx.net.connectUnix(path): a connected Unix domain socket fd.
+static bool netConnectUnixNative(int argCount, Value *args) {
+  struct sockaddr_un addr;
+  if (!netUnixAddress("Lx.net.connectUnix", argCount, args, &addr)) return false;
+  int fd = netSocket(AF_UNIX);
+  if (fd < 0) return netErrno("socket()", args);
+  return netConnectTo(fd, (struct sockaddr *)&addr, sizeof(addr), args);
+}
+
+// Lx.net.accept(fd): the next connection on a listening socket.
+static bool netAcceptNative(int argCount, Value *args) {
+  int fd;
+  if (!procFdArg("Lx.net.accept", argCount, args, &fd)) return false;
+  LoopOp op = { .kind = LOOP_OP_ACCEPT, .fd = fd, .data = NIL_VAL };
+  return loopOpNative(&op, args);
+}
+
+// Lx.net.port(fd): the local port a TCP socket is bound to.
+static bool netPortNative(int argCount, Value *args) {
+  int fd;
+  if (!procFdArg("Lx.net.port", argCount, args, &fd)) return false;
+  struct sockaddr_storage addr;
+  socklen_t len = sizeof(addr);
+  if (getsockname(fd, (struct sockaddr *)&addr, &len) != 0) {
+    return netErrno("getsockname()", args);
+  }
+  int port = 0;
+  if (addr.ss_family == AF_INET) port = ntohs(((struct sockaddr_in *)&addr)->sin_port);
+  if (addr.ss_family == AF_INET6) port = ntohs(((struct sockaddr_in6 *)&addr)->sin6_port);
+  args[-1] = NUMBER_VAL(port);
+  return true;
+}
+
+static bool resolvePathFromCwd(const char* in, char* out, size_t outSize) {
+  if (in == NULL) return false;
+  if (out == NULL || outSize == 0) return false;
+
+  // Absolute paths are used as-is.
+  if (in[0] == '/') {
+    size_t n = strlen(in);
+    if (n + 1 > outSize) return false;
+    memcpy(out, in, n + 1);
+    return true;
+  }
+
+  char cwd[PATH_MAX + 1];
+  if (getcwd(cwd, sizeof(cwd)) == NULL) return false;
+
+  size_t cwdLen = strlen(cwd);
+  size_t inLen = strlen(in);
+
+  // Need: cwd + "/" + in + "\0"
+  if (cwdLen + 1 + inLen + 1 > outSize) return false;
+
+  memcpy(out, cwd, cwdLen);
+  if (cwdLen > 0 && cwd[cwdLen - 1] != '/') {
+    out[cwdLen] = '/';
+    memcpy(out + cwdLen + 1, in, inLen + 1);
+  } else {
+    memcpy(out + cwdLen, in, inLen + 1);
+  }
+
+  return true;
+}
+
+static bool slurpNative(int argCount, Value *args) {
+  if (argCount < 1 || !IS_STRING(args[0])) {
+    args[-1] = CSTRING_VAL("Error: slurp takes a string arg.");
+    return false;
+  }
+
+  const char* inPath = AS_STRING(args[0])->chars;
+  char path[PATH_MAX + 1] = "";
+  if (!resolvePathFromCwd(inPath, path, sizeof(path))) {
+    args[-1] = CSTRING_VAL("Error: invalid path.");
+    return false;
+  }
+
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    // XXX: more unified error reporting
+    fprintf(stderr, "Could not open file \"%s\".\n", path);
+    args[-1] = CSTRING_VAL("Error: failed to open file.");
+    return false;
+  }
+
+  fseek(file, 0L, SEEK_END);
+  size_t fileSize = ftell(file);
+  rewind(file);
+
+  char *buffer = (char *)malloc(fileSize + 1);
+  if (buffer == NULL) {
+    fprintf(stderr, "Not enough memory to read \"%s\".\n", path);
+    args[-1] = CSTRING_VAL("Error: failed to open file.");
+    fclose(file);
     return false;
   }
 
@@ -1455,8 +2362,11 @@ static bool slurpNative(int argCount, Value *args) {
 }
 
 static bool spitNative(int argCount, Value *args) {
-  if (argCount < 2 || !IS_STRING(args[0]) || !IS_STRING(args[1])) {
-    args[-1] = CSTRING_VAL("Error: spit takes a path and string content.");
+  const uint8_t *content;
+  size_t contentLength;
+  if (argCount < 2 || !IS_STRING(args[0]) ||
+      !byteView(args[1], &content, &contentLength)) {
+    args[-1] = CSTRING_VAL("Error: spit takes a path and string or Bytes content.");
     return false;
   }
 
@@ -1474,9 +2384,8 @@ static bool spitNative(int argCount, Value *args) {
     return false;
   }
 
-  ObjString *content = AS_STRING(args[1]);
-  size_t written = fwrite(content->chars, sizeof(char), content->length, file);
-  if (written < (size_t)content->length) {
+  size_t written = fwrite(content, sizeof(char), contentLength, file);
+  if (written < contentLength) {
     fprintf(stderr, "Could not write file \"%s\".\n", path);
     args[-1] = CSTRING_VAL("Error: failed to write file.");
     fclose(file);
@@ -1605,41 +2514,219 @@ static bool fsRealpathNative(int argCount, Value *args) {
   return true;
 }
 
-static bool tolowerNative(int argCount, Value *args) {
+// Creates path and any missing parents; an existing directory is fine.
+static bool fsMkdirNative(int argCount, Value *args) {
   if (argCount < 1 || !IS_STRING(args[0])) {
-    args[-1] = CSTRING_VAL("Error: tolower takes a string arg.");
+    args[-1] = CSTRING_VAL("Error: Lx.fs.mkdir takes a string path.");
     return false;
   }
-  ObjString *str = AS_STRING(args[0]);
-  char *s = (char *)malloc(str->length + 1);
-  if (s == NULL) {
-    args[-1] = CSTRING_VAL("Error: failed to allocate memory.");
+
+  char path[PATH_MAX + 1] = "";
+  if (!resolvePathFromCwd(AS_STRING(args[0])->chars, path, sizeof(path))) {
+    args[-1] = CSTRING_VAL("Error: invalid path.");
     return false;
   }
-  for (size_t i = 0; i < str->length; ++i) {
-    s[i] = tolower(str->chars[i]);
+
+  for (char* p = path + 1; ; p++) {
+    if (*p != '/' && *p != '\0') continue;
+    char saved = *p;
+    *p = '\0';
+    if (mkdir(path, 0777) != 0 && errno != EEXIST) {
+      args[-1] = CSTRING_VAL("Error: failed to create directory.");
+      return false;
+    }
+    *p = saved;
+    if (saved == '\0') break;
+  }
+
+  struct stat st;
+  if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+    args[-1] = CSTRING_VAL("Error: path exists and is not a directory.");
+    return false;
   }
-  args[-1] = OBJ_VAL(copyString(s, str->length));
-  free(s);
+  args[-1] = BOOL_VAL(true);
   return true;
 }
 
-static bool toupperNative(int argCount, Value *args) {
+// Atomically replaces `to` when both paths are on the same filesystem.
+static bool fsRenameNative(int argCount, Value *args) {
+  if (argCount < 2 || !IS_STRING(args[0]) || !IS_STRING(args[1])) {
+    args[-1] = CSTRING_VAL("Error: Lx.fs.rename takes two string paths.");
+    return false;
+  }
+
+  char from[PATH_MAX + 1] = "";
+  char to[PATH_MAX + 1] = "";
+  if (!resolvePathFromCwd(AS_STRING(args[0])->chars, from, sizeof(from)) ||
+      !resolvePathFromCwd(AS_STRING(args[1])->chars, to, sizeof(to))) {
+    args[-1] = CSTRING_VAL("Error: invalid path.");
+    return false;
+  }
+
+  if (rename(from, to) != 0) {
+    args[-1] = CSTRING_VAL("Error: failed to rename file.");
+    return false;
+  }
+  args[-1] = BOOL_VAL(true);
+  return true;
+}
+
+static bool fsRemoveNative(int argCount, Value *args) {
   if (argCount < 1 || !IS_STRING(args[0])) {
-    args[-1] = CSTRING_VAL("Error: toupper takes a string arg.");
+    args[-1] = CSTRING_VAL("Error: Lx.fs.remove takes a string path.");
     return false;
   }
-  ObjString *str = AS_STRING(args[0]);
-  char *s = (char *)malloc(str->length + 1);
-  if (s == NULL) {
-    args[-1] = CSTRING_VAL("Error: failed to allocate memory.");
+
+  char path[PATH_MAX + 1] = "";
+  if (!resolvePathFromCwd(AS_STRING(args[0])->chars, path, sizeof(path))) {
+    args[-1] = BOOL_VAL(false);
+    return true;
+  }
+
+  if (unlink(path) != 0) {
+    if (errno == ENOENT) {
+      args[-1] = BOOL_VAL(false);
+      return true;
+    }
+    args[-1] = CSTRING_VAL("Error: failed to remove file.");
     return false;
   }
-  for (size_t i = 0; i < str->length; ++i) {
-    s[i] = toupper(str->chars[i]);
+  args[-1] = BOOL_VAL(true);
+  return true;
+}
+
+// Buffered file handles (see file.h). A handle is a number, like the fds
+// Lx.proc and Lx.net hand out, but it must go through Lx.fs.close.
+
+static bool fsHandleArg(const char *name, int argCount, Value *args, int *handle) {
+  if (argCount < 1 || !IS_NUMBER(args[0]) || AS_NUMBER(args[0]) < 0 ||
+      AS_NUMBER(args[0]) != trunc(AS_NUMBER(args[0]))) {
+    char message[96];
+    snprintf(message, sizeof(message), "Error: %s takes a file handle.", name);
+    args[-1] = OBJ_VAL(copyString(message, strlen(message)));
+    return false;
   }
-  args[-1] = OBJ_VAL(copyString(s, str->length));
-  free(s);
+  *handle = (int)AS_NUMBER(args[0]);
+  return true;
+}
+
+// Lx.fs.open(path, mode = "r"): a buffered file handle.
+static bool fsOpenNative(int argCount, Value *args) {
+  if (argCount < 1 || !IS_STRING(args[0]) || (argCount > 1 && !IS_STRING(args[1]))) {
+    args[-1] = CSTRING_VAL("Error: Lx.fs.open takes a path and an optional mode string.");
+    return false;
+  }
+  char path[PATH_MAX + 1] = "";
+  if (!resolvePathFromCwd(AS_STRING(args[0])->chars, path, sizeof(path))) {
+    args[-1] = CSTRING_VAL("Error: invalid path.");
+    return false;
+  }
+  const char *error;
+  int handle = fileOpen(path, argCount > 1 ? AS_STRING(args[1])->chars : "r", &error);
+  if (handle < 0) {
+    args[-1] = CSTRING_VAL(error);
+    return false;
+  }
+  args[-1] = NUMBER_VAL(handle);
+  return true;
+}
+
+static bool fsReadLineNative(int argCount, Value *args) {
+  int handle;
+  if (!fsHandleArg("Lx.fs.readLine", argCount, args, &handle)) return false;
+  const char *error;
+  if (!fileReadLine(handle, &args[-1], &error)) {
+    args[-1] = CSTRING_VAL(error);
+    return false;
+  }
+  return true;
+}
+
+// Lx.fs.readChunk(handle, n = 65536)
+static bool fsReadChunkNative(int argCount, Value *args) {
+  int handle;
+  if (!fsHandleArg("Lx.fs.readChunk", argCount, args, &handle)) return false;
+  size_t max = 65536;
+  if (argCount > 1) {
+    if (!IS_NUMBER(args[1]) || AS_NUMBER(args[1]) < 1) {
+      args[-1] = CSTRING_VAL("Error: Lx.fs.readChunk size must be a positive number.");
+      return false;
+    }
+    max = AS_NUMBER(args[1]) >= (double)INT_MAX ? (size_t)INT_MAX : (size_t)AS_NUMBER(args[1]);
+  }
+  const char *error;
+  if (!fileReadChunk(handle, max, &args[-1], &error)) {
+    args[-1] = CSTRING_VAL(error);
+    return false;
+  }
+  return true;
+}
+
+static bool fsWriteNative(int argCount, Value *args) {
+  int handle;
+  if (!fsHandleArg("Lx.fs.write", argCount, args, &handle)) return false;
+  const uint8_t *bytes;
+  size_t length;
+  if (argCount < 2 || !byteView(args[1], &bytes, &length)) {
+    args[-1] = CSTRING_VAL("Error: Lx.fs.write takes a string or Bytes.");
+    return false;
+  }
+  const char *error;
+  if (!fileWrite(handle, bytes, length, &error)) {
+    args[-1] = CSTRING_VAL(error);
+    return false;
+  }
+  args[-1] = NIL_VAL;
+  return true;
+}
+
+static bool fsFlushNative(int argCount, Value *args) {
+  int handle;
+  if (!fsHandleArg("Lx.fs.flush", argCount, args, &handle)) return false;
+  const char *error;
+  if (!fileFlush(handle, &error)) {
+    args[-1] = CSTRING_VAL(error);
+    return false;
+  }
+  args[-1] = NIL_VAL;
+  return true;
+}
+
+static bool fsCloseNative(int argCount, Value *args) {
+  int handle;
+  if (!fsHandleArg("Lx.fs.close", argCount, args, &handle)) return false;
+  const char *error;
+  if (!fileClose(handle, &error)) {
+    args[-1] = CSTRING_VAL(error);
+    return false;
+  }
+  args[-1] = NIL_VAL;
+  return true;
+}
+
+static bool tolowerNative(int argCount, Value *args) {
+  if (argCount < 1 || !IS_STRING(args[0])) {
+    args[-1] = CSTRING_VAL("Error: tolower takes a string arg.");
+    return false;
+  }
+  ObjString *str = AS_STRING(args[0]);
+  char *s = ALLOCATE(char, str->length + 1);
+  textLower(s, str->chars, str->length);
+  s[str->length] = '\0';
+  args[-1] = OBJ_VAL(takeString(s, (int)str->length));
+  return true;
+}
+
+static bool toupperNative(int argCount, Value *args) {
+  if (argCount < 1 || !IS_STRING(args[0])) {
+    args[-1] = CSTRING_VAL("Error: toupper takes a string arg.");
+    return false;
+  }
+  ObjString *str = AS_STRING(args[0]);
+  char *s = ALLOCATE(char, str->length + 1);
+  textUpper(s, str->chars, str->length);
+  s[str->length] = '\0';
+  args[-1] = OBJ_VAL(takeString(s, (int)str->length));
   return true;
 }
 
@@ -1688,6 +2775,226 @@ static bool doubleToUint8ArrayNative(int argCount, Value *args) {
   return true;
 }
 
+// ---- Lx.bytes: little-endian access to Bytes buffers ----
+
+static bool bytesOffsetArg(const char *name, int argCount, Value *args,
+                           ObjTypedArray **buffer, int *offset) {
+  if (argCount < 2 || !IS_BYTES(args[0]) || !IS_NUMBER(args[1])) {
+    char buf[96];
+    snprintf(buf, sizeof(buf), "Error: Lx.bytes.%s takes Bytes and an offset.", name);
+    args[-1] = CSTRING_VAL(buf);
+    return false;
+  }
+  double raw = AS_NUMBER(args[1]);
+  if (!isIntIndex(raw)) {
+    args[-1] = CSTRING_VAL("Error: Bytes offset must be a non-negative integer.");
+    return false;
+  }
+  *buffer = AS_TYPED_ARRAY(args[0]);
+  *offset = (int)raw;
+  return true;
+}
+
+// Reads need [offset, offset + size) in bounds.
+static uint8_t *bytesReadAt(const char *name, int argCount, Value *args,
+                            int size) {
+  ObjTypedArray *buffer;
+  int offset;
+  if (!bytesOffsetArg(name, argCount, args, &buffer, &offset)) return NULL;
+  if (offset > buffer->count - size) {
+    args[-1] = CSTRING_VAL("Error: Bytes read out of bounds.");
+    return NULL;
+  }
+  return buffer->as.u8 + offset;
+}
+
+// Writes may start anywhere up to the current length and extend the buffer.
+static uint8_t *bytesWriteAt(ObjTypedArray *buffer, int offset, int size,
+                             Value *args) {
+  if (offset > buffer->count) {
+    args[-1] = CSTRING_VAL("Error: Bytes write past the end.");
+    return NULL;
+  }
+  if (offset + size > buffer->count) {
+    typedArrayReserve(buffer, offset + size);
+    buffer->count = offset + size;
+  }
+  return buffer->as.u8 + offset;
+}
+
+static uint32_t bytesIntegerBits(Value value) {
+  return IS_FIXNUM(value) ? (uint32_t)AS_FIXNUM(value)
+                          : doubleToUint32Bits(AS_NUMBER(value));
+}
+
+static void storeLittleEndian(uint8_t *out, uint32_t bits, int size) {
+  for (int i = 0; i < size; i++) {
+    out[i] = (uint8_t)(bits >> (8 * i));
+  }
+}
+
+static bool bytesWriteNumber(const char *name, int size, Value *args,
+                             ObjTypedArray *buffer, int offset, Value value) {
+  if (!IS_NUMBER(value)) {
+    char buf[96];
+    snprintf(buf, sizeof(buf), "Error: Lx.bytes.%s value must be a number.", name);
+    args[-1] = CSTRING_VAL(buf);
+    return false;
+  }
+  uint8_t *out = bytesWriteAt(buffer, offset, size, args);
+  if (out == NULL) return false;
+  if (size == 8) {
+    double number = AS_NUMBER(value);
+    memcpy(out, &number, sizeof(double));
+  } else {
+    storeLittleEndian(out, bytesIntegerBits(value), size);
+  }
+  args[-1] = NIL_VAL;
+  return true;
+}
+
+#define BYTES_WRITE_NATIVE(fnName, name, size)                                \
+  static bool fnName(int argCount, Value *args) {                             \
+    ObjTypedArray *buffer;                                                    \
+    int offset;                                                               \
+    if (!bytesOffsetArg(name, argCount, args, &buffer, &offset)) return false; \
+    Value value = argCount > 2 ? args[2] : NIL_VAL;                           \
+    return bytesWriteNumber(name, size, args, buffer, offset, value); \
+  }
+
+#define BYTES_APPEND_NATIVE(fnName, name, size)                               \
+  static bool fnName(int argCount, Value *args) {                             \
+    if (argCount < 1 || !IS_BYTES(args[0])) {                                 \
+      args[-1] = CSTRING_VAL("Error: Lx.bytes." name " takes Bytes and a number."); \
+      return false;                                                           \
+    }                                                                         \
+    ObjTypedArray *buffer = AS_TYPED_ARRAY(args[0]);                          \
+    Value value = argCount > 1 ? args[1] : NIL_VAL;                           \
+    return bytesWriteNumber(name, size, args, buffer, buffer->count, value); \
+  }
+
+BYTES_WRITE_NATIVE(bytesWriteU8Native, "writeU8", 1)
+BYTES_WRITE_NATIVE(bytesWriteU16Native, "writeU16", 2)
+BYTES_WRITE_NATIVE(bytesWriteU32Native, "writeU32", 4)
+BYTES_WRITE_NATIVE(bytesWriteF64Native, "writeF64", 8)
+BYTES_APPEND_NATIVE(bytesAppendU16Native, "appendU16", 2)
+BYTES_APPEND_NATIVE(bytesAppendU32Native, "appendU32", 4)
+BYTES_APPEND_NATIVE(bytesAppendF64Native, "appendF64", 8)
+
+#undef BYTES_WRITE_NATIVE
+#undef BYTES_APPEND_NATIVE
+
+static uint32_t loadLittleEndian(const uint8_t *in, int size) {
+  uint32_t bits = 0;
+  for (int i = 0; i < size; i++) {
+    bits |= (uint32_t)in[i] << (8 * i);
+  }
+  return bits;
+}
+
+static bool bytesReadU8Native(int argCount, Value *args) {
+  uint8_t *in = bytesReadAt("readU8", argCount, args, 1);
+  if (in == NULL) return false;
+  args[-1] = FIXNUM_VAL(in[0]);
+  return true;
+}
+
+static bool bytesReadU16Native(int argCount, Value *args) {
+  uint8_t *in = bytesReadAt("readU16", argCount, args, 2);
+  if (in == NULL) return false;
+  args[-1] = FIXNUM_VAL(loadLittleEndian(in, 2));
+  return true;
+}
+
+static bool bytesReadU32Native(int argCount, Value *args) {
+  uint8_t *in = bytesReadAt("readU32", argCount, args, 4);
+  if (in == NULL) return false;
+  args[-1] = FIXNUM_VAL(loadLittleEndian(in, 4));
+  return true;
+}
+
+static bool bytesReadI32Native(int argCount, Value *args) {
+  uint8_t *in = bytesReadAt("readI32", argCount, args, 4);
+  if (in == NULL) return false;
+  args[-1] = FIXNUM_VAL((int32_t)loadLittleEndian(in, 4));
+  return true;
+}
+
+static bool bytesReadF64Native(int argCount, Value *args) {
+  uint8_t *in = bytesReadAt("readF64", argCount, args, 8);
+  if (in == NULL) return false;
+  double number;
+  memcpy(&number, in, sizeof(double));
+  args[-1] = NUMBER_VAL(number);
+  return true;
+}
+
+// Lx.bytes.readString(b, offset, length) -> String
+static bool bytesReadStringNative(int argCount, Value *args) {
+  if (argCount < 3 || !IS_NUMBER(args[2])) {
+    args[-1] = CSTRING_VAL("Error: Lx.bytes.readString takes Bytes, an offset and a length.");
+    return false;
+  }
+  if (!isIntIndex(AS_NUMBER(args[2]))) {
+    args[-1] = CSTRING_VAL("Error: Bytes length must be a non-negative integer.");
+    return false;
+  }
+  int length = (int)AS_NUMBER(args[2]);
+  uint8_t *in = bytesReadAt("readString", argCount, args, length);
+  if (in == NULL) return false;
+  args[-1] = OBJ_VAL(copyString((const char *)in, (size_t)length));
+  return true;
+}
+
+// Lx.bytes.append(b, data): append a byte (number), or every byte of a
+// string, Bytes, Uint8Array or array of numbers.
+static bool bytesAppendNative(int argCount, Value *args) {
+  if (argCount < 2 || !IS_BYTES(args[0])) {
+    args[-1] = CSTRING_VAL("Error: Lx.bytes.append takes Bytes and data.");
+    return false;
+  }
+  ObjTypedArray *buffer = AS_TYPED_ARRAY(args[0]);
+  Value data = args[1];
+
+  if (IS_NUMBER(data)) {
+    return bytesWriteNumber("append", 1, args, buffer, buffer->count, data);
+  }
+
+  const uint8_t *bytes;
+  size_t length;
+  if (byteView(data, &bytes, &length)) {
+    // Reserve first: appending a buffer to itself must not read moved storage.
+    int start = buffer->count;
+    typedArrayReserve(buffer, start + (int)length);
+    byteView(data, &bytes, &length);
+    memcpy(buffer->as.u8 + start, bytes, length);
+    buffer->count = start + (int)length;
+    args[-1] = NIL_VAL;
+    return true;
+  }
+
+  if (IS_ARRAY(data)) {
+    ValueArray *input = &AS_ARRAY(data);
+    for (int i = 0; i < input->count; i++) {
+      if (!IS_NUMBER(input->values[i])) {
+        args[-1] = CSTRING_VAL("Error: Lx.bytes.append array must contain only numbers.");
+        return false;
+      }
+    }
+    int start = buffer->count;
+    typedArrayReserve(buffer, start + input->count);
+    for (int i = 0; i < input->count; i++) {
+      buffer->as.u8[start + i] = (uint8_t)bytesIntegerBits(input->values[i]);
+    }
+    buffer->count = start + input->count;
+    args[-1] = NIL_VAL;
+    return true;
+  }
+
+  args[-1] = CSTRING_VAL("Error: Lx.bytes.append data must be a number, string, Bytes or array.");
+  return false;
+}
+
 static bool lxErrorNative(int argCount, Value *args) {
   if (argCount < 1) {
     runtimeError("Error");
@@ -1703,26 +3010,54 @@ static bool lxErrorNative(int argCount, Value *args) {
   return false;
 }
 
-// Lx.zlib.deflate(data: Array[Number]) -> Array[Number]
-// Compress byte array using zlib deflate
-static bool zlibDeflateNative(int argCount, Value *args) {
-  if (argCount < 1 || !IS_ARRAY(args[0])) {
-    args[-1] = CSTRING_VAL("Error: Lx.zlib.deflate requires an array of bytes");
-    return false;
-  }
-
-  ValueArray input = AS_ARRAY(args[0]);
-  size_t inputLen = input.count;
-
-  // Convert lx array to uint8_t buffer
-  uint8_t* inputBuf = ALLOCATE(uint8_t, inputLen);
-  for (size_t i = 0; i < inputLen; i++) {
+// Resolve a zlib input argument to raw bytes. Strings and Bytes are used in
+// place; number arrays are copied into *owned (caller frees with FREE_ARRAY).
+static bool zlibInput(Value value, const uint8_t **bytes, size_t *length,
+                      uint8_t **owned) {
+  *owned = NULL;
+  if (byteView(value, bytes, length)) return true;
+  if (!IS_ARRAY(value)) return false;
+
+  ValueArray input = AS_ARRAY(value);
+  uint8_t *buffer = ALLOCATE(uint8_t, input.count);
+  for (int i = 0; i < input.count; i++) {
     if (!IS_NUMBER(input.values[i])) {
-      FREE_ARRAY(uint8_t, inputBuf, inputLen);
-      args[-1] = CSTRING_VAL("Error: array must contain only numbers");
+      FREE_ARRAY(uint8_t, buffer, input.count);
       return false;
     }
-    inputBuf[i] = (uint8_t)AS_NUMBER(input.values[i]);
+    buffer[i] = (uint8_t)AS_NUMBER(input.values[i]);
+  }
+  *owned = buffer;
+  *bytes = buffer;
+  *length = (size_t)input.count;
+  return true;
+}
+
+// zlib outputs mirror their input: Bytes in, Bytes out; arrays stay arrays.
+static Value zlibOutput(bool asBytes, const uint8_t *bytes, size_t length) {
+  if (asBytes) {
+    ObjTypedArray *output = newTypedArray(TYPED_BYTES, (int)length);
+    if (length > 0) memcpy(output->as.u8, bytes, length);
+    return OBJ_VAL(output);
+  }
+  ObjArray *output = newArray();
+  push(OBJ_VAL(output));
+  for (size_t i = 0; i < length; i++) {
+    writeValueArray(&output->array, NUMBER_VAL(bytes[i]));
+  }
+  pop();
+  return OBJ_VAL(output);
+}
+
+// Lx.zlib.deflate(data: Bytes | Array[Number]) -> Bytes | Array[Number]
+// Compress byte array using zlib deflate
+static bool zlibDeflateNative(int argCount, Value *args) {
+  const uint8_t *inputBuf;
+  size_t inputLen;
+  uint8_t *owned;
+  if (argCount < 1 || !zlibInput(args[0], &inputBuf, &inputLen, &owned)) {
+    args[-1] = CSTRING_VAL("Error: Lx.zlib.deflate requires Bytes or an array of bytes");
+    return false;
   }
 
   // Calculate max compressed size
@@ -1732,7 +3067,7 @@ static bool zlibDeflateNative(int argCount, Value *args) {
 
   // Compress (compressedLen is modified to actual output size)
   int result = compress2(compressedBuf, &compressedLen, inputBuf, inputLen, Z_DEFAULT_COMPRESSION);
-  FREE_ARRAY(uint8_t, inputBuf, inputLen);
+  if (owned) FREE_ARRAY(uint8_t, owned, inputLen);
 
   if (result != Z_OK) {
     FREE_ARRAY(uint8_t, compressedBuf, compressedCap);
@@ -1740,39 +3075,21 @@ static bool zlibDeflateNative(int argCount, Value *args) {
     return false;
   }
 
-  // Convert to lx array
-  ObjArray* output = newArray();
-  push(OBJ_VAL(output));
-  for (size_t i = 0; i < compressedLen; i++) {
-    writeValueArray(&output->array, NUMBER_VAL(compressedBuf[i]));
-  }
-  args[-1] = OBJ_VAL(output);
-  pop();
+  args[-1] = zlibOutput(!IS_ARRAY(args[0]), compressedBuf, compressedLen);
 
   FREE_ARRAY(uint8_t, compressedBuf, compressedCap);
   return true;
 }
 
-// Lx.zlib.inflate(data: Array[Number]) -> Array[Number]
+// Lx.zlib.inflate(data: Bytes | Array[Number]) -> Bytes | Array[Number]
 // Decompress byte array using zlib inflate
-static bool zlibInflateNative(int argCount, Value *args) {
-  if (argCount < 1 || !IS_ARRAY(args[0])) {
-    args[-1] = CSTRING_VAL("Error: Lx.zlib.inflate requires an array of bytes");
-    return false;
-  }
-
-  ValueArray input = AS_ARRAY(args[0]);
-  size_t inputLen = input.count;
-
-  // Convert lx array to uint8_t buffer
-  uint8_t* inputBuf = ALLOCATE(uint8_t, inputLen);
-  for (size_t i = 0; i < inputLen; i++) {
-    if (!IS_NUMBER(input.values[i])) {
-      FREE_ARRAY(uint8_t, inputBuf, inputLen);
-      args[-1] = CSTRING_VAL("Error: array must contain only numbers");
-      return false;
-    }
-    inputBuf[i] = (uint8_t)AS_NUMBER(input.values[i]);
+static bool zlibInflateNative(int argCount, Value *args) {
+  const uint8_t *inputBuf;
+  size_t inputLen;
+  uint8_t *owned;
+  if (argCount < 1 || !zlibInput(args[0], &inputBuf, &inputLen, &owned)) {
+    args[-1] = CSTRING_VAL("Error: Lx.zlib.inflate requires Bytes or an array of bytes");
+    return false;
   }
 
   // Start with a reasonable buffer size and grow if needed
@@ -1797,7 +3114,7 @@ static bool zlibInflateNative(int argCount, Value *args) {
     cap *= 2;
   }
 
-  FREE_ARRAY(uint8_t, inputBuf, inputLen);
+  if (owned) FREE_ARRAY(uint8_t, owned, inputLen);
 
   if (result != Z_OK) {
     if (uncompressedBuf) FREE_ARRAY(uint8_t, uncompressedBuf, cap);
@@ -1805,63 +3122,403 @@ static bool zlibInflateNative(int argCount, Value *args) {
     return false;
   }
 
-  // Convert to lx array (use outLen = actual decompressed size)
-  ObjArray* output = newArray();
-  push(OBJ_VAL(output));
-  for (size_t i = 0; i < outLen; i++) {
-    writeValueArray(&output->array, NUMBER_VAL(uncompressedBuf[i]));
-  }
-  args[-1] = OBJ_VAL(output);
-  pop();
+  // outLen = actual decompressed size
+  args[-1] = zlibOutput(!IS_ARRAY(args[0]), uncompressedBuf, outLen);
 
   FREE_ARRAY(uint8_t, uncompressedBuf, cap); // Free with allocated capacity
   return true;
 }
 
-// Lx.zlib.crc32(data: String | Array[Number]) -> Number
+// Lx.zlib.crc32(data: String | Bytes | Array[Number]) -> Number
 // Calculate CRC32 checksum of string or byte array
 static bool zlibCrc32Native(int argCount, Value *args) {
-  if (argCount < 1) {
-    args[-1] = CSTRING_VAL("Error: Lx.zlib.crc32 requires a string or array of bytes");
+  const uint8_t *inputBuf;
+  size_t inputLen;
+  uint8_t *owned;
+  if (argCount < 1 || !zlibInput(args[0], &inputBuf, &inputLen, &owned)) {
+    args[-1] = CSTRING_VAL("Error: Lx.zlib.crc32 requires a string, Bytes or array of bytes");
     return false;
   }
 
   uLong crc = crc32(0L, Z_NULL, 0);
+  crc = crc32(crc, inputBuf, inputLen);
+  if (owned) FREE_ARRAY(uint8_t, owned, inputLen);
 
-  // Handle string input
-  if (IS_STRING(args[0])) {
-    ObjString* str = AS_STRING(args[0]);
-    crc = crc32(crc, (const uint8_t*)str->chars, str->length);
-    args[-1] = NUMBER_VAL((double)crc);
-    return true;
+  args[-1] = NUMBER_VAL((double)crc);
+  return true;
+}
+
+// Lx.json.parse(text: String | Bytes) -> Any
+static bool jsonParseNative(int argCount, Value *args) {
+  const uint8_t *bytes;
+  size_t length;
+  if (argCount < 1 || !byteView(args[0], &bytes, &length)) {
+    args[-1] = CSTRING_VAL("Error: Lx.json.parse takes a string or Bytes.");
+    return false;
+  }
+  const char *error;
+  if (!jsonParse(bytes, length, &args[-1], &error)) {
+    args[-1] = CSTRING_VAL(error);
+    return false;
   }
+  return true;
+}
 
-  // Handle array of bytes input
-  if (!IS_ARRAY(args[0])) {
-    args[-1] = CSTRING_VAL("Error: Lx.zlib.crc32 requires a string or array of bytes");
+// Lx.json.stringify(value: Any, indent?: Number) -> String
+static bool jsonStringifyNative(int argCount, Value *args) {
+  if (argCount < 1) {
+    args[-1] = CSTRING_VAL("Error: Lx.json.stringify takes a value.");
+    return false;
+  }
+  int indent = 0;
+  if (argCount >= 2 && !IS_NIL(args[1])) {
+    if (!IS_NUMBER(args[1]) || AS_NUMBER(args[1]) < 0 || AS_NUMBER(args[1]) > 10) {
+      args[-1] = CSTRING_VAL("Error: Lx.json.stringify indent must be a number from 0 to 10.");
+      return false;
+    }
+    indent = (int)AS_NUMBER(args[1]);
+  }
+  const char *error;
+  if (!jsonStringify(args[0], indent, &args[-1], &error)) {
+    args[-1] = CSTRING_VAL(error);
+    return false;
+  }
+  return true;
+}
+
+// Lx.scan(source: String) -> Map
+static bool scanNative(int argCount, Value *args) {
+  if (argCount < 1 || !IS_STRING(args[0])) {
+    args[-1] = CSTRING_VAL("Error: Lx.scan takes a source string.");
     return false;
   }
+  ObjString *source = AS_STRING(args[0]);
+  args[-1] = scanSource(source->chars, (size_t)source->length);
+  return true;
+}
+
+// Compiled pattern for a Lx.re argument: a pattern string, or a map made by
+// Lx.re.compile. Returns NULL with *error set otherwise.
+static Regex *regexArg(Value pattern, Value *error, const char *usage) {
+  if (IS_HASHMAP(pattern)) {
+    tableGet(&AS_HASHMAP(pattern), CSTRING_VAL("pattern"), &pattern);
+  }
+  if (!IS_STRING(pattern)) {
+    *error = CSTRING_VAL(usage);
+    return NULL;
+  }
+  const char *message;
+  Regex *re = regexGet(AS_STRING(pattern)->chars, (size_t)AS_STRING(pattern)->length, &message);
+  if (re == NULL) *error = CSTRING_VAL(message);
+  return re;
+}
 
-  ValueArray input = AS_ARRAY(args[0]);
-  size_t inputLen = input.count;
+static void setRegexField(Table *table, const char *name, Value value) {
+  push(value);
+  push(CSTRING_VAL(name));
+  tableSet(table, vm.stackTop[-1], vm.stackTop[-2]);
+  pop();
+  pop();
+}
 
-  // Convert lx array to uint8_t buffer
-  uint8_t* inputBuf = ALLOCATE(uint8_t, inputLen);
-  for (size_t i = 0; i < inputLen; i++) {
-    if (!IS_NUMBER(input.values[i])) {
-      FREE_ARRAY(uint8_t, inputBuf, inputLen);
-      args[-1] = CSTRING_VAL("Error: array must contain only numbers");
-      return false;
+// .{ start, end, text, groups, named? } for one match of `subject`. groups[0]
+// is the whole match; groups that did not take part are nil.
+static Value regexMatchValue(Regex *re, ObjString *subject, const size_t *slots) {
+  ObjHashmap *match = newHashmap();
+  push(OBJ_VAL(match));
+  push(OBJ_VAL(newArray()));
+  ObjHashmap *named = NULL;
+  for (int i = 0; i <= regexGroupCount(re); i++) {
+    size_t start = slots[i * 2];
+    push(start == REGEX_UNSET
+             ? NIL_VAL
+             : OBJ_VAL(copyString(subject->chars + start, (int)(slots[i * 2 + 1] - start))));
+    writeValueArray(&AS_ARRAY(vm.stackTop[-2]), vm.stackTop[-1]);
+    const char *name = regexGroupName(re, i);
+    if (name != NULL) {
+      if (named == NULL) {
+        named = newHashmap();
+        setRegexField(&match->table, "named", OBJ_VAL(named));
+      }
+      setRegexField(&named->table, name, vm.stackTop[-1]);
     }
-    inputBuf[i] = (uint8_t)AS_NUMBER(input.values[i]);
+    pop();
   }
+  setRegexField(&match->table, "text", AS_ARRAY(vm.stackTop[-1]).values[0]);
+  setRegexField(&match->table, "groups", pop());
+  setRegexField(&match->table, "start", FIXNUM_VAL((int64_t)slots[0]));
+  setRegexField(&match->table, "end", FIXNUM_VAL((int64_t)slots[1]));
+  return pop();
+}
 
-  // Calculate CRC32
-  crc = crc32(crc, inputBuf, inputLen);
+// Steps through the matches of findAll, split and replace. As in Go, an
+// empty match right after the previous match is skipped, so "a*" over "baa"
+// yields "", "aa" and not another "" at the end of "aa".
+static bool regexNext(Regex *re, ObjString *subject, size_t *from, size_t *lastEnd,
+                      size_t *slots) {
+  size_t length = (size_t)subject->length;
+  while (*from <= length && regexFind(re, subject->chars, length, *from, slots)) {
+    size_t start = slots[0];
+    size_t end = slots[1];
+    size_t step = 1;
+    if (end < length) {
+      uint8_t lead = (uint8_t)subject->chars[end];
+      step = lead >= 0xf0 ? 4 : lead >= 0xe0 ? 3 : lead >= 0xc0 ? 2 : 1;
+      if (end + step > length) step = length - end;
+    }
+    *from = end > start ? end : end + step;
+    if (start == end && start == *lastEnd) continue;
+    *lastEnd = end;
+    return true;
+  }
+  return false;
+}
 
-  FREE_ARRAY(uint8_t, inputBuf, inputLen);
+// Lx.re.compile(pattern: String) -> Map
+static bool reCompileNative(int argCount, Value *args) {
+  const char *usage = "Error: Lx.re.compile takes a pattern string.";
+  if (argCount < 1) {
+    args[-1] = CSTRING_VAL(usage);
+    return false;
+  }
+  Regex *re = regexArg(args[0], &args[-1], usage);
+  if (re == NULL) return false;
+  if (IS_HASHMAP(args[0])) {
+    args[-1] = args[0];
+    return true;
+  }
+  ObjHashmap *compiled = newHashmap();
+  args[-1] = OBJ_VAL(compiled);
+  setRegexField(&compiled->table, "pattern", args[0]);
+  setRegexField(&compiled->table, "groups", FIXNUM_VAL(regexGroupCount(re)));
+  return true;
+}
 
-  args[-1] = NUMBER_VAL((double)crc);
+// Lx.re.match(pattern, s: String) -> Bool
+static bool reMatchNative(int argCount, Value *args) {
+  const char *usage = "Error: Lx.re.match takes a pattern and a string.";
+  if (argCount < 2 || !IS_STRING(args[1])) {
+    args[-1] = CSTRING_VAL(usage);
+    return false;
+  }
+  Regex *re = regexArg(args[0], &args[-1], usage);
+  if (re == NULL) return false;
+  ObjString *subject = AS_STRING(args[1]);
+  args[-1] = BOOL_VAL(regexTest(re, subject->chars, (size_t)subject->length));
+  return true;
+}
+
+// Lx.re.find(pattern, s: String, from?: Number) -> Map | nil
+static bool reFindNative(int argCount, Value *args) {
+  const char *usage = "Error: Lx.re.find takes a pattern, a string and an optional offset.";
+  if (argCount < 2 || !IS_STRING(args[1]) ||
+      (argCount >= 3 && !IS_NIL(args[2]) && !IS_NUMBER(args[2]))) {
+    args[-1] = CSTRING_VAL(usage);
+    return false;
+  }
+  Regex *re = regexArg(args[0], &args[-1], usage);
+  if (re == NULL) return false;
+  ObjString *subject = AS_STRING(args[1]);
+  size_t from = 0;
+  if (argCount >= 3 && IS_NUMBER(args[2]) && AS_NUMBER(args[2]) > 0) {
+    double offset = AS_NUMBER(args[2]);
+    from = offset > subject->length ? (size_t)subject->length + 1 : (size_t)offset;
+  }
+  size_t slots[(regexGroupCount(re) + 1) * 2];
+  if (!regexFind(re, subject->chars, (size_t)subject->length, from, slots)) {
+    args[-1] = NIL_VAL;
+    return true;
+  }
+  args[-1] = regexMatchValue(re, subject, slots);
+  return true;
+}
+
+// Lx.re.findAll(pattern, s: String) -> Array
+static bool reFindAllNative(int argCount, Value *args) {
+  const char *usage = "Error: Lx.re.findAll takes a pattern and a string.";
+  if (argCount < 2 || !IS_STRING(args[1])) {
+    args[-1] = CSTRING_VAL(usage);
+    return false;
+  }
+  Regex *re = regexArg(args[0], &args[-1], usage);
+  if (re == NULL) return false;
+  ObjString *subject = AS_STRING(args[1]);
+  args[-1] = OBJ_VAL(newArray());
+  size_t slots[(regexGroupCount(re) + 1) * 2];
+  size_t from = 0, lastEnd = REGEX_UNSET;
+  while (regexNext(re, subject, &from, &lastEnd, slots)) {
+    push(regexMatchValue(re, subject, slots));
+    writeValueArray(&AS_ARRAY(args[-1]), vm.stackTop[-1]);
+    pop();
+  }
+  return true;
+}
+
+// Lx.re.split(pattern, s: String) -> Array
+static bool reSplitNative(int argCount, Value *args) {
+  const char *usage = "Error: Lx.re.split takes a pattern and a string.";
+  if (argCount < 2 || !IS_STRING(args[1])) {
+    args[-1] = CSTRING_VAL(usage);
+    return false;
+  }
+  Regex *re = regexArg(args[0], &args[-1], usage);
+  if (re == NULL) return false;
+  ObjString *subject = AS_STRING(args[1]);
+  args[-1] = OBJ_VAL(newArray());
+  size_t slots[(regexGroupCount(re) + 1) * 2];
+  size_t from = 0, lastEnd = REGEX_UNSET, pieceStart = 0;
+  for (;;) {
+    bool found = regexNext(re, subject, &from, &lastEnd, slots);
+    size_t pieceEnd = found ? slots[0] : (size_t)subject->length;
+    push(OBJ_VAL(copyString(subject->chars + pieceStart, (int)(pieceEnd - pieceStart))));
+    writeValueArray(&AS_ARRAY(args[-1]), vm.stackTop[-1]);
+    pop();
+    if (!found) break;
+    pieceStart = slots[1];
+  }
+  return true;
+}
+
+// Lx.utf8 reads strings by codepoint. Each string builds its TextIndex on
+// first use and keeps it, so later calls on the same string walk at most
+// TEXT_INDEX_STRIDE codepoints.
+static TextIndex *utf8Index(ObjString *string) {
+  if (string->index == NULL) {
+    string->index = textIndexNew(string->chars, (size_t)string->length);
+  }
+  return string->index;
+}
+
+// Checks for (s: String, n: Number) with n a non-negative integer.
+static bool utf8Args(int argCount, Value *args, const char *usage, size_t *n) {
+  if (argCount < 2 || !IS_STRING(args[0]) || !IS_NUMBER(args[1])) {
+    args[-1] = CSTRING_VAL(usage);
+    return false;
+  }
+  double value = AS_NUMBER(args[1]);
+  if (!(value >= 0) || value != trunc(value)) {
+    args[-1] = CSTRING_VAL(usage);
+    return false;
+  }
+  *n = value > (double)SIZE_MAX / 2 ? SIZE_MAX / 2 : (size_t)value;
+  return true;
+}
+
+// Lx.utf8.length(s: String) -> Number
+static bool utf8LengthNative(int argCount, Value *args) {
+  if (argCount < 1 || !IS_STRING(args[0])) {
+    args[-1] = CSTRING_VAL("Error: Lx.utf8.length takes a string.");
+    return false;
+  }
+  args[-1] = NUMBER_VAL((double)textIndexCodepoints(utf8Index(AS_STRING(args[0]))));
+  return true;
+}
+
+// Lx.utf8.codepointAt(s: String, i: Number) -> Number | nil
+static bool utf8CodepointAtNative(int argCount, Value *args) {
+  size_t i;
+  if (!utf8Args(argCount, args, "Error: Lx.utf8.codepointAt takes a string and an index.", &i)) {
+    return false;
+  }
+  ObjString *string = AS_STRING(args[0]);
+  TextIndex *index = utf8Index(string);
+  if (i >= textIndexCodepoints(index)) {
+    args[-1] = NIL_VAL;
+    return true;
+  }
+  size_t width;
+  uint32_t codepoint =
+      textDecode(string->chars, (size_t)string->length, textIndexOffset(index, i), &width);
+  args[-1] = NUMBER_VAL((double)codepoint);
+  return true;
+}
+
+// Lx.utf8.charAt(s: String, i: Number) -> String | nil
+static bool utf8CharAtNative(int argCount, Value *args) {
+  size_t i;
+  if (!utf8Args(argCount, args, "Error: Lx.utf8.charAt takes a string and an index.", &i)) {
+    return false;
+  }
+  ObjString *string = AS_STRING(args[0]);
+  TextIndex *index = utf8Index(string);
+  if (i >= textIndexCodepoints(index)) {
+    args[-1] = NIL_VAL;
+    return true;
+  }
+  size_t at = textIndexOffset(index, i);
+  size_t width;
+  textDecode(string->chars, (size_t)string->length, at, &width);
+  args[-1] = OBJ_VAL(copyString(string->chars + at, width));
+  return true;
+}
+
+// Lx.utf8.offset(s: String, i: Number) -> Number | nil
+static bool utf8OffsetNative(int argCount, Value *args) {
+  size_t i;
+  if (!utf8Args(argCount, args, "Error: Lx.utf8.offset takes a string and an index.", &i)) {
+    return false;
+  }
+  TextIndex *index = utf8Index(AS_STRING(args[0]));
+  // One past the last codepoint is the end of the string
+  args[-1] = i > textIndexCodepoints(index) ? NIL_VAL
+                                            : NUMBER_VAL((double)textIndexOffset(index, i));
+  return true;
+}
+
+// Lx.utf8.index(s: String, offset: Number) -> Number
+static bool utf8IndexNative(int argCount, Value *args) {
+  size_t offset;
+  if (!utf8Args(argCount, args, "Error: Lx.utf8.index takes a string and a byte offset.",
+                &offset)) {
+    return false;
+  }
+  TextIndex *index = utf8Index(AS_STRING(args[0]));
+  args[-1] = NUMBER_VAL((double)textIndexCodepointAt(index, offset));
+  return true;
+}
+
+// Lx.utf8.toUtf16(s: String, offset: Number) -> Number
+static bool utf8ToUtf16Native(int argCount, Value *args) {
+  size_t offset;
+  if (!utf8Args(argCount, args, "Error: Lx.utf8.toUtf16 takes a string and a byte offset.",
+                &offset)) {
+    return false;
+  }
+  TextIndex *index = utf8Index(AS_STRING(args[0]));
+  args[-1] = NUMBER_VAL((double)textIndexUtf16At(index, offset));
+  return true;
+}
+
+// Lx.utf8.fromUtf16(s: String, column: Number) -> Number
+static bool utf8FromUtf16Native(int argCount, Value *args) {
+  size_t column;
+  if (!utf8Args(argCount, args, "Error: Lx.utf8.fromUtf16 takes a string and a UTF-16 column.",
+                &column)) {
+    return false;
+  }
+  TextIndex *index = utf8Index(AS_STRING(args[0]));
+  args[-1] = NUMBER_VAL((double)textIndexFromUtf16(index, column));
+  return true;
+}
+
+// Lx.utf8.codepoints(s: String) -> Array
+static bool utf8CodepointsNative(int argCount, Value *args) {
+  if (argCount < 1 || !IS_STRING(args[0])) {
+    args[-1] = CSTRING_VAL("Error: Lx.utf8.codepoints takes a string.");
+    return false;
+  }
+  ObjString *string = AS_STRING(args[0]);
+  size_t count = textIndexCodepoints(utf8Index(string));
+  ObjArray *array = newArray();
+  args[-1] = OBJ_VAL(array);
+  array->array.values = GROW_ARRAY(Value, NULL, 0, count);
+  array->array.capacity = (int)count;
+  for (size_t at = 0; at < (size_t)string->length;) {
+    size_t width;
+    uint32_t codepoint = textDecode(string->chars, (size_t)string->length, at, &width);
+    array->array.values[array->array.count++] = NUMBER_VAL((double)codepoint);
+    at += width;
+  }
   return true;
 }
 
@@ -1889,9 +3546,10 @@ static bool lxIsLxObjNative(int argCount, Value *args) {
     return false;
   }
 
-  if (IS_STRING(args[0])) {
-    ObjString* s = AS_STRING(args[0]);
-    args[-1] = BOOL_VAL(lxObjHeaderLooksValid((const uint8_t*)s->chars, (size_t)s->length));
+  const uint8_t* view;
+  size_t viewLen;
+  if (byteView(args[0], &view, &viewLen)) {
+    args[-1] = BOOL_VAL(lxObjHeaderLooksValid(view, viewLen));
     return true;
   }
 
@@ -1937,7 +3595,7 @@ static bool lxIsLxObjNative(int argCount, Value *args) {
     return true;
   }
 
-  args[-1] = CSTRING_VAL("Error: Lx.isLxObj expects a string or byte array.");
+  args[-1] = CSTRING_VAL("Error: Lx.isLxObj expects a string, Bytes or byte array.");
   return false;
 }
 
@@ -1960,10 +3618,9 @@ static bool lxLoadObjNative(int argCount, Value *args) {
   uint8_t* bytes = NULL;
   size_t len = 0;
 
-  if (IS_STRING(args[0])) {
-    ObjString* s = AS_STRING(args[0]);
-    bytes = (uint8_t*)s->chars;
-    len = (size_t)s->length;
+  const uint8_t* view;
+  if (byteView(args[0], &view, &len)) {
+    bytes = (uint8_t*)view;
   } else if (IS_ARRAY(args[0])) {
     ValueArray* a = &AS_ARRAY(args[0]);
     len = (size_t)a->count;
@@ -1988,7 +3645,7 @@ static bool lxLoadObjNative(int argCount, Value *args) {
     }
     bytes = owned;
   } else {
-    args[-1] = CSTRING_VAL("Error: Lx.loadObj expects a string or byte array.");
+    args[-1] = CSTRING_VAL("Error: Lx.loadObj expects a string, Bytes or byte array.");
     return false;
   }
 
@@ -2014,6 +3671,40 @@ static bool lxLoadObjNative(int argCount, Value *args) {
   return true;
 }
 
+static bool lxLoadObjFileNative(int argCount, Value *args) {
+  if (argCount < 1 || !IS_STRING(args[0])) {
+    args[-1] = CSTRING_VAL("Error: Lx.loadObjFile takes 1 arg (path).");
+    return false;
+  }
+
+  bool printCode = false;
+  if (argCount >= 2) {
+    if (!IS_BOOL(args[1])) {
+      args[-1] = CSTRING_VAL("Error: Lx.loadObjFile arg2 must be a bool (printCode).");
+      return false;
+    }
+    printCode = AS_BOOL(args[1]);
+  }
+
+  bool isObj = false;
+  ObjFunction* function = loadObjFile(AS_CSTRING(args[0]), printCode, &isObj);
+  if (function == NULL) {
+    if (!isObj) {
+      args[-1] = NIL_VAL;
+      return true;
+    }
+    args[-1] = CSTRING_VAL("Error: failed to load lxobj.");
+    return false;
+  }
+
+  push(OBJ_VAL(function));
+  ObjClosure* closure = newClosure(function);
+  pop();
+
+  args[-1] = OBJ_VAL(closure);
+  return true;
+}
+
 static bool stdinReadAllNative(int argCount, Value *args) {
   if (argCount != 0) {
     args[-1] = CSTRING_VAL("Error: Lx.stdin.readAll takes 0 args.");
@@ -2150,27 +3841,8 @@ static bool stdinReadFdNative(int argCount, Value *args) {
     return true;
   }
 
-  char* buffer = (char*)malloc(n + 1);
-  if (buffer == NULL) {
-    args[-1] = CSTRING_VAL("Error: out of memory.");
-    return false;
-  }
-
-  ssize_t r = read(STDIN_FILENO, buffer, n);
-  if (r == 0) {
-    free(buffer);
-    args[-1] = NIL_VAL;
-    return true;
-  }
-  if (r < 0) {
-    free(buffer);
-    args[-1] = CSTRING_VAL("Error: read() failed.");
-    return false;
-  }
-
-  buffer[r] = '\0';
-  args[-1] = OBJ_VAL(takeString(buffer, (int)r));
-  return true;
+  LoopOp op = { .kind = LOOP_OP_READ, .fd = STDIN_FILENO, .readMax = n, .data = NIL_VAL };
+  return loopOpNative(&op, args);
 }
 
 // Terminal control natives
@@ -2328,7 +4000,8 @@ static bool sliceNative(int argCount, Value *args) {
     args[-1] = CSTRING_VAL("Error: slice takes 2 or 3 args.");
     return false;
   }
-  if (!IS_ARRAY(args[0])) {
+  bool typed = IS_TYPED_ARRAY(args[0]);
+  if (!IS_ARRAY(args[0]) && !typed) {
     args[-1] = CSTRING_VAL("Error: First arg must be an array.");
     return false;
   }
@@ -2337,7 +4010,7 @@ static bool sliceNative(int argCount, Value *args) {
     return false;
   }
 
-  ValueArray *input = &AS_ARRAY(args[0]);
+  int inputCount = typed ? AS_TYPED_ARRAY(args[0])->count : AS_ARRAY(args[0]).count;
   double startRaw = AS_NUMBER(args[1]);
 
   // Handle optional end parameter
@@ -2350,7 +4023,7 @@ static bool sliceNative(int argCount, Value *args) {
     endRaw = AS_NUMBER(args[2]);
   } else {
     // No end provided, use array length
-    endRaw = (double)input->count;
+    endRaw = (double)inputCount;
   }
 
   if (!isfinite(startRaw) || !isfinite(endRaw)) {
@@ -2364,7 +4037,7 @@ static bool sliceNative(int argCount, Value *args) {
     return false;
   }
 
-  int64_t len = (int64_t)input->count;
+  int64_t len = (int64_t)inputCount;
 
   // Handle negative indices (count from end)
   int64_t start = (int64_t)startRaw;
@@ -2385,12 +4058,25 @@ static bool sliceNative(int argCount, Value *args) {
   size_t startIndex = (size_t)start;
   size_t endIndex = (size_t)end;
 
+  if (typed) {
+    // Typed arrays slice into a fresh typed array of the same kind
+    ObjTypedArray *input = AS_TYPED_ARRAY(args[0]);
+    int length = endIndex > startIndex ? (int)(endIndex - startIndex) : 0;
+    ObjTypedArray *result = newTypedArray(input->kind, length);
+    for (int i = 0; i < length; i++) {
+      typedArraySet(result, i, typedArrayGet(input, (int)startIndex + i));
+    }
+    args[-1] = OBJ_VAL(result);
+    return true;
+  }
+
   // If end <= start, return empty array
   if (endIndex <= startIndex) {
     args[-1] = OBJ_VAL(newArray());
     return true;
   }
 
+  ValueArray *input = &AS_ARRAY(args[0]);
   size_t length = endIndex - startIndex;
   ObjArray *result = newArray();
   push(OBJ_VAL(result));
@@ -2405,6 +4091,80 @@ static bool sliceNative(int argCount, Value *args) {
   return true;
 }
 
+// Float64Array(n) / Int32Array(n) / Uint8Array(n): zero-filled typed array
+// of length n. Passing an array (or typed array) copies its elements.
+static bool newTypedArrayFrom(TypedArrayKind kind, int argCount, Value *args) {
+  const char *name = typedArrayKindName(kind);
+  if (argCount < 1) {
+    args[-1] = OBJ_VAL(newTypedArray(kind, 0));
+    return true;
+  }
+  Value arg = args[0];
+  if (IS_NUMBER(arg)) {
+    double dnum = AS_NUMBER(arg);
+    if (!isIntIndex(dnum)) {
+      char buf[96];
+      snprintf(buf, sizeof(buf), "Error: %s length should be a non-negative integer.", name);
+      args[-1] = CSTRING_VAL(buf);
+      return false;
+    }
+    args[-1] = OBJ_VAL(newTypedArray(kind, (int)dnum));
+    return true;
+  }
+  if (IS_TYPED_ARRAY(arg)) {
+    ObjTypedArray *source = AS_TYPED_ARRAY(arg);
+    ObjTypedArray *result = newTypedArray(kind, source->count);
+    for (int i = 0; i < source->count; i++) {
+      typedArraySet(result, i, typedArrayGet(source, i));
+    }
+    args[-1] = OBJ_VAL(result);
+    return true;
+  }
+  if (IS_ARRAY(arg)) {
+    ValueArray *source = &AS_ARRAY(arg);
+    for (int i = 0; i < source->count; i++) {
+      if (!IS_NUMBER(source->values[i])) {
+        args[-1] = CSTRING_VAL("Error: Typed array element must be a number.");
+        return false;
+      }
+    }
+    ObjTypedArray *result = newTypedArray(kind, source->count);
+    for (int i = 0; i < source->count; i++) {
+      typedArraySet(result, i, source->values[i]);
+    }
+    args[-1] = OBJ_VAL(result);
+    return true;
+  }
+  char buf[96];
+  snprintf(buf, sizeof(buf), "Error: %s takes a length or an array.", name);
+  args[-1] = CSTRING_VAL(buf);
+  return false;
+}
+
+// Bytes(n | string | array): growable byte buffer, see Lx.bytes
+static bool bytesNative(int argCount, Value *args) {
+  if (argCount >= 1 && IS_STRING(args[0])) {
+    ObjString *source = AS_STRING(args[0]);
+    ObjTypedArray *result = newTypedArray(TYPED_BYTES, source->length);
+    if (source->length > 0) memcpy(result->as.u8, source->chars, source->length);
+    args[-1] = OBJ_VAL(result);
+    return true;
+  }
+  return newTypedArrayFrom(TYPED_BYTES, argCount, args);
+}
+
+static bool float64ArrayNative(int argCount, Value *args) {
+  return newTypedArrayFrom(TYPED_FLOAT64, argCount, args);
+}
+
+static bool int32ArrayNative(int argCount, Value *args) {
+  return newTypedArrayFrom(TYPED_INT32, argCount, args);
+}
+
+static bool uint8ArrayNative(int argCount, Value *args) {
+  return newTypedArrayFrom(TYPED_UINT8, argCount, args);
+}
+
 // ---- end of native function declarations ----
 // ---- end of native function declarations ----
 // ---- end of native function declarations ----
@@ -2466,10 +4226,8 @@ static void defineLxNatives() {
       char* eq = strchr(entry, '=');
       if (eq == NULL || eq == entry) continue;
       size_t keyLen = (size_t)(eq - entry);
-      ObjString* key = copyString(entry, keyLen);
-      ObjString* value = copyString(eq + 1, strlen(eq + 1));
-      push(OBJ_VAL(key));
-      push(OBJ_VAL(value));
+      push(OBJ_VAL(copyString(entry, keyLen)));
+      push(OBJ_VAL(copyString(eq + 1, strlen(eq + 1))));
       tableSet(&AS_HASHMAP(vm.stack[3]), vm.stack[4], vm.stack[5]);
       pop();
       pop();
@@ -2498,6 +4256,16 @@ static void defineLxNatives() {
   defineTableFunction(&fs->table, "realpath", fsRealpathNative);
   defineTableFunction(&fs->table, "readFile", slurpNative);
   defineTableFunction(&fs->table, "writeFile", spitNative);
+  defineTableFunction(&fs->table, "mkdir", fsMkdirNative);
+  defineTableFunction(&fs->table, "rename", fsRenameNative);
+  defineTableFunction(&fs->table, "remove", fsRemoveNative);
+  defineTableFunction(&fs->table, "open", fsOpenNative);
+  defineTableFunction(&fs->table, "readLine", fsReadLineNative);
+  defineTableFunction(&fs->table, "readChunk", fsReadChunkNative);
+  defineTableFunction(&fs->table, "lines", fsLinesNative);
+  defineTableFunction(&fs->table, "write", fsWriteNative);
+  defineTableFunction(&fs->table, "flush", fsFlushNative);
+  defineTableFunction(&fs->table, "close", fsCloseNative);
   pop(); // fs
 
   // Lx.path
@@ -2540,6 +4308,7 @@ static void defineLxNatives() {
   defineTableFunction(&stdoutTable->table, "flush", stdoutFlushNative);
   defineTableFunction(&stdoutTable->table, "isTTY", stdoutIsTtyNative);
   defineTableFunction(&stdoutTable->table, "putc", putcNative);
+  defineTableFunction(&stdoutTable->table, "write", stdoutWriteNative);
   pop(); // stdout
 
   // Lx.stderr
@@ -2566,8 +4335,66 @@ static void defineLxNatives() {
   pop();
   defineTableFunction(&proc->table, "exec", execNative);
   defineTableFunction(&proc->table, "system", systemNative);
+  defineTableFunction(&proc->table, "fork", procForkNative);
+  defineTableFunction(&proc->table, "pipe", procPipeNative);
+  defineTableFunction(&proc->table, "close", procCloseNative);
+  defineTableFunction(&proc->table, "write", procWriteNative);
+  defineTableFunction(&proc->table, "readAll", procReadAllNative);
+  defineTableFunction(&proc->table, "wait", procWaitNative);
+  defineTableFunction(&proc->table, "tryWait", procTryWaitNative);
+  defineTableFunction(&proc->table, "waitAny", procWaitAnyNative);
+  defineTableFunction(&proc->table, "kill", procKillNative);
+  defineTableFunction(&proc->table, "exit", procExitNative);
+  defineTableFunction(&proc->table, "cpuCount", procCpuCountNative);
+  defineTableFunction(&proc->table, "pid", procPidNative);
   pop(); // proc
 
+  // Lx.isolate
+  ObjHashmap* isolate = newHashmap();
+  push(OBJ_VAL(isolate)); // root
+  push(CSTRING_VAL("isolate"));
+  push(OBJ_VAL(isolate));
+  tableSet(&AS_HASHMAP(vm.stack[1]), vm.stackTop[-2], vm.stackTop[-1]);
+  pop();
+  pop();
+  defineTableFunction(&isolate->table, "spawn", isolateSpawnNative);
+  defineTableFunction(&isolate->table, "send", isolateSendNative);
+  defineTableFunction(&isolate->table, "recv", isolateRecvNative);
+  defineTableFunction(&isolate->table, "join", isolateJoinNative);
+  defineTableFunction(&isolate->table, "self", isolateSelfNative);
+  defineTableFunction(&isolate->table, "parent", isolateParentNative);
+  pop(); // isolate
+
+  // Lx.loop
+  ObjHashmap* loopTable = newHashmap();
+  push(OBJ_VAL(loopTable)); // root
+  push(CSTRING_VAL("loop"));
+  push(OBJ_VAL(loopTable));
+  tableSet(&AS_HASHMAP(vm.stack[1]), vm.stackTop[-2], vm.stackTop[-1]);
+  pop();
+  pop();
+  defineTableFunction(&loopTable->table, "spawn", loopSpawnNative);
+  defineTableFunction(&loopTable->table, "run", loopRunNative);
+  defineTableFunction(&loopTable->table, "read", loopReadNative);
+  defineTableFunction(&loopTable->table, "write", loopWriteNative);
+  pop(); // loop
+
+  // Lx.net
+  ObjHashmap* net = newHashmap();
+  push(OBJ_VAL(net)); // root
+  push(CSTRING_VAL("net"));
+  push(OBJ_VAL(net));
+  tableSet(&AS_HASHMAP(vm.stack[1]), vm.stackTop[-2], vm.stackTop[-1]);
+  pop();
+  pop();
+  defineTableFunction(&net->table, "listen", netListenNative);
+  defineTableFunction(&net->table, "listenUnix", netListenUnixNative);
+  defineTableFunction(&net->table, "connect", netConnectNative);
+  defineTableFunction(&net->table, "connectUnix", netConnectUnixNative);
+  defineTableFunction(&net->table, "accept", netAcceptNative);
+  defineTableFunction(&net->table, "port", netPortNative);
+  pop(); // net
+
   // Lx.zlib
   ObjHashmap* zlib = newHashmap();
   push(OBJ_VAL(zlib)); // root
@@ -2581,6 +4408,76 @@ static void defineLxNatives() {
   defineTableFunction(&zlib->table, "crc32", zlibCrc32Native);
   pop(); // zlib
 
+  // Lx.json
+  ObjHashmap* json = newHashmap();
+  push(OBJ_VAL(json)); // root
+  push(CSTRING_VAL("json"));
+  push(OBJ_VAL(json));
+  tableSet(&AS_HASHMAP(vm.stack[1]), vm.stackTop[-2], vm.stackTop[-1]);
+  pop();
+  pop();
+  defineTableFunction(&json->table, "parse", jsonParseNative);
+  defineTableFunction(&json->table, "stringify", jsonStringifyNative);
+  pop(); // json
+
+  // Lx.re
+  ObjHashmap* re = newHashmap();
+  push(OBJ_VAL(re)); // root
+  push(CSTRING_VAL("re"));
+  push(OBJ_VAL(re));
+  tableSet(&AS_HASHMAP(vm.stack[1]), vm.stackTop[-2], vm.stackTop[-1]);
+  pop();
+  pop();
+  defineTableFunction(&re->table, "compile", reCompileNative);
+  defineTableFunction(&re->table, "match", reMatchNative);
+  defineTableFunction(&re->table, "find", reFindNative);
+  defineTableFunction(&re->table, "findAll", reFindAllNative);
+  defineTableFunction(&re->table, "split", reSplitNative);
+  defineTableFunction(&re->table, "replace", reReplaceNative);
+  pop(); // re
+
+  // Lx.utf8
+  ObjHashmap* utf8 = newHashmap();
+  push(OBJ_VAL(utf8)); // root
+  push(CSTRING_VAL("utf8"));
+  push(OBJ_VAL(utf8));
+  tableSet(&AS_HASHMAP(vm.stack[1]), vm.stackTop[-2], vm.stackTop[-1]);
+  pop();
+  pop();
+  defineTableFunction(&utf8->table, "length", utf8LengthNative);
+  defineTableFunction(&utf8->table, "codepointAt", utf8CodepointAtNative);
+  defineTableFunction(&utf8->table, "charAt", utf8CharAtNative);
+  defineTableFunction(&utf8->table, "codepoints", utf8CodepointsNative);
+  defineTableFunction(&utf8->table, "offset", utf8OffsetNative);
+  defineTableFunction(&utf8->table, "index", utf8IndexNative);
+  defineTableFunction(&utf8->table, "toUtf16", utf8ToUtf16Native);
+  defineTableFunction(&utf8->table, "fromUtf16", utf8FromUtf16Native);
+  pop(); // utf8
+
+  // Lx.bytes
+  ObjHashmap* bytes = newHashmap();
+  push(OBJ_VAL(bytes)); // root
+  push(CSTRING_VAL("bytes"));
+  push(OBJ_VAL(bytes));
+  tableSet(&AS_HASHMAP(vm.stack[1]), vm.stackTop[-2], vm.stackTop[-1]);
+  pop();
+  pop();
+  defineTableFunction(&bytes->table, "readU8", bytesReadU8Native);
+  defineTableFunction(&bytes->table, "readU16", bytesReadU16Native);
+  defineTableFunction(&bytes->table, "readU32", bytesReadU32Native);
+  defineTableFunction(&bytes->table, "readI32", bytesReadI32Native);
+  defineTableFunction(&bytes->table, "readF64", bytesReadF64Native);
+  defineTableFunction(&bytes->table, "readString", bytesReadStringNative);
+  defineTableFunction(&bytes->table, "writeU8", bytesWriteU8Native);
+  defineTableFunction(&bytes->table, "writeU16", bytesWriteU16Native);
+  defineTableFunction(&bytes->table, "writeU32", bytesWriteU32Native);
+  defineTableFunction(&bytes->table, "writeF64", bytesWriteF64Native);
+  defineTableFunction(&bytes->table, "append", bytesAppendNative);
+  defineTableFunction(&bytes->table, "appendU16", bytesAppendU16Native);
+  defineTableFunction(&bytes->table, "appendU32", bytesAppendU32Native);
+  defineTableFunction(&bytes->table, "appendF64", bytesAppendF64Native);
+  pop(); // bytes
+
   // Lx.term
   ObjHashmap* term = newHashmap();
   push(OBJ_VAL(term)); // root
@@ -2603,8 +4500,12 @@ static void defineLxNatives() {
   defineTableFunction(&AS_HASHMAP(vm.stack[1]), "error", lxErrorNative);
   defineTableFunction(&AS_HASHMAP(vm.stack[1]), "isLxObj", lxIsLxObjNative);
   defineTableFunction(&AS_HASHMAP(vm.stack[1]), "loadObj", lxLoadObjNative);
+  defineTableFunction(&AS_HASHMAP(vm.stack[1]), "loadObjFile", lxLoadObjFileNative);
   defineTableFunction(&AS_HASHMAP(vm.stack[1]), "sleep", sleepNative);
   defineTableFunction(&AS_HASHMAP(vm.stack[1]), "exit", exitNative);
+  defineTableFunction(&AS_HASHMAP(vm.stack[1]), "spawn", spawnNative);
+  defineTableFunction(&AS_HASHMAP(vm.stack[1]), "scan", scanNative);
+  defineTableFunction(&AS_HASHMAP(vm.stack[1]), "format", lxFormatNative);
 
   pop();
   pop();
@@ -2678,5 +4579,12 @@ void defineBuiltinNatives() {
   defineNative("range", rangeNative);
   defineNative("reverse", reverseNative);
   defineNative("slice", sliceNative);
+  defineNative("sort", sortNative);
+  defineNative("stableSort", stableSortNative);
+  defineNative("sortBy", sortByNative);
+  defineNative("Float64Array", float64ArrayNative);
+  defineNative("Int32Array", int32ArrayNative);
+  defineNative("Uint8Array", uint8ArrayNative);
+  defineNative("Bytes", bytesNative);
 }
 #endif
@@ -7,6 +7,7 @@
 #include "table.h"
 
 typedef struct Writer Writer;
+typedef struct TextIndex TextIndex;
 struct CallFrame;
 
 #define OBJ_TYPE(value)        (AS_OBJ(value)->type)
@@ -19,6 +20,8 @@ struct CallFrame;
 #define IS_ENUM(value)         isObjType(value, OBJ_ENUM)
 #define IS_ARRAY(value)        isObjType(value, OBJ_ARRAY)
 #define IS_FIBER(value)        isObjType(value, OBJ_FIBER)
+#define IS_TYPED_ARRAY(value)  isObjType(value, OBJ_TYPED_ARRAY)
+#define IS_BYTES(value)        (IS_TYPED_ARRAY(value) && AS_TYPED_ARRAY(value)->kind == TYPED_BYTES)
 
 #define AS_CLOSURE(value)      ((ObjClosure*)AS_OBJ(value))
 #define AS_FUNCTION(value)     ((ObjFunction*)AS_OBJ(value))
@@ -31,6 +34,7 @@ struct CallFrame;
 #define AS_ENUM_REVERSE(value) (((ObjEnum*)AS_OBJ(value))->reverse)
 #define AS_ARRAY(value)        (((ObjArray*)AS_OBJ(value))->array)
 #define AS_FIBER(value)        ((ObjFiber*)AS_OBJ(value))
+#define AS_TYPED_ARRAY(value)  ((ObjTypedArray*)AS_OBJ(value))
 
 #define COPY_CSTRING(string)   copyString(string, strlen(string))
 #define CSTRING_VAL(string)    OBJ_VAL(copyString(string, strlen(string)))
@@ -45,14 +49,19 @@ typedef enum {
   OBJ_ENUM,
   OBJ_ARRAY,
   OBJ_FIBER,
+  OBJ_TYPED_ARRAY,
 } ObjType;
 
 struct Obj {
   ObjType type;
   bool isMarked;
+  bool isBorrowed;        // payload lives in a mapped lxobj, not owned
   struct Obj* next;
 };
 
+// see objloader.h
+typedef struct LazyUnit LazyUnit;
+
 typedef struct {
   Obj obj;
   int arity;
@@ -60,6 +69,11 @@ typedef struct {
   Chunk chunk;
   ObjString* name;
   ObjString* filename;
+  LazyUnit* lazyUnit;     // non-NULL until the chunk is decoded on first call
+  uint8_t* lazyBody;
+  bool sharedModule;      // imports run the body once (embedded objs only)
+  bool moduleLoaded;      // module body ran once, see OP_IMPORT
+  Value moduleValue;
 } ObjFunction;
 
 typedef bool (*NativeFn)(int argCount, Value* args);
@@ -87,11 +101,34 @@ typedef struct {
   ValueArray array;
 } ObjArray;
 
+// Numeric array with unboxed storage. Only TYPED_BYTES grows; the other
+// kinds are fixed-length and keep capacity == count.
+typedef enum {
+  TYPED_FLOAT64,
+  TYPED_INT32,
+  TYPED_UINT8,
+  TYPED_BYTES,
+} TypedArrayKind;
+
+typedef struct {
+  Obj obj;
+  TypedArrayKind kind;
+  int count;
+  int capacity;
+  union {
+    double* f64;
+    int32_t* i32;
+    uint8_t* u8;
+  } as;
+} ObjTypedArray;
+
 struct ObjString {
   Obj obj;
   size_t length;
   char* chars;
   uint64_t hash;
+  // Codepoint offsets for the Lx.utf8 natives, built on first use
+  TextIndex* index;
 };
 
 typedef struct ObjUpvalue {
@@ -147,10 +184,17 @@ ObjFunction* newFunction();
 ObjNative* newNative(NativeFn function, ObjString* name);
 ObjString* takeString(char* chars, int length);
 ObjString* copyString(const char* chars, size_t length);
+ObjString* borrowString(const char* chars, size_t length);
 ObjUpvalue* newUpvalue(Value* slot);
 ObjHashmap* newHashmap();
 ObjEnum* newEnum();
 ObjArray* newArray();
+ObjTypedArray* newTypedArray(TypedArrayKind kind, int count);
+size_t typedArrayElementSize(TypedArrayKind kind);
+void freeTypedArray(ObjTypedArray* array);
+void typedArrayReserve(ObjTypedArray* array, int capacity);
+const char* typedArrayKindName(TypedArrayKind kind);
+uint32_t doubleToUint32Bits(double value);
 ObjFiber* newFiber();
 ObjFiber* newFiberWithStack(Value* stack,
                             int stackCapacity,
@@ -165,4 +209,30 @@ static inline bool isObjType(Value value, ObjType type) {
   return IS_OBJ(value) && AS_OBJ(value)->type == type;
 }
 
+// Element access; callers bounds-check index and ensure value IS_NUMBER.
+// Integer kinds wrap modulo 2^32 / 2^8 like JS typed arrays.
+static inline Value typedArrayGet(ObjTypedArray* array, int index) {
+  switch (array->kind) {
+    case TYPED_FLOAT64: return NUMBER_VAL(array->as.f64[index]);
+    case TYPED_INT32: return FIXNUM_VAL(array->as.i32[index]);
+    case TYPED_UINT8:
+    case TYPED_BYTES: return FIXNUM_VAL(array->as.u8[index]);
+  }
+  return NIL_VAL;
+}
+
+static inline void typedArraySet(ObjTypedArray* array, int index, Value value) {
+  if (array->kind == TYPED_FLOAT64) {
+    array->as.f64[index] = AS_NUMBER(value);
+    return;
+  }
+  uint32_t bits = IS_FIXNUM(value) ? (uint32_t)AS_FIXNUM(value)
+                                   : doubleToUint32Bits(AS_NUMBER(value));
+  if (array->kind == TYPED_INT32) {
+    array->as.i32[index] = (int32_t)bits;
+  } else {
+    array->as.u8[index] = (uint8_t)bits;
+  }
+}
+
 #endif
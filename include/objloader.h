@@ -4,19 +4,37 @@
 #include "memory.h"
 #include "object.h"
 
-typedef struct {
-  Chunk* chunk;
-  int index;
-  int functionId;
-} ChunkValueIndex;
-
-typedef struct {
-  uint32_t count;
-  uint32_t capacity;
-  ChunkValueIndex* values;
-} ChunkIndexes;
+// Payload and chunk table shared by the functions of a lazily loaded obj.
+// Function constants hold a REF id as a NUMBER pointing at the shared module.
+struct LazyUnit {
+  uint8_t* payload;
+  bool ownsPayload;
+  bool borrow;
+  bool isMarked;
+  uint8_t flags;
+  uint8_t version;
+  int pending;            // stubs whose body is not decoded yet
+  ValueArray functions;   // chunk id -> function stub (or NUMBER ref)
+  struct LazyUnit* next;
+};
 
 ObjFunction* loadObj(uint8_t* bytes, bool printCode);
+// loadObj for the objs embedded in the binary (see interpret): their module
+// bodies run once and every import shares the value (OP_IMPORT_STORE).
+// Programs loaded through Lx.loadObj* keep a fresh module per import.
+ObjFunction* loadObjSharingModules(uint8_t* bytes);
+// Load an lxobj straight from disk. Mappable objs are loaded zero-copy.
+// Returns NULL with *isObj == false when path is not an lxobj at all.
+ObjFunction* loadObjFile(const char* path, bool printCode, bool* isObj);
+
+// Decode the chunk of a lazily loaded function (function->lazyUnit != NULL).
+bool materializeFunction(ObjFunction* function);
+// Detach a lazy function from its unit without decoding it.
+void releaseLazyFunction(ObjFunction* function);
+void markLazyUnit(LazyUnit* unit);
+void markLoaderRoots();
+// Free units with no pending stubs and clear marks; run after each sweep.
+void sweepLazyUnits();
 
 typedef enum {
   CHUNK_TYPE_REF,
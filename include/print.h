@@ -17,6 +17,12 @@ void writerWrite(Writer* writer, const char* data, size_t len);
 void writerPrintf(Writer* writer, const char* format, ...);
 Writer writerForFile(FILE* file);
 
+// stdout gets a large buffer: flushed per line on a terminal, otherwise only
+// when full, on Lx.stdout.flush, before stderr output and at exit. Call once
+// from main() before anything is printed.
+#define STDOUT_BUFFER_SIZE (64 * 1024)
+void initStdout(void);
+
 void writeValue(Writer* writer, Value value);
 void writeObject(Writer* writer, Value value);
 
@@ -0,0 +1,60 @@
+#ifndef clox_regex_h
+#define clox_regex_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Regular expressions behind Lx.re. A pattern compiles to a Thompson NFA
+// over bytes (non-ASCII classes become UTF-8 byte sequences). Searches run
+// a lazily built DFA forward to find where the leftmost-first match ends
+// and a reverse DFA back to where it starts; only when capture groups are
+// wanted does a Pike VM re-run over that span. Every path is linear in the
+// input. Patterns using \b or \B skip the DFAs and use the Pike VM alone.
+//
+// Syntax: literals, `.`, `[...]` classes with ranges and negation,
+// \d \w \s \D \W \S, \b \B, ^ $ (start and end of text), groups `(...)`,
+// `(?:...)` and `(?<name>...)`, alternation, the quantifiers * + ? {n}
+// {n,} {n,m} and their lazy `?` forms, and the flags (?i) (ASCII case
+// folding) and (?s) (`.` matches newline) either inline or as `(?i:...)`.
+
+#define REGEX_UNSET SIZE_MAX
+
+typedef struct Regex Regex;
+
+// Compiled patterns are cached per thread by pattern text, so passing the
+// same pattern again skips the compile. A later regexGet may evict and
+// free an older entry. Returns NULL with *error set for a bad pattern.
+Regex* regexGet(const char* pattern, size_t length, const char** error);
+
+// Number of capture groups, not counting the whole match.
+int regexGroupCount(const Regex* re);
+// Name of capture group `group` (1-based), or NULL when it has none.
+const char* regexGroupName(const Regex* re, int group);
+
+// Leftmost-first match starting at or after `from`. On success fills
+// 2 * (regexGroupCount(re) + 1) slots with start and end offsets, leaving
+// REGEX_UNSET for groups that did not take part.
+bool regexFind(Regex* re, const char* text, size_t length, size_t from, size_t* slots);
+
+// Whether the pattern matches anywhere in `text`. Never needs captures, so
+// it stops at the first byte where a match is known to exist.
+bool regexTest(Regex* re, const char* text, size_t length);
+
+// Output of Lx.re.replace; `data` grows with realloc.
+typedef struct {
+  char* data;
+  size_t length;
+  size_t capacity;
+} RegexBuffer;
+
+void regexAppend(RegexBuffer* out, const char* bytes, size_t length);
+
+// Appends `replacement` with $0-$9, ${n} and ${name} replaced by the
+// matched groups and $$ by a dollar sign.
+void regexExpand(const Regex* re, const char* replacement, size_t replacementLength,
+                 const char* text, const size_t* slots, RegexBuffer* out);
+
+void freeRegexCache(void);
+
+#endif
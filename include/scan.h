@@ -0,0 +1,80 @@
+#ifndef clox_scan_h
+#define clox_scan_h
+
+#include "value.h"
+
+// Token types. Must match TOKEN in lx/src/types.lx.
+typedef enum {
+  TOKEN_LEFT_PAREN = 100,
+  TOKEN_RIGHT_PAREN,
+  TOKEN_LEFT_BRACE,
+  TOKEN_RIGHT_BRACE,
+  TOKEN_LEFT_BRACKET,
+  TOKEN_RIGHT_BRACKET,
+  TOKEN_COMMA,
+  TOKEN_DOT,
+  TOKEN_MINUS,
+  TOKEN_PLUS,
+  TOKEN_SEMICOLON,
+  TOKEN_SLASH,
+  TOKEN_STAR,
+  TOKEN_COLON,
+  TOKEN_MOD,
+
+  TOKEN_BANG = 200,
+  TOKEN_BANG_EQUAL,
+  TOKEN_EQUAL,
+  TOKEN_EQUAL_EQUAL,
+  TOKEN_ARROW,
+  TOKEN_GREATER,
+  TOKEN_GREATER_EQUAL,
+  TOKEN_GREATER_GREATER,
+  TOKEN_LESS,
+  TOKEN_LESS_EQUAL,
+  TOKEN_LESS_LESS,
+  TOKEN_DOT_BRACE,
+  TOKEN_MINUS_GREATER,
+  TOKEN_AMPERSAND,
+  TOKEN_PIPE,
+  TOKEN_CARET,
+
+  TOKEN_IDENTIFIER = 300,
+  TOKEN_STRING,
+  TOKEN_NUMBER,
+
+  TOKEN_AND = 400,
+  TOKEN_OR,
+  TOKEN_IF,
+  TOKEN_ELSE,
+  TOKEN_FN,
+  TOKEN_FOR,
+  TOKEN_NIL,
+  TOKEN_RETURN,
+  TOKEN_TRUE,
+  TOKEN_FALSE,
+  TOKEN_LET,
+  TOKEN_ENUM,
+  TOKEN_BREAK,
+  TOKEN_CONTINUE,
+  TOKEN_IMPORT,
+  TOKEN_IN,
+  TOKEN_COLLECT,
+
+  TOKEN_ERROR = 990,
+  TOKEN_EOF = 999,
+} TokenType;
+
+// Tokenizes lx source in one pass (Lx.scan). Returns a map of parallel
+// arrays, one entry per token and ending with TOKEN_EOF:
+//
+//   types     TokenType
+//   lexemes   source text of the token, or the message for TOKEN_ERROR
+//   lines     line of the token's last character
+//   cols      byte column just past the token
+//   literals  decoded value for strings and numbers, nil otherwise
+//
+// Positions follow lx/src/passes/scanner.lx, which the parser's error
+// columns are computed against.
+Value scanSource(const char* source, size_t length);
+
+#endif
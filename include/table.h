@@ -25,6 +25,7 @@ typedef struct {
   int capacity;
   Entry* entries;
   uint8_t* control;
+  uint32_t layout; // bumped whenever keys move to other slots (checked by for-in)
 } Table;
 
 void initTable(Table* table);
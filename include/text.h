@@ -0,0 +1,57 @@
+#ifndef clox_text_h
+#define clox_text_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Byte-string kernels behind the string natives (split, contains, tolower,
+// toupper, range). On x86-64 each one picks an AVX2 or SSE2 loop at run
+// time and finishes the tail with scalar code; elsewhere they are plain
+// loops.
+
+// First occurrence of `needle` in `haystack`, or NULL. Unlike strstr,
+// both may contain NUL bytes.
+const char* textFind(const char* haystack, size_t length,
+                     const char* needle, size_t needleLength);
+
+// ASCII-only case mapping of `length` bytes; `dst` may equal `src`.
+void textLower(char* dst, const char* src, size_t length);
+void textUpper(char* dst, const char* src, size_t length);
+
+// Well-formed UTF-8: no overlongs, surrogates or values past U+10FFFF.
+bool textUtf8Valid(const char* bytes, size_t length);
+// Bytes that are not continuation bytes, i.e. the codepoint count of
+// valid UTF-8.
+size_t textUtf8Count(const char* bytes, size_t length);
+
+// The codepoint at byte offset `at` and its length in bytes. A byte that
+// does not start a well-formed sequence decodes as U+FFFD of length 1.
+uint32_t textDecode(const char* bytes, size_t length, size_t at, size_t* width);
+
+// Sparse codepoint index behind Lx.utf8. Every TEXT_INDEX_STRIDE
+// codepoints it records the byte offset and the UTF-16 units before that
+// point, so each lookup below decodes at most one stride of the string.
+// All-ASCII strings keep no checkpoints at all. Ill-formed bytes count as
+// one codepoint and one UTF-16 unit each, the way textDecode reads them.
+// The index points into `bytes`, which must outlive it.
+#define TEXT_INDEX_STRIDE 64
+
+typedef struct TextIndex TextIndex;
+
+TextIndex* textIndexNew(const char* bytes, size_t length);
+void textIndexFree(TextIndex* index);
+
+size_t textIndexCodepoints(const TextIndex* index);
+size_t textIndexUtf16Length(const TextIndex* index);
+// Byte offset of codepoint `codepoint`; the byte length for the count.
+size_t textIndexOffset(TextIndex* index, size_t codepoint);
+// Codepoint holding byte offset `offset`, clamped to the string.
+size_t textIndexCodepointAt(const TextIndex* index, size_t offset);
+// UTF-16 units before the codepoint holding byte offset `offset`.
+size_t textIndexUtf16At(const TextIndex* index, size_t offset);
+// Byte offset of the codepoint at UTF-16 column `units`. A column in the
+// middle of a surrogate pair maps to the start of its codepoint.
+size_t textIndexFromUtf16(const TextIndex* index, size_t units);
+
+#endif
@@ -82,7 +82,7 @@ typedef enum {
   INTERPRET_RUNTIME_ERROR
 } InterpretResult;
 
-extern VM vm;
+extern _Thread_local VM vm;
 
 #define INTERPRET_LOADOBJ_ERROR INTERPRET_COMPILE_ERROR
 
@@ -9,10 +9,18 @@ void initChunk(Chunk* chunk) {
   chunk->capacity = 0;
   chunk->code = NULL;
   chunk->lines = NULL;
+  chunk->borrowed = false;
   initValueArray(&chunk->constants);
 }
 
 void freeChunk(Chunk* chunk) {
+  if (chunk->borrowed) {
+    // lines are only allocated for debug builds of a borrowed chunk
+    if (chunk->lines != NULL) FREE_ARRAY(uint32_t, chunk->lines, chunk->count);
+    freeValueArray(&chunk->constants);
+    initChunk(chunk);
+    return;
+  }
   FREE_ARRAY(uint8_t, chunk->code, chunk->capacity);
   FREE_ARRAY(int, chunk->lines, chunk->capacity);
   freeValueArray(&chunk->constants);
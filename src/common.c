@@ -1,3 +1,3 @@
-int LX_ARGC;
-const char** LX_ARGV;
+_Thread_local int LX_ARGC;
+_Thread_local const char** LX_ARGV;
 
@@ -118,10 +118,24 @@ static int forLoopInstruction(const char* name, int sign, Chunk* chunk, int offs
   return offset + instruction_length;
 }
 
+static int iterNextInstruction(const char* name, int sign, Chunk* chunk, int offset) {
+  uint8_t obj_slot = chunk->code[offset + 1];
+  uint8_t cursor_slot = chunk->code[offset + 2];
+  uint8_t limit_slot = chunk->code[offset + 3];
+  uint16_t jump = (uint16_t)(chunk->code[offset + 4] << 8);
+  jump |= chunk->code[offset + 5];
+  printf("%-19s obj=%d cursor=%d limit=%d -> %d\n", name, obj_slot, cursor_slot,
+         limit_slot, offset + 6 + sign * jump);
+  return offset + 6;
+}
+
 int disassembleInstruction(Chunk* chunk, int offset, bool printCode) {
   printf("%04d ", offset);
 
-  if (offset > 0 && chunk->lines[offset] == chunk->lines[offset - 1]) {
+  if (chunk->lines == NULL) {
+    // borrowed non-debug chunks have no line table
+    printf("   ?--");
+  } else if (offset > 0 && chunk->lines[offset] == chunk->lines[offset - 1]) {
     if (printCode) {
       printf("   |  ");
     } else {
@@ -220,6 +234,8 @@ int disassembleInstruction(Chunk* chunk, int offset, bool printCode) {
       return simpleInstruction("OP_ADD_NUM", offset);
     case OP_ADD_STR:
       return simpleInstruction("OP_ADD_STR", offset);
+    case OP_CONCAT_N:
+      return byteInstruction("OP_CONCAT_N", chunk, offset);
     case OP_ASSOC:
       return simpleInstruction("OP_ASSOC", offset);
     case OP_APPEND:
@@ -345,6 +361,20 @@ int disassembleInstruction(Chunk* chunk, int offset, bool printCode) {
       return forLoopInstruction("OP_FORLOOP", -1, chunk, offset);
     case OP_YIELD:
       return byteInstruction("OP_YIELD", chunk, offset);
+    case OP_ITER_INIT:
+      return simpleInstruction("OP_ITER_INIT", offset);
+    case OP_ITER_NEXT:
+      return iterNextInstruction("OP_ITER_NEXT", -1, chunk, offset);
+    case OP_ITER_VALUE:
+      return twoByteInstruction("OP_ITER_VALUE", chunk, offset);
+    case OP_FOREACH_PREP:
+      return iterNextInstruction("OP_FOREACH_PREP", 1, chunk, offset);
+    case OP_FOREACH_NEXT:
+      return iterNextInstruction("OP_FOREACH_NEXT", -1, chunk, offset);
+    case OP_IMPORT:
+      return constantLongInstruction("OP_IMPORT", chunk, offset);
+    case OP_IMPORT_STORE:
+      return constantLongInstruction("OP_IMPORT_STORE", chunk, offset);
     case OP_RETURN:
       return simpleInstruction("OP_RETURN", offset);
     default:
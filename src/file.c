@@ -0,0 +1,301 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "file.h"
+#include "object.h"
+
+typedef struct {
+  bool writing;
+  bool eof;
+  uint8_t* buffer;
+  size_t start;           // reading: unread bytes are [start, end)
+  size_t end;             // writing: pending bytes are [0, end)
+  char* line;             // readLine scratch for lines that span refills
+  size_t lineCapacity;
+} File;
+
+// Indexed by fd
+static _Thread_local File** files = NULL;
+static _Thread_local int fileCapacity = 0;
+static _Thread_local char fileError[256];
+
+static const char* errnoMessage(const char* what, int err) {
+  snprintf(fileError, sizeof(fileError), "Error: %s failed: %s", what, strerror(err));
+  return fileError;
+}
+
+static File* lookup(int handle, bool writing, const char** error) {
+  if (handle < 0 || handle >= fileCapacity || files[handle] == NULL) {
+    *error = "Error: not an open file handle.";
+    return NULL;
+  }
+  File* file = files[handle];
+  if (file->writing != writing) {
+    *error = writing ? "Error: file handle is not open for writing."
+                     : "Error: file handle is not open for reading.";
+    return NULL;
+  }
+  return file;
+}
+
+static void freeFile(int fd) {
+  File* file = files[fd];
+  files[fd] = NULL;
+  free(file->buffer);
+  free(file->line);
+  free(file);
+}
+
+int fileOpen(const char* path, const char* mode, const char** error) {
+  int flags;
+  if (strcmp(mode, "r") == 0) {
+    flags = O_RDONLY;
+  } else if (strcmp(mode, "w") == 0) {
+    flags = O_WRONLY | O_CREAT | O_TRUNC;
+  } else if (strcmp(mode, "a") == 0) {
+    flags = O_WRONLY | O_CREAT | O_APPEND;
+  } else {
+    *error = "Error: file mode must be \"r\", \"w\" or \"a\".";
+    return -1;
+  }
+
+  int fd;
+  do {
+    fd = open(path, flags | O_CLOEXEC, 0666);
+  } while (fd < 0 && errno == EINTR);
+  if (fd < 0) {
+    snprintf(fileError, sizeof(fileError), "Error: could not open '%s': %s",
+             path, strerror(errno));
+    *error = fileError;
+    return -1;
+  }
+
+  if (fd >= fileCapacity) {
+    int capacity = fileCapacity < 16 ? 16 : fileCapacity;
+    while (capacity <= fd) capacity *= 2;
+    File** grown = realloc(files, sizeof(File*) * (size_t)capacity);
+    if (grown == NULL) {
+      close(fd);
+      *error = "Error: out of memory.";
+      return -1;
+    }
+    memset(grown + fileCapacity, 0, sizeof(File*) * (size_t)(capacity - fileCapacity));
+    files = grown;
+    fileCapacity = capacity;
+  }
+
+  // An fd closed behind our back (e.g. by Lx.proc.close) left a stale entry
+  if (files[fd] != NULL) freeFile(fd);
+
+  File* file = calloc(1, sizeof(File));
+  if (file != NULL) file->buffer = malloc(FILE_BUFFER_SIZE);
+  if (file == NULL || file->buffer == NULL) {
+    free(file);
+    close(fd);
+    *error = "Error: out of memory.";
+    return -1;
+  }
+  file->writing = flags != O_RDONLY;
+  files[fd] = file;
+  return fd;
+}
+
+// Refills an empty read buffer. False on error; hitting end of file sets eof.
+static bool refill(int fd, File* file, const char** error) {
+  file->start = 0;
+  file->end = 0;
+  for (;;) {
+    ssize_t n = read(fd, file->buffer, FILE_BUFFER_SIZE);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) {
+      *error = errnoMessage("read()", errno);
+      return false;
+    }
+    if (n == 0) file->eof = true;
+    file->end = (size_t)n;
+    return true;
+  }
+}
+
+static bool appendLine(File* file, size_t length, const uint8_t* bytes, size_t count,
+                       const char** error) {
+  if (length + count > file->lineCapacity) {
+    size_t capacity = file->lineCapacity < 256 ? 256 : file->lineCapacity;
+    while (capacity < length + count) capacity *= 2;
+    char* grown = realloc(file->line, capacity);
+    if (grown == NULL) {
+      *error = "Error: out of memory.";
+      return false;
+    }
+    file->line = grown;
+    file->lineCapacity = capacity;
+  }
+  memcpy(file->line + length, bytes, count);
+  return true;
+}
+
+static Value lineString(const char* chars, size_t length) {
+  if (length > 0 && chars[length - 1] == '\r') length--;
+  return OBJ_VAL(copyString(chars, (int)length));
+}
+
+bool fileReadLine(int handle, Value* result, const char** error) {
+  File* file = lookup(handle, false, error);
+  if (file == NULL) return false;
+
+  // Common case: the whole line is already buffered
+  if (file->start < file->end) {
+    uint8_t* from = file->buffer + file->start;
+    uint8_t* newline = memchr(from, '\n', file->end - file->start);
+    if (newline != NULL) {
+      file->start = (size_t)(newline - file->buffer) + 1;
+      *result = lineString((const char*)from, (size_t)(newline - from));
+      return true;
+    }
+  }
+
+  size_t length = 0;
+  for (;;) {
+    if (file->start == file->end) {
+      if (file->eof) break;
+      if (!refill(handle, file, error)) return false;
+      if (file->eof) break;
+    }
+    uint8_t* from = file->buffer + file->start;
+    size_t available = file->end - file->start;
+    uint8_t* newline = memchr(from, '\n', available);
+    size_t take = newline != NULL ? (size_t)(newline - from) : available;
+    if (length + take > (size_t)INT32_MAX) {
+      *error = "Error: line too long.";
+      return false;
+    }
+    if (!appendLine(file, length, from, take, error)) return false;
+    length += take;
+    file->start += take;
+    if (newline != NULL) {
+      file->start++;
+      *result = lineString(file->line, length);
+      return true;
+    }
+  }
+
+  // End of file: a last line without "\n", or nothing left at all
+  *result = length > 0 ? lineString(file->line, length) : NIL_VAL;
+  return true;
+}
+
+bool fileReadChunk(int handle, size_t max, Value* result, const char** error) {
+  File* file = lookup(handle, false, error);
+  if (file == NULL) return false;
+  if (max > (size_t)INT32_MAX) max = (size_t)INT32_MAX;
+
+  if (file->start == file->end && !file->eof) {
+    // Big reads skip the buffer entirely
+    if (max >= FILE_BUFFER_SIZE) {
+      char* chunk = malloc(max);
+      if (chunk == NULL) {
+        *error = "Error: out of memory.";
+        return false;
+      }
+      ssize_t n;
+      do {
+        n = read(handle, chunk, max);
+      } while (n < 0 && errno == EINTR);
+      if (n < 0) {
+        free(chunk);
+        *error = errnoMessage("read()", errno);
+        return false;
+      }
+      if (n == 0) file->eof = true;
+      *result = n > 0 ? OBJ_VAL(copyString(chunk, (int)n)) : NIL_VAL;
+      free(chunk);
+      return true;
+    }
+    if (!refill(handle, file, error)) return false;
+  }
+
+  size_t available = file->end - file->start;
+  if (available == 0) {
+    *result = NIL_VAL;
+    return true;
+  }
+  size_t take = available < max ? available : max;
+  *result = OBJ_VAL(copyString((const char*)file->buffer + file->start, (int)take));
+  file->start += take;
+  return true;
+}
+
+static bool writeAll(int fd, const uint8_t* bytes, size_t length, const char** error) {
+  size_t written = 0;
+  while (written < length) {
+    ssize_t n = write(fd, bytes + written, length - written);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      *error = errnoMessage("write()", errno);
+      return false;
+    }
+    written += (size_t)n;
+  }
+  return true;
+}
+
+static bool flushFile(int fd, File* file, const char** error) {
+  if (!file->writing || file->end == 0) return true;
+  size_t pending = file->end;
+  file->end = 0;
+  return writeAll(fd, file->buffer, pending, error);
+}
+
+bool fileWrite(int handle, const uint8_t* bytes, size_t length, const char** error) {
+  File* file = lookup(handle, true, error);
+  if (file == NULL) return false;
+  if (file->end + length > FILE_BUFFER_SIZE && !flushFile(handle, file, error)) {
+    return false;
+  }
+  // Anything at least a buffer long goes straight to the fd
+  if (length >= FILE_BUFFER_SIZE) return writeAll(handle, bytes, length, error);
+  memcpy(file->buffer + file->end, bytes, length);
+  file->end += length;
+  return true;
+}
+
+bool fileFlush(int handle, const char** error) {
+  File* file = lookup(handle, true, error);
+  if (file == NULL) return false;
+  return flushFile(handle, file, error);
+}
+
+bool fileClose(int handle, const char** error) {
+  if (handle < 0 || handle >= fileCapacity || files[handle] == NULL) {
+    *error = "Error: not an open file handle.";
+    return false;
+  }
+  bool ok = flushFile(handle, files[handle], error);
+  freeFile(handle);
+  if (close(handle) != 0 && ok) {
+    *error = errnoMessage("close()", errno);
+    ok = false;
+  }
+  return ok;
+}
+
+void flushFiles(void) {
+  const char* ignored;
+  for (int fd = 0; fd < fileCapacity; fd++) {
+    if (files[fd] != NULL) flushFile(fd, files[fd], &ignored);
+  }
+}
+
+void closeFiles(void) {
+  const char* ignored;
+  for (int fd = 0; fd < fileCapacity; fd++) {
+    if (files[fd] != NULL) fileClose(fd, &ignored);
+  }
+  free(files);
+  files = NULL;
+  fileCapacity = 0;
+}
@@ -0,0 +1,446 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "isolate.h"
+#include "object.h"
+#include "vm.h"
+
+// Interpreter frames and the thread-local VM live on the isolate's stack
+#define ISOLATE_STACK_SIZE (16 * 1024 * 1024)
+// Deeper messages are almost certainly cyclic
+#define MESSAGE_MAX_DEPTH 512
+
+typedef struct Message {
+  struct Message* next;
+  size_t size;
+  uint8_t* data;
+} Message;
+
+typedef struct Isolate {
+  int id;
+  int parentId;
+  pthread_t thread;
+  pthread_cond_t mailReady;
+  Message* mailHead;
+  Message* mailTail;
+  int argc;
+  const char** argv;      // owned, argv[0] is borrowed from the main isolate
+  bool done;
+  bool joining;
+  int exitCode;
+  struct Isolate* next;
+} Isolate;
+
+// One lock guards the registry and every mailbox; messages are copied
+// outside of it.
+static pthread_mutex_t registryLock = PTHREAD_MUTEX_INITIALIZER;
+static Isolate* isolates = NULL;
+static int nextIsolateId = 1;
+static const uint8_t* isolateEntryObj = NULL;
+
+static Isolate mainIsolate;
+static _Thread_local Isolate* currentIsolate = NULL;
+
+void initIsolates(const uint8_t* entryObj) {
+  isolateEntryObj = entryObj;
+  mainIsolate.id = 0;
+  mainIsolate.argc = LX_ARGC;
+  mainIsolate.argv = LX_ARGV;
+  mainIsolate.parentId = -1;
+  pthread_cond_init(&mainIsolate.mailReady, NULL);
+  isolates = &mainIsolate;
+  currentIsolate = &mainIsolate;
+}
+
+static Isolate* findIsolate(int id) {
+  for (Isolate* isolate = isolates; isolate != NULL; isolate = isolate->next) {
+    if (isolate->id == id) return isolate;
+  }
+  return NULL;
+}
+
+static void freeMessages(Message* message) {
+  while (message != NULL) {
+    Message* next = message->next;
+    free(message->data);
+    free(message);
+    message = next;
+  }
+}
+
+// ============================================================================
+// Message encoding
+// ============================================================================
+
+// Tag byte, then:
+//   NUMBER       f64
+//   STRING       u32 length, bytes
+//   ARRAY        u32 count, values
+//   MAP          u32 count, key/value pairs
+//   TYPED_ARRAY  u8 kind, u32 count, raw elements
+typedef enum {
+  MSG_NIL,
+  MSG_FALSE,
+  MSG_TRUE,
+  MSG_NUMBER,
+  MSG_STRING,
+  MSG_ARRAY,
+  MSG_MAP,
+  MSG_TYPED_ARRAY,
+} MessageTag;
+
+typedef struct {
+  uint8_t* data;
+  size_t count;
+  size_t capacity;
+} Buffer;
+
+static void bufferWrite(Buffer* buffer, const void* bytes, size_t length) {
+  if (buffer->count + length > buffer->capacity) {
+    size_t capacity = buffer->capacity < 64 ? 64 : buffer->capacity;
+    while (capacity < buffer->count + length) capacity *= 2;
+    buffer->data = realloc(buffer->data, capacity);
+    if (buffer->data == NULL) {
+      fprintf(stderr, "Out of memory copying an isolate message.\n");
+      exit(70);
+    }
+    buffer->capacity = capacity;
+  }
+  memcpy(buffer->data + buffer->count, bytes, length);
+  buffer->count += length;
+}
+
+static void bufferWriteU8(Buffer* buffer, uint8_t value) {
+  bufferWrite(buffer, &value, 1);
+}
+
+static void bufferWriteU32(Buffer* buffer, uint32_t value) {
+  bufferWrite(buffer, &value, sizeof(value));
+}
+
+static bool encodeValue(Buffer* buffer, Value value, int depth, const char** error) {
+  if (depth > MESSAGE_MAX_DEPTH) {
+    *error = "Error: Lx.isolate.send message nests too deeply (is it cyclic?).";
+    return false;
+  }
+  if (IS_NIL(value)) {
+    bufferWriteU8(buffer, MSG_NIL);
+    return true;
+  }
+  if (IS_BOOL(value)) {
+    bufferWriteU8(buffer, AS_BOOL(value) ? MSG_TRUE : MSG_FALSE);
+    return true;
+  }
+  if (IS_NUMBER(value)) {
+    double number = AS_NUMBER(value);
+    bufferWriteU8(buffer, MSG_NUMBER);
+    bufferWrite(buffer, &number, sizeof(number));
+    return true;
+  }
+  if (IS_STRING(value)) {
+    ObjString* string = AS_STRING(value);
+    bufferWriteU8(buffer, MSG_STRING);
+    bufferWriteU32(buffer, (uint32_t)string->length);
+    bufferWrite(buffer, string->chars, string->length);
+    return true;
+  }
+  if (IS_ARRAY(value)) {
+    ValueArray* array = &AS_ARRAY(value);
+    bufferWriteU8(buffer, MSG_ARRAY);
+    bufferWriteU32(buffer, (uint32_t)array->count);
+    for (int i = 0; i < array->count; i++) {
+      if (!encodeValue(buffer, array->values[i], depth + 1, error)) return false;
+    }
+    return true;
+  }
+  if (IS_HASHMAP(value)) {
+    Table* table = &AS_HASHMAP(value);
+    bufferWriteU8(buffer, MSG_MAP);
+    size_t countAt = buffer->count;
+    uint32_t count = 0;
+    bufferWriteU32(buffer, 0);
+    for (int i = 0; i < table->arrayCapacity; i++) {
+      if (table->arrayPresent == NULL || !table->arrayPresent[i]) continue;
+      if (!encodeValue(buffer, NUMBER_VAL((double)i), depth + 1, error)) return false;
+      if (!encodeValue(buffer, table->arrayValues[i], depth + 1, error)) return false;
+      count++;
+    }
+    for (int i = 0; i < table->capacity; i++) {
+      Entry* entry = &table->entries[i];
+      if (IS_NIL(entry->key)) continue;
+      if (!encodeValue(buffer, entry->key, depth + 1, error)) return false;
+      if (!encodeValue(buffer, entry->value, depth + 1, error)) return false;
+      count++;
+    }
+    memcpy(buffer->data + countAt, &count, sizeof(count));
+    return true;
+  }
+  if (IS_TYPED_ARRAY(value)) {
+    ObjTypedArray* array = AS_TYPED_ARRAY(value);
+    bufferWriteU8(buffer, MSG_TYPED_ARRAY);
+    bufferWriteU8(buffer, (uint8_t)array->kind);
+    bufferWriteU32(buffer, (uint32_t)array->count);
+    bufferWrite(buffer, array->as.u8, typedArrayElementSize(array->kind) * (size_t)array->count);
+    return true;
+  }
+  *error = "Error: Lx.isolate.send only copies nil, booleans, numbers, strings, "
+           "arrays, maps and typed arrays.";
+  return false;
+}
+
+static uint32_t readU32(const uint8_t** at) {
+  uint32_t value;
+  memcpy(&value, *at, sizeof(value));
+  *at += sizeof(value);
+  return value;
+}
+
+// Rebuilds a value on the receiving VM and leaves it on the stack. Every
+// partially built container stays on the stack, so a GC triggered by the
+// next allocation sees it.
+static void decodeValue(const uint8_t** at) {
+  MessageTag tag = (MessageTag)*(*at)++;
+  switch (tag) {
+    case MSG_NIL: push(NIL_VAL); return;
+    case MSG_FALSE: push(FALSE_VAL); return;
+    case MSG_TRUE: push(TRUE_VAL); return;
+    case MSG_NUMBER: {
+      double number;
+      memcpy(&number, *at, sizeof(number));
+      *at += sizeof(number);
+      push(NUMBER_VAL(number));
+      return;
+    }
+    case MSG_STRING: {
+      uint32_t length = readU32(at);
+      push(OBJ_VAL(copyString((const char*)*at, length)));
+      *at += length;
+      return;
+    }
+    case MSG_ARRAY: {
+      uint32_t count = readU32(at);
+      push(OBJ_VAL(newArray()));
+      for (uint32_t i = 0; i < count; i++) {
+        decodeValue(at);
+        writeValueArray(&AS_ARRAY(vm.stackTop[-2]), vm.stackTop[-1]);
+        pop();
+      }
+      return;
+    }
+    case MSG_MAP: {
+      uint32_t count = readU32(at);
+      push(OBJ_VAL(newHashmap()));
+      for (uint32_t i = 0; i < count; i++) {
+        decodeValue(at);
+        decodeValue(at);
+        tableSet(&AS_HASHMAP(vm.stackTop[-3]), vm.stackTop[-2], vm.stackTop[-1]);
+        pop();
+        pop();
+      }
+      return;
+    }
+    case MSG_TYPED_ARRAY: {
+      TypedArrayKind kind = (TypedArrayKind)*(*at)++;
+      uint32_t count = readU32(at);
+      ObjTypedArray* array = newTypedArray(kind, (int)count);
+      size_t size = typedArrayElementSize(kind) * (size_t)count;
+      if (size > 0) memcpy(array->as.u8, *at, size);
+      *at += size;
+      push(OBJ_VAL(array));
+      return;
+    }
+  }
+  push(NIL_VAL);
+}
+
+// ============================================================================
+// Isolate threads
+// ============================================================================
+
+static void finishIsolate(Isolate* self, int exitCode) {
+  pthread_mutex_lock(&registryLock);
+  self->done = true;
+  self->exitCode = exitCode;
+  pthread_mutex_unlock(&registryLock);
+}
+
+static void* isolateMain(void* arg) {
+  Isolate* self = (Isolate*)arg;
+  currentIsolate = self;
+  LX_ARGC = self->argc;
+  LX_ARGV = self->argv;
+
+  initVM();
+  InterpretResult result = interpret((uint8_t*)isolateEntryObj);
+  freeVM();
+
+  int exitCode = 0;
+  if (result == INTERPRET_RUNTIME_ERROR) exitCode = 70;
+  if (result == INTERPRET_COMPILE_ERROR) exitCode = 65;
+  finishIsolate(self, exitCode);
+  return NULL;
+}
+
+int isolateSpawn(const char* path, const char** args, int argCount) {
+  Isolate* isolate = calloc(1, sizeof(Isolate));
+  const char** argv = calloc((size_t)argCount + 3, sizeof(char*));
+  if (isolate == NULL || argv == NULL) {
+    free(isolate);
+    free(argv);
+    return -1;
+  }
+  argv[0] = mainIsolate.argv != NULL ? mainIsolate.argv[0] : "lx";
+  argv[1] = strdup("run");
+  argv[2] = strdup(path);
+  for (int i = 0; i < argCount; i++) argv[3 + i] = strdup(args[i]);
+  isolate->argc = argCount + 3;
+  isolate->argv = argv;
+  isolate->parentId = isolateSelf();
+  pthread_cond_init(&isolate->mailReady, NULL);
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, ISOLATE_STACK_SIZE);
+
+  // Registered before the thread starts so it can receive right away
+  pthread_mutex_lock(&registryLock);
+  isolate->id = nextIsolateId++;
+  isolate->next = isolates;
+  isolates = isolate;
+  int started = pthread_create(&isolate->thread, &attr, isolateMain, isolate);
+  if (started != 0) isolates = isolate->next;
+  pthread_mutex_unlock(&registryLock);
+  pthread_attr_destroy(&attr);
+
+  if (started != 0) {
+    for (int i = 1; i < isolate->argc; i++) free((char*)argv[i]);
+    free(argv);
+    pthread_cond_destroy(&isolate->mailReady);
+    free(isolate);
+    return -1;
+  }
+  return isolate->id;
+}
+
+int isolateSelf(void) {
+  return currentIsolate != NULL ? currentIsolate->id : 0;
+}
+
+int isolateParent(void) {
+  return currentIsolate != NULL ? currentIsolate->parentId : -1;
+}
+
+bool isolateIsSpawned(void) {
+  return currentIsolate != NULL && currentIsolate != &mainIsolate;
+}
+
+void isolateExit(int exitCode) {
+  finishIsolate(currentIsolate, exitCode);
+  pthread_exit(NULL);
+}
+
+bool isolateSend(int id, Value message, const char** error) {
+  Buffer buffer = {0};
+  if (!encodeValue(&buffer, message, 0, error)) {
+    free(buffer.data);
+    return false;
+  }
+  Message* node = malloc(sizeof(Message));
+  if (node == NULL) {
+    free(buffer.data);
+    *error = "Error: Lx.isolate.send out of memory.";
+    return false;
+  }
+  node->next = NULL;
+  node->size = buffer.count;
+  node->data = buffer.data;
+
+  pthread_mutex_lock(&registryLock);
+  Isolate* target = findIsolate(id);
+  if (target == NULL) {
+    pthread_mutex_unlock(&registryLock);
+    freeMessages(node);
+    *error = "Error: Lx.isolate.send to an unknown isolate.";
+    return false;
+  }
+  if (target->mailTail != NULL) {
+    target->mailTail->next = node;
+  } else {
+    target->mailHead = node;
+  }
+  target->mailTail = node;
+  pthread_cond_signal(&target->mailReady);
+  pthread_mutex_unlock(&registryLock);
+  return true;
+}
+
+bool isolateReceive(double timeoutSeconds) {
+  Isolate* self = currentIsolate != NULL ? currentIsolate : &mainIsolate;
+  struct timespec deadline;
+  if (timeoutSeconds >= 0) {
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    double whole = (double)(long)timeoutSeconds;
+    deadline.tv_sec += (time_t)whole;
+    deadline.tv_nsec += (long)((timeoutSeconds - whole) * 1e9);
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec += 1;
+      deadline.tv_nsec -= 1000000000L;
+    }
+  }
+
+  pthread_mutex_lock(&registryLock);
+  while (self->mailHead == NULL) {
+    if (timeoutSeconds < 0) {
+      pthread_cond_wait(&self->mailReady, &registryLock);
+    } else if (pthread_cond_timedwait(&self->mailReady, &registryLock, &deadline) == ETIMEDOUT) {
+      break;
+    }
+  }
+  Message* message = self->mailHead;
+  if (message != NULL) {
+    self->mailHead = message->next;
+    if (self->mailHead == NULL) self->mailTail = NULL;
+  }
+  pthread_mutex_unlock(&registryLock);
+
+  if (message == NULL) return false;
+  const uint8_t* at = message->data;
+  decodeValue(&at);
+  message->next = NULL;
+  freeMessages(message);
+  return true;
+}
+
+bool isolateJoin(int id, int* exitCode) {
+  pthread_mutex_lock(&registryLock);
+  Isolate* isolate = findIsolate(id);
+  if (isolate == NULL || isolate == &mainIsolate || isolate == currentIsolate ||
+      isolate->joining) {
+    pthread_mutex_unlock(&registryLock);
+    return false;
+  }
+  isolate->joining = true;
+  pthread_mutex_unlock(&registryLock);
+
+  pthread_join(isolate->thread, NULL);
+
+  pthread_mutex_lock(&registryLock);
+  for (Isolate** link = &isolates; *link != NULL; link = &(*link)->next) {
+    if (*link == isolate) {
+      *link = isolate->next;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&registryLock);
+
+  *exitCode = isolate->exitCode;
+  freeMessages(isolate->mailHead);
+  for (int i = 1; i < isolate->argc; i++) free((char*)isolate->argv[i]);
+  free(isolate->argv);
+  pthread_cond_destroy(&isolate->mailReady);
+  free(isolate);
+  return true;
+}
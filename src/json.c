@@ -0,0 +1,549 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "json.h"
+#include "object.h"
+#include "vm.h"
+
+static _Thread_local char jsonError[160];
+
+// Index of the first byte at or after `from` that can't sit verbatim inside
+// a JSON string: '"', '\\' or a control character. `length` if none.
+static size_t scanString(const uint8_t* bytes, size_t from, size_t length) {
+#ifdef __SSE2__
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i control = _mm_set1_epi8(0x1f);
+  while (from + 16 <= length) {
+    __m128i chunk = _mm_loadu_si128((const __m128i*)(bytes + from));
+    __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                   _mm_cmpeq_epi8(chunk, backslash));
+    // Unsigned byte <= 0x1f exactly when min(byte, 0x1f) == byte
+    special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+    int mask = _mm_movemask_epi8(special);
+    if (mask != 0) return from + (size_t)__builtin_ctz((unsigned)mask);
+    from += 16;
+  }
+#endif
+  while (from < length) {
+    uint8_t c = bytes[from];
+    if (c == '"' || c == '\\' || c < 0x20) return from;
+    from++;
+  }
+  return length;
+}
+
+// ============================================================================
+// Parsing
+// ============================================================================
+
+typedef struct {
+  const uint8_t* start;
+  const uint8_t* end;
+  const uint8_t* at;
+  char* scratch;          // decoded string bodies that contain escapes
+  size_t scratchCapacity;
+  const char* message;
+} Parser;
+
+static bool fail(Parser* parser, const char* message) {
+  parser->message = message;
+  return false;
+}
+
+static void skipWhitespace(Parser* parser) {
+  while (parser->at < parser->end) {
+    uint8_t c = *parser->at;
+    if (c != ' ' && c != '\n' && c != '\r' && c != '\t') return;
+    parser->at++;
+  }
+}
+
+static bool reserveScratch(Parser* parser, size_t needed) {
+  if (needed <= parser->scratchCapacity) return true;
+  size_t capacity = parser->scratchCapacity < 256 ? 256 : parser->scratchCapacity;
+  while (capacity < needed) capacity *= 2;
+  char* grown = realloc(parser->scratch, capacity);
+  if (grown == NULL) return fail(parser, "out of memory");
+  parser->scratch = grown;
+  parser->scratchCapacity = capacity;
+  return true;
+}
+
+static int hexDigit(uint8_t c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Reads the four hex digits of a \u escape; `at` points past the 'u'.
+static bool readHex4(Parser* parser, uint32_t* code) {
+  if (parser->end - parser->at < 4) return fail(parser, "bad \\u escape");
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++) {
+    int digit = hexDigit(parser->at[i]);
+    if (digit < 0) return fail(parser, "bad \\u escape");
+    value = value << 4 | (uint32_t)digit;
+  }
+  parser->at += 4;
+  *code = value;
+  return true;
+}
+
+static size_t encodeUtf8(uint32_t code, char* out) {
+  if (code < 0x80) {
+    out[0] = (char)code;
+    return 1;
+  }
+  if (code < 0x800) {
+    out[0] = (char)(0xc0 | code >> 6);
+    out[1] = (char)(0x80 | (code & 0x3f));
+    return 2;
+  }
+  if (code < 0x10000) {
+    out[0] = (char)(0xe0 | code >> 12);
+    out[1] = (char)(0x80 | (code >> 6 & 0x3f));
+    out[2] = (char)(0x80 | (code & 0x3f));
+    return 3;
+  }
+  out[0] = (char)(0xf0 | code >> 18);
+  out[1] = (char)(0x80 | (code >> 12 & 0x3f));
+  out[2] = (char)(0x80 | (code >> 6 & 0x3f));
+  out[3] = (char)(0x80 | (code & 0x3f));
+  return 4;
+}
+
+// Decodes one escape into the scratch buffer at *length; `at` points past
+// the backslash.
+static bool readEscape(Parser* parser, size_t* length) {
+  if (parser->at >= parser->end) return fail(parser, "unterminated string");
+  if (!reserveScratch(parser, *length + 4)) return false;
+  char* out = parser->scratch + *length;
+  uint8_t c = *parser->at++;
+  switch (c) {
+    case '"': *out = '"'; break;
+    case '\\': *out = '\\'; break;
+    case '/': *out = '/'; break;
+    case 'b': *out = '\b'; break;
+    case 'f': *out = '\f'; break;
+    case 'n': *out = '\n'; break;
+    case 'r': *out = '\r'; break;
+    case 't': *out = '\t'; break;
+    case 'u': {
+      uint32_t code;
+      if (!readHex4(parser, &code)) return false;
+      if (code >= 0xd800 && code <= 0xdbff) {
+        // A high surrogate only means something followed by a low one
+        uint32_t low = 0;
+        const uint8_t* mark = parser->at;
+        if (parser->end - parser->at >= 6 && parser->at[0] == '\\' && parser->at[1] == 'u') {
+          parser->at += 2;
+          if (!readHex4(parser, &low)) return false;
+        }
+        if (low >= 0xdc00 && low <= 0xdfff) {
+          code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+        } else {
+          parser->at = mark;
+          code = 0xfffd;
+        }
+      } else if (code >= 0xdc00 && code <= 0xdfff) {
+        code = 0xfffd;
+      }
+      *length += encodeUtf8(code, out);
+      return true;
+    }
+    default:
+      parser->at--;
+      return fail(parser, "unknown escape");
+  }
+  *length += 1;
+  return true;
+}
+
+// `at` points at the opening quote. Pushes the string.
+static bool parseString(Parser* parser) {
+  parser->at++;
+  size_t from = (size_t)(parser->at - parser->start);
+  size_t total = (size_t)(parser->end - parser->start);
+  size_t stop = scanString(parser->start, from, total);
+
+  // Common case: no escapes, the body is copied straight out of the input
+  if (stop < total && parser->start[stop] == '"') {
+    push(OBJ_VAL(copyString((const char*)parser->at, stop - from)));
+    parser->at = parser->start + stop + 1;
+    return true;
+  }
+
+  size_t length = 0;
+  for (;;) {
+    size_t run = stop - from;
+    if (!reserveScratch(parser, length + run)) return false;
+    memcpy(parser->scratch + length, parser->start + from, run);
+    length += run;
+    parser->at = parser->start + stop;
+    if (stop == total) return fail(parser, "unterminated string");
+
+    uint8_t c = *parser->at;
+    if (c == '"') break;
+    if (c != '\\') return fail(parser, "control character in string");
+    parser->at++;
+    if (!readEscape(parser, &length)) return false;
+
+    from = (size_t)(parser->at - parser->start);
+    stop = scanString(parser->start, from, total);
+  }
+  parser->at++;
+  push(OBJ_VAL(copyString(parser->scratch, length)));
+  return true;
+}
+
+static bool isDigit(const Parser* parser) {
+  return parser->at < parser->end && *parser->at >= '0' && *parser->at <= '9';
+}
+
+static bool parseNumber(Parser* parser) {
+  const uint8_t* begin = parser->at;
+  bool negative = *parser->at == '-';
+  if (negative) parser->at++;
+  if (!isDigit(parser)) return fail(parser, "bad number");
+  if (*parser->at == '0') {
+    parser->at++;
+  } else {
+    while (isDigit(parser)) parser->at++;
+  }
+  bool integral = true;
+  if (parser->at < parser->end && *parser->at == '.') {
+    integral = false;
+    parser->at++;
+    if (!isDigit(parser)) return fail(parser, "bad number");
+    while (isDigit(parser)) parser->at++;
+  }
+  if (parser->at < parser->end && (*parser->at == 'e' || *parser->at == 'E')) {
+    integral = false;
+    parser->at++;
+    if (parser->at < parser->end && (*parser->at == '+' || *parser->at == '-')) parser->at++;
+    if (!isDigit(parser)) return fail(parser, "bad number");
+    while (isDigit(parser)) parser->at++;
+  }
+
+  size_t length = (size_t)(parser->at - begin);
+  size_t digits = length - (negative ? 1 : 0);
+  // Up to 13 digits always fit a fixnum; skip strtod for those
+  if (integral && digits <= 13) {
+    int64_t value = 0;
+    for (const uint8_t* p = begin + (negative ? 1 : 0); p < parser->at; p++) {
+      value = value * 10 + (*p - '0');
+    }
+    push(FIXNUM_VAL(negative ? -value : value));
+    return true;
+  }
+
+  // The input needn't be NUL-terminated (Bytes), so strtod reads a copy
+  if (!reserveScratch(parser, length + 1)) return false;
+  memcpy(parser->scratch, begin, length);
+  parser->scratch[length] = '\0';
+  double number = strtod(parser->scratch, NULL);
+  if (fabs(number) <= (double)FIXNUM_MAX && number == (double)(int64_t)number) {
+    push(FIXNUM_VAL((int64_t)number));
+  } else {
+    push(NUMBER_VAL(number));
+  }
+  return true;
+}
+
+static bool parseLiteral(Parser* parser, const char* word, Value value) {
+  size_t length = strlen(word);
+  if ((size_t)(parser->end - parser->at) < length ||
+      memcmp(parser->at, word, length) != 0) {
+    return fail(parser, "unexpected character");
+  }
+  parser->at += length;
+  push(value);
+  return true;
+}
+
+// Pushes exactly one value on success. Partially built containers stay on
+// the VM stack, so allocations further down can't collect them.
+static bool parseValue(Parser* parser, int depth) {
+  skipWhitespace(parser);
+  if (parser->at >= parser->end) return fail(parser, "unexpected end of input");
+
+  switch (*parser->at) {
+    case '"':
+      return parseString(parser);
+    case 't':
+      return parseLiteral(parser, "true", TRUE_VAL);
+    case 'f':
+      return parseLiteral(parser, "false", FALSE_VAL);
+    case 'n':
+      return parseLiteral(parser, "null", NIL_VAL);
+    case '[': {
+      if (depth >= JSON_MAX_DEPTH) return fail(parser, "nesting too deep");
+      parser->at++;
+      push(OBJ_VAL(newArray()));
+      skipWhitespace(parser);
+      if (parser->at < parser->end && *parser->at == ']') {
+        parser->at++;
+        return true;
+      }
+      for (;;) {
+        if (!parseValue(parser, depth + 1)) return false;
+        writeValueArray(&AS_ARRAY(vm.stackTop[-2]), vm.stackTop[-1]);
+        pop();
+        skipWhitespace(parser);
+        if (parser->at >= parser->end) return fail(parser, "unexpected end of input");
+        uint8_t c = *parser->at++;
+        if (c == ']') return true;
+        if (c != ',') {
+          parser->at--;
+          return fail(parser, "expected ',' or ']'");
+        }
+      }
+    }
+    case '{': {
+      if (depth >= JSON_MAX_DEPTH) return fail(parser, "nesting too deep");
+      parser->at++;
+      push(OBJ_VAL(newHashmap()));
+      skipWhitespace(parser);
+      if (parser->at < parser->end && *parser->at == '}') {
+        parser->at++;
+        return true;
+      }
+      for (;;) {
+        skipWhitespace(parser);
+        if (parser->at >= parser->end || *parser->at != '"') {
+          return fail(parser, "expected string key");
+        }
+        if (!parseString(parser)) return false;
+        skipWhitespace(parser);
+        if (parser->at >= parser->end || *parser->at != ':') return fail(parser, "expected ':'");
+        parser->at++;
+        if (!parseValue(parser, depth + 1)) return false;
+        tableSet(&AS_HASHMAP(vm.stackTop[-3]), vm.stackTop[-2], vm.stackTop[-1]);
+        pop();
+        pop();
+        skipWhitespace(parser);
+        if (parser->at >= parser->end) return fail(parser, "unexpected end of input");
+        uint8_t c = *parser->at++;
+        if (c == '}') return true;
+        if (c != ',') {
+          parser->at--;
+          return fail(parser, "expected ',' or '}'");
+        }
+      }
+    }
+    default:
+      if (*parser->at == '-' || (*parser->at >= '0' && *parser->at <= '9')) {
+        return parseNumber(parser);
+      }
+      return fail(parser, "unexpected character");
+  }
+}
+
+bool jsonParse(const uint8_t* text, size_t length, Value* result, const char** error) {
+  Parser parser = {
+    .start = text, .end = text + length, .at = text,
+    .scratch = NULL, .scratchCapacity = 0, .message = NULL,
+  };
+  Value* base = vm.stackTop;
+  // Each level holds at most a container, a key and a value
+  bool ok = vm.stackTop - vm.stack + 3 * (JSON_MAX_DEPTH + 1) < vm.stackCapacity;
+  if (!ok) parser.message = "not enough stack";
+  ok = ok && parseValue(&parser, 0);
+  if (ok) {
+    skipWhitespace(&parser);
+    if (parser.at != parser.end) ok = fail(&parser, "unexpected trailing input");
+  }
+  free(parser.scratch);
+
+  if (!ok) {
+    vm.stackTop = base;
+    snprintf(jsonError, sizeof(jsonError), "Error: Lx.json.parse: %s at offset %zu.",
+             parser.message, (size_t)(parser.at - parser.start));
+    *error = jsonError;
+    return false;
+  }
+  *result = pop();
+  return true;
+}
+
+// ============================================================================
+// Stringify
+// ============================================================================
+
+typedef struct {
+  char* data;
+  size_t count;
+  size_t capacity;
+  int indent;
+  const char* error;
+} Output;
+
+static bool reserve(Output* out, size_t extra) {
+  if (out->count + extra <= out->capacity) return true;
+  size_t capacity = out->capacity < 256 ? 256 : out->capacity;
+  while (capacity < out->count + extra) capacity *= 2;
+  char* grown = realloc(out->data, capacity);
+  if (grown == NULL) {
+    out->error = "Error: out of memory.";
+    return false;
+  }
+  out->data = grown;
+  out->capacity = capacity;
+  return true;
+}
+
+static bool emit(Output* out, const void* bytes, size_t length) {
+  if (!reserve(out, length)) return false;
+  memcpy(out->data + out->count, bytes, length);
+  out->count += length;
+  return true;
+}
+
+static bool newline(Output* out, int depth) {
+  if (out->indent == 0) return true;
+  size_t width = (size_t)out->indent * (size_t)depth;
+  if (!reserve(out, width + 1)) return false;
+  out->data[out->count++] = '\n';
+  memset(out->data + out->count, ' ', width);
+  out->count += width;
+  return true;
+}
+
+static bool emitString(Output* out, const uint8_t* bytes, size_t length) {
+  if (!emit(out, "\"", 1)) return false;
+  size_t from = 0;
+  for (;;) {
+    size_t stop = scanString(bytes, from, length);
+    if (!emit(out, bytes + from, stop - from)) return false;
+    if (stop == length) break;
+    uint8_t c = bytes[stop];
+    char escape[8];
+    size_t escapeLength = 2;
+    escape[0] = '\\';
+    switch (c) {
+      case '"': escape[1] = '"'; break;
+      case '\\': escape[1] = '\\'; break;
+      case '\b': escape[1] = 'b'; break;
+      case '\f': escape[1] = 'f'; break;
+      case '\n': escape[1] = 'n'; break;
+      case '\r': escape[1] = 'r'; break;
+      case '\t': escape[1] = 't'; break;
+      default:
+        snprintf(escape, sizeof(escape), "\\u%04x", c);
+        escapeLength = 6;
+        break;
+    }
+    if (!emit(out, escape, escapeLength)) return false;
+    from = stop + 1;
+  }
+  return emit(out, "\"", 1);
+}
+
+static bool emitNumber(Output* out, double number) {
+  if (!isfinite(number)) return emit(out, "null", 4);
+  char text[32];
+  if (fabs(number) < 9e18 && number == (double)(int64_t)number) {
+    char* end = text + sizeof(text);
+    char* p = end;
+    int64_t integer = (int64_t)number;
+    uint64_t magnitude = integer < 0 ? 0 - (uint64_t)integer : (uint64_t)integer;
+    do {
+      *--p = (char)('0' + magnitude % 10);
+      magnitude /= 10;
+    } while (magnitude != 0);
+    if (integer < 0) *--p = '-';
+    return emit(out, p, (size_t)(end - p));
+  }
+  // Shortest of the usual precisions that reads back as the same double
+  int length = snprintf(text, sizeof(text), "%.15g", number);
+  if (strtod(text, NULL) != number) length = snprintf(text, sizeof(text), "%.16g", number);
+  if (strtod(text, NULL) != number) length = snprintf(text, sizeof(text), "%.17g", number);
+  return emit(out, text, (size_t)length);
+}
+
+static bool emitValue(Output* out, Value value, int depth);
+
+static bool emitMember(Output* out, Value key, Value value, bool* first, int depth) {
+  if (!*first && !emit(out, ",", 1)) return false;
+  *first = false;
+  if (!newline(out, depth + 1)) return false;
+  if (IS_STRING(key)) {
+    ObjString* string = AS_STRING(key);
+    if (!emitString(out, (const uint8_t*)string->chars, (size_t)string->length)) return false;
+  } else if (IS_NUMBER(key)) {
+    if (!emit(out, "\"", 1) || !emitNumber(out, AS_NUMBER(key)) || !emit(out, "\"", 1)) {
+      return false;
+    }
+  } else {
+    out->error = "Error: Lx.json.stringify only encodes string and number map keys.";
+    return false;
+  }
+  if (!emit(out, out->indent > 0 ? ": " : ":", out->indent > 0 ? 2 : 1)) return false;
+  return emitValue(out, value, depth + 1);
+}
+
+static bool emitValue(Output* out, Value value, int depth) {
+  if (depth > JSON_MAX_DEPTH) {
+    out->error = "Error: Lx.json.stringify value nests too deeply (is it cyclic?).";
+    return false;
+  }
+  if (IS_NIL(value)) return emit(out, "null", 4);
+  if (IS_BOOL(value)) return AS_BOOL(value) ? emit(out, "true", 4) : emit(out, "false", 5);
+  if (IS_NUMBER(value)) return emitNumber(out, AS_NUMBER(value));
+  if (IS_STRING(value)) {
+    ObjString* string = AS_STRING(value);
+    return emitString(out, (const uint8_t*)string->chars, (size_t)string->length);
+  }
+  if (IS_ARRAY(value)) {
+    ValueArray* array = &AS_ARRAY(value);
+    if (array->count == 0) return emit(out, "[]", 2);
+    if (!emit(out, "[", 1)) return false;
+    for (int i = 0; i < array->count; i++) {
+      if (i > 0 && !emit(out, ",", 1)) return false;
+      if (!newline(out, depth + 1)) return false;
+      if (!emitValue(out, array->values[i], depth + 1)) return false;
+    }
+    return newline(out, depth) && emit(out, "]", 1);
+  }
+  if (IS_HASHMAP(value)) {
+    Table* table = &AS_HASHMAP(value);
+    bool first = true;
+    if (!emit(out, "{", 1)) return false;
+    for (int i = 0; i < table->arrayCapacity; i++) {
+      if (table->arrayPresent == NULL || !table->arrayPresent[i]) continue;
+      if (!emitMember(out, NUMBER_VAL((double)i), table->arrayValues[i], &first, depth)) {
+        return false;
+      }
+    }
+    for (int i = 0; i < table->capacity; i++) {
+      Entry* entry = &table->entries[i];
+      if (IS_NIL(entry->key)) continue;
+      if (!emitMember(out, entry->key, entry->value, &first, depth)) return false;
+    }
+    if (!first && !newline(out, depth)) return false;
+    return emit(out, "}", 1);
+  }
+  out->error = "Error: Lx.json.stringify only encodes nil, booleans, numbers, strings, "
+               "arrays and maps.";
+  return false;
+}
+
+bool jsonStringify(Value value, int indent, Value* result, const char** error) {
+  Output out = { .data = NULL, .count = 0, .capacity = 0, .indent = indent, .error = NULL };
+  if (!emitValue(&out, value, 0)) {
+    free(out.data);
+    *error = out.error;
+    return false;
+  }
+  *result = OBJ_VAL(copyString(out.data, out.count));
+  free(out.data);
+  return true;
+}
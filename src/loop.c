@@ -0,0 +1,705 @@
+#ifdef __linux__
+// syscall() for pidfd_open
+#define _DEFAULT_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#include "loop.h"
+#include "memory.h"
+#include "vm.h"
+
+#define LOOP_MAX_EVENTS 64
+// Reads of at most this many bytes go through a stack buffer
+#define LOOP_READ_STACK_SIZE 65536
+// Child waits without a pidfd are retried on a timer
+#define LOOP_WAIT_POLL_INTERVAL 0.005
+
+struct LoopTask {
+  ObjFiber* fiber;
+  bool parked;            // waiting on op (fd or timer)
+  LoopOp op;
+  Value resumeValue;
+  int timerIndex;         // slot in the timer heap, -1 when not in it
+  LoopTask* nextReady;
+  LoopTask* prev;         // every live task, for marking
+  LoopTask* next;
+};
+
+// At most one parked reader and one parked writer per fd
+typedef struct {
+  LoopTask* reader;
+  LoopTask* writer;
+  uint32_t registered;    // events currently registered with epoll
+} FdWatch;
+
+typedef struct {
+  bool running;
+  LoopTask* current;
+  LoopTask* tasks;
+  int taskCount;
+
+  LoopTask* readyHead;
+  LoopTask* readyTail;
+
+  LoopTask** timers;      // min-heap on op.deadline
+  int timerCount;
+  int timerCapacity;
+
+  FdWatch* fds;
+  int fdCapacity;
+  int watchedFds;
+  int pollFd;             // epoll instance, -1 until first needed
+} EventLoop;
+
+static _Thread_local EventLoop loop = { .pollFd = -1 };
+static _Thread_local char loopError[256];
+
+static const char* errnoMessage(const char* what, int err) {
+  snprintf(loopError, sizeof(loopError), "Error: %s failed: %s", what, strerror(err));
+  return loopError;
+}
+
+double loopNow(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// ============================================================================
+// Operations
+// ============================================================================
+
+static bool fdReady(int fd, short events) {
+  struct pollfd pfd = { .fd = fd, .events = events };
+  int r = poll(&pfd, 1, 0);
+  return r > 0;
+}
+
+static bool writeView(Value data, const uint8_t** bytes, size_t* length) {
+  if (IS_STRING(data)) {
+    *bytes = (const uint8_t*)AS_STRING(data)->chars;
+    *length = AS_STRING(data)->length;
+    return true;
+  }
+  if (IS_TYPED_ARRAY(data)) {
+    ObjTypedArray* array = AS_TYPED_ARRAY(data);
+    if (array->kind != TYPED_BYTES && array->kind != TYPED_UINT8) return false;
+    *bytes = array->as.u8;
+    *length = (size_t)array->count;
+    return true;
+  }
+  return false;
+}
+
+// Plain fds (stdin, pipes from Lx.proc.pipe) stay blocking, so reads and
+// writes only happen once poll() says they won't block: a read returns what
+// is available and a pipe write of at most PIPE_BUF bytes always fits.
+static LoopStatus tryRead(LoopOp* op, Value* result, const char** error) {
+  if (!fdReady(op->fd, POLLIN)) return LOOP_AGAIN;
+  // The string is copied out at its actual length, so a short read never
+  // keeps a readMax-sized allocation alive.
+  char stackBuffer[LOOP_READ_STACK_SIZE];
+  char* buffer = stackBuffer;
+  if (op->readMax > sizeof(stackBuffer)) {
+    buffer = malloc(op->readMax);
+    if (buffer == NULL) {
+      *error = "Error: out of memory.";
+      return LOOP_FAILED;
+    }
+  }
+  ssize_t n = read(op->fd, buffer, op->readMax);
+  if (n > 0) *result = OBJ_VAL(copyString(buffer, (size_t)n));
+  int err = errno;
+  if (buffer != stackBuffer) free(buffer);
+  if (n < 0) {
+    if (err == EAGAIN || err == EWOULDBLOCK || err == EINTR) return LOOP_AGAIN;
+    *error = errnoMessage("read()", err);
+    return LOOP_FAILED;
+  }
+  if (n == 0) *result = NIL_VAL;
+  return LOOP_DONE;
+}
+
+static LoopStatus tryWrite(LoopOp* op, Value* result, const char** error) {
+  const uint8_t* bytes;
+  size_t length;
+  if (!writeView(op->data, &bytes, &length)) {
+    *error = "Error: Lx.loop.write takes a string or Bytes.";
+    return LOOP_FAILED;
+  }
+  int flags = fcntl(op->fd, F_GETFL);
+  bool nonBlocking = flags >= 0 && (flags & O_NONBLOCK);
+
+  while (op->written < length) {
+    if (!fdReady(op->fd, POLLOUT)) return LOOP_AGAIN;
+    size_t chunk = length - op->written;
+    if (!nonBlocking && chunk > PIPE_BUF) chunk = PIPE_BUF;
+    // MSG_NOSIGNAL: a closed peer is an error, not a SIGPIPE
+    ssize_t n = send(op->fd, bytes + op->written, chunk, MSG_NOSIGNAL);
+    if (n < 0 && errno == ENOTSOCK) n = write(op->fd, bytes + op->written, chunk);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return LOOP_AGAIN;
+      *error = errnoMessage("write()", errno);
+      return LOOP_FAILED;
+    }
+    op->written += (size_t)n;
+  }
+  *result = NUMBER_VAL((double)length);
+  return LOOP_DONE;
+}
+
+static LoopStatus tryAccept(LoopOp* op, Value* result, const char** error) {
+  if (!fdReady(op->fd, POLLIN)) return LOOP_AGAIN;
+  int fd = accept(op->fd, NULL, NULL);
+  if (fd < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ||
+        errno == ECONNABORTED) {
+      return LOOP_AGAIN;
+    }
+    *error = errnoMessage("accept()", errno);
+    return LOOP_FAILED;
+  }
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  *result = NUMBER_VAL(fd);
+  return LOOP_DONE;
+}
+
+static LoopStatus tryConnect(LoopOp* op, Value* result, const char** error) {
+  if (!fdReady(op->fd, POLLOUT)) return LOOP_AGAIN;
+  int err = 0;
+  socklen_t len = sizeof(err);
+  if (getsockopt(op->fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0) err = errno;
+  if (err != 0) {
+    close(op->fd);
+    *error = errnoMessage("connect()", err);
+    return LOOP_FAILED;
+  }
+  *result = NUMBER_VAL(op->fd);
+  return LOOP_DONE;
+}
+
+static LoopStatus tryReadAll(LoopOp* op, Value* result, const char** error) {
+  ObjTypedArray* bytes = AS_TYPED_ARRAY(op->data);
+  for (;;) {
+    if (!fdReady(op->fd, POLLIN)) return LOOP_AGAIN;
+    if (bytes->count == bytes->capacity) {
+      if (bytes->capacity > INT_MAX / 2) {
+        *error = "Error: Lx.proc.readAll input too large.";
+        return LOOP_FAILED;
+      }
+      typedArrayReserve(bytes, bytes->capacity + 64 * 1024);
+    }
+    ssize_t n = read(op->fd, bytes->as.u8 + bytes->count, (size_t)(bytes->capacity - bytes->count));
+    if (n == 0) break;
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return LOOP_AGAIN;
+      *error = errnoMessage("read()", errno);
+      return LOOP_FAILED;
+    }
+    bytes->count += (int)n;
+  }
+  *result = op->data;
+  return LOOP_DONE;
+}
+
+// Shell convention: the exit status, or 128 + signal when killed
+static int exitCodeOf(int status) {
+  return WIFEXITED(status) ? WEXITSTATUS(status)
+       : WIFSIGNALED(status) ? 128 + WTERMSIG(status)
+       : 1;
+}
+
+static LoopStatus finishWait(LoopOp* op, pid_t pid, int status, Value* result) {
+  if (op->pid > 0) {
+    *result = NUMBER_VAL(exitCodeOf(status));
+    return LOOP_DONE;
+  }
+  ObjHashmap* map = newHashmap();
+  push(OBJ_VAL(map));
+  push(OBJ_VAL(copyString("pid", 3)));
+  tableSet(&map->table, vm.stackTop[-1], NUMBER_VAL(pid));
+  pop();
+  push(OBJ_VAL(copyString("code", 4)));
+  tableSet(&map->table, vm.stackTop[-1], NUMBER_VAL(exitCodeOf(status)));
+  pop();
+  *result = pop();
+  return LOOP_DONE;
+}
+
+static LoopStatus waitChild(LoopOp* op, Value* result, const char** error, int flags) {
+  int status = 0;
+  pid_t r;
+  do {
+    r = waitpid(op->pid, &status, flags);
+  } while (r < 0 && errno == EINTR);
+  if (r == 0) return LOOP_AGAIN;
+  if (r < 0 && errno == ECHILD && op->pid < 0) {
+    *result = NIL_VAL;
+    return LOOP_DONE;
+  }
+  if (r < 0) {
+    *error = errnoMessage("waitpid()", errno);
+    return LOOP_FAILED;
+  }
+  return finishWait(op, r, status, result);
+}
+
+LoopStatus loopTry(LoopOp* op, Value* result, const char** error) {
+  switch (op->kind) {
+    case LOOP_OP_READ_ALL: return tryReadAll(op, result, error);
+    case LOOP_OP_WAIT: return waitChild(op, result, error, WNOHANG);
+    case LOOP_OP_READ: return tryRead(op, result, error);
+    case LOOP_OP_WRITE: return tryWrite(op, result, error);
+    case LOOP_OP_ACCEPT: return tryAccept(op, result, error);
+    case LOOP_OP_CONNECT: return tryConnect(op, result, error);
+    case LOOP_OP_SLEEP:
+      if (loopNow() < op->deadline) return LOOP_AGAIN;
+      *result = NIL_VAL;
+      return LOOP_DONE;
+  }
+  return LOOP_AGAIN;
+}
+
+static short opEvents(LoopOp* op) {
+  return (op->kind == LOOP_OP_WRITE || op->kind == LOOP_OP_CONNECT) ? POLLOUT : POLLIN;
+}
+
+LoopStatus loopBlock(LoopOp* op, Value* result, const char** error) {
+  if (op->kind == LOOP_OP_WAIT) return waitChild(op, result, error, 0);
+  for (;;) {
+    LoopStatus status = loopTry(op, result, error);
+    if (status != LOOP_AGAIN) return status;
+    if (op->kind == LOOP_OP_SLEEP) {
+      double remaining = op->deadline - loopNow();
+      if (remaining <= 0) continue;
+      struct timespec req;
+      req.tv_sec = (time_t)remaining;
+      req.tv_nsec = (long)((remaining - (double)req.tv_sec) * 1e9);
+      nanosleep(&req, NULL);
+    } else {
+      struct pollfd pfd = { .fd = op->fd, .events = opEvents(op) };
+      poll(&pfd, 1, -1);
+    }
+  }
+}
+
+// ============================================================================
+// Task bookkeeping
+// ============================================================================
+
+static void enqueueReady(LoopTask* task, Value resumeValue) {
+  task->resumeValue = resumeValue;
+  task->nextReady = NULL;
+  if (loop.readyTail != NULL) {
+    loop.readyTail->nextReady = task;
+  } else {
+    loop.readyHead = task;
+  }
+  loop.readyTail = task;
+}
+
+static bool timerBefore(int a, int b) {
+  return loop.timers[a]->op.deadline < loop.timers[b]->op.deadline;
+}
+
+static void timerSwap(int a, int b) {
+  LoopTask* t = loop.timers[a];
+  loop.timers[a] = loop.timers[b];
+  loop.timers[b] = t;
+  loop.timers[a]->timerIndex = a;
+  loop.timers[b]->timerIndex = b;
+}
+
+static void timerSiftUp(int i) {
+  while (i > 0 && timerBefore(i, (i - 1) / 2)) {
+    timerSwap(i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+}
+
+static void timerSiftDown(int i) {
+  for (;;) {
+    int smallest = i;
+    int left = 2 * i + 1;
+    int right = left + 1;
+    if (left < loop.timerCount && timerBefore(left, smallest)) smallest = left;
+    if (right < loop.timerCount && timerBefore(right, smallest)) smallest = right;
+    if (smallest == i) return;
+    timerSwap(i, smallest);
+    i = smallest;
+  }
+}
+
+static bool timerPush(LoopTask* task) {
+  if (loop.timerCount == loop.timerCapacity) {
+    int capacity = loop.timerCapacity < 8 ? 8 : loop.timerCapacity * 2;
+    LoopTask** timers = realloc(loop.timers, sizeof(LoopTask*) * capacity);
+    if (timers == NULL) return false;
+    loop.timers = timers;
+    loop.timerCapacity = capacity;
+  }
+  task->timerIndex = loop.timerCount;
+  loop.timers[loop.timerCount++] = task;
+  timerSiftUp(task->timerIndex);
+  return true;
+}
+
+static void timerRemove(LoopTask* task) {
+  int i = task->timerIndex;
+  if (i < 0) return;
+  task->timerIndex = -1;
+  loop.timerCount--;
+  if (i == loop.timerCount) return;
+  loop.timers[i] = loop.timers[loop.timerCount];
+  loop.timers[i]->timerIndex = i;
+  timerSiftDown(i);
+  timerSiftUp(i);
+}
+
+static bool ensureFdWatch(int fd) {
+  if (fd < loop.fdCapacity) return true;
+  int capacity = loop.fdCapacity < 64 ? 64 : loop.fdCapacity;
+  while (capacity <= fd) capacity *= 2;
+  FdWatch* fds = realloc(loop.fds, sizeof(FdWatch) * capacity);
+  if (fds == NULL) return false;
+  memset(fds + loop.fdCapacity, 0, sizeof(FdWatch) * (capacity - loop.fdCapacity));
+  loop.fds = fds;
+  loop.fdCapacity = capacity;
+  return true;
+}
+
+// Brings the poller's registration for fd in line with its parked tasks.
+static bool updateWatch(int fd, const char** error) {
+  FdWatch* watch = &loop.fds[fd];
+  uint32_t want = 0;
+#ifdef __linux__
+  if (watch->reader != NULL) want |= EPOLLIN;
+  if (watch->writer != NULL) want |= EPOLLOUT;
+  if (want == watch->registered) return true;
+
+  if (loop.pollFd < 0) {
+    loop.pollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop.pollFd < 0) {
+      *error = errnoMessage("epoll_create1()", errno);
+      return false;
+    }
+  }
+  struct epoll_event event = { .events = want, .data.fd = fd };
+  int op = watch->registered == 0 ? EPOLL_CTL_ADD
+         : want == 0 ? EPOLL_CTL_DEL
+         : EPOLL_CTL_MOD;
+  int r = epoll_ctl(loop.pollFd, op, fd, &event);
+  // close() drops the registration behind our back; start over
+  if (r < 0 && errno == ENOENT && want != 0) {
+    r = epoll_ctl(loop.pollFd, EPOLL_CTL_ADD, fd, &event);
+  } else if (r < 0 && errno == ENOENT) {
+    r = 0;
+  }
+  if (r < 0) {
+    *error = errnoMessage("epoll_ctl()", errno);
+    return false;
+  }
+#else
+  if (watch->reader != NULL) want |= POLLIN;
+  if (watch->writer != NULL) want |= POLLOUT;
+#endif
+  if (watch->registered == 0 && want != 0) loop.watchedFds++;
+  if (watch->registered != 0 && want == 0) loop.watchedFds--;
+  watch->registered = want;
+  return true;
+}
+
+static void unpark(LoopTask* task) {
+  if (!task->parked) return;
+  task->parked = false;
+  if (task->timerIndex >= 0) {
+    timerRemove(task);
+    return;
+  }
+  int fd = task->op.fd;
+  if (fd < 0 || fd >= loop.fdCapacity) return;
+  FdWatch* watch = &loop.fds[fd];
+  if (watch->reader == task) watch->reader = NULL;
+  if (watch->writer == task) watch->writer = NULL;
+  const char* ignored;
+  updateWatch(fd, &ignored);
+  // The pidfd opened by loopSuspend
+  if (task->op.kind == LOOP_OP_WAIT) close(fd);
+}
+
+bool loopCanSuspend(void) {
+  return loop.running && loop.current != NULL &&
+         vm.currentFiber == loop.current->fiber && vm.nonYieldableDepth == 0;
+}
+
+bool loopSuspend(LoopOp* op, const char** error) {
+  LoopTask* task = loop.current;
+  task->op = *op;
+
+  // A pidfd turns a child's exit into a readable fd; without one the wait
+  // is retried on a short timer.
+  if (op->kind == LOOP_OP_WAIT) {
+    task->op.fd = -1;
+#ifdef SYS_pidfd_open
+    if (op->pid > 0) task->op.fd = (int)syscall(SYS_pidfd_open, op->pid, 0);
+#endif
+    if (task->op.fd < 0) {
+      task->op.deadline = loopNow() + LOOP_WAIT_POLL_INTERVAL;
+      if (!timerPush(task)) {
+        *error = "Error: out of memory.";
+        return false;
+      }
+      task->parked = true;
+      return true;
+    }
+    fcntl(task->op.fd, F_SETFD, FD_CLOEXEC);
+    op = &task->op;
+  }
+
+  if (op->kind == LOOP_OP_SLEEP) {
+    if (!timerPush(task)) {
+      *error = "Error: out of memory.";
+      return false;
+    }
+    task->parked = true;
+    return true;
+  }
+
+  if (op->fd < 0 || !ensureFdWatch(op->fd)) {
+    *error = "Error: invalid file descriptor.";
+    return false;
+  }
+  FdWatch* watch = &loop.fds[op->fd];
+  LoopTask** slot = opEvents(op) == POLLIN ? &watch->reader : &watch->writer;
+  if (*slot != NULL) {
+    snprintf(loopError, sizeof(loopError),
+             "Error: another task is already waiting to %s fd %d.",
+             slot == &watch->reader ? "read" : "write", op->fd);
+    *error = loopError;
+    return false;
+  }
+  *slot = task;
+  if (!updateWatch(op->fd, error)) {
+    *slot = NULL;
+    return false;
+  }
+  task->parked = true;
+  return true;
+}
+
+bool loopIsRunning(void) {
+  return loop.running;
+}
+
+void loopSetRunning(bool running) {
+  loop.running = running;
+  if (!running) loop.current = NULL;
+}
+
+void loopSpawn(ObjFiber* fiber) {
+  LoopTask* task = calloc(1, sizeof(LoopTask));
+  if (task == NULL) {
+    fprintf(stderr, "Out of memory spawning a loop task.\n");
+    exit(70);
+  }
+  task->fiber = fiber;
+  task->timerIndex = -1;
+  task->next = loop.tasks;
+  if (loop.tasks != NULL) loop.tasks->prev = task;
+  loop.tasks = task;
+  loop.taskCount++;
+  enqueueReady(task, NIL_VAL);
+}
+
+bool loopHasTasks(void) {
+  return loop.taskCount > 0;
+}
+
+LoopTask* loopNextReady(Value* resumeValue) {
+  LoopTask* task = loop.readyHead;
+  if (task == NULL) {
+    loop.current = NULL;
+    return NULL;
+  }
+  loop.readyHead = task->nextReady;
+  if (loop.readyHead == NULL) loop.readyTail = NULL;
+  task->nextReady = NULL;
+  *resumeValue = task->resumeValue;
+  task->resumeValue = NIL_VAL;
+  loop.current = task;
+  return task;
+}
+
+ObjFiber* loopTaskFiber(LoopTask* task) {
+  return task->fiber;
+}
+
+void loopTaskSuspended(LoopTask* task) {
+  loop.current = NULL;
+  // A task that yielded on its own just goes to the back of the queue
+  if (!task->parked) enqueueReady(task, NIL_VAL);
+}
+
+void loopTaskFinished(LoopTask* task) {
+  loop.current = NULL;
+  unpark(task);
+  if (task->prev != NULL) {
+    task->prev->next = task->next;
+  } else {
+    loop.tasks = task->next;
+  }
+  if (task->next != NULL) task->next->prev = task->prev;
+  loop.taskCount--;
+  free(task);
+}
+
+// Retries a parked op after its fd reported ready.
+static bool complete(LoopTask* task, const char** error) {
+  Value result = NIL_VAL;
+  LoopStatus status = loopTry(&task->op, &result, error);
+  if (status == LOOP_AGAIN) return true;
+  if (status == LOOP_FAILED) return false;
+  unpark(task);
+  enqueueReady(task, result);
+  return true;
+}
+
+static int pollTimeoutMs(void) {
+  if (loop.timerCount == 0) return -1;
+  double wait = loop.timers[0]->op.deadline - loopNow();
+  if (wait <= 0) return 0;
+  return (int)ceil(wait * 1000.0);
+}
+
+bool loopPoll(const char** error) {
+  if (loop.readyHead != NULL) return true;
+  if (loop.watchedFds == 0 && loop.timerCount == 0) {
+    *error = "Error: Lx.loop.run has tasks suspended with nothing to wait for.";
+    return false;
+  }
+
+  int timeout = pollTimeoutMs();
+#ifdef __linux__
+  struct epoll_event events[LOOP_MAX_EVENTS];
+  int count = 0;
+  if (loop.watchedFds > 0) {
+    count = epoll_wait(loop.pollFd, events, LOOP_MAX_EVENTS, timeout);
+    if (count < 0 && errno != EINTR) {
+      *error = errnoMessage("epoll_wait()", errno);
+      return false;
+    }
+  } else if (timeout > 0) {
+    poll(NULL, 0, timeout);
+  }
+  for (int i = 0; i < count; i++) {
+    int fd = events[i].data.fd;
+    uint32_t ready = events[i].events;
+    FdWatch* watch = &loop.fds[fd];
+    if ((ready & (EPOLLIN | EPOLLERR | EPOLLHUP)) && watch->reader != NULL) {
+      if (!complete(watch->reader, error)) return false;
+    }
+    if ((ready & (EPOLLOUT | EPOLLERR | EPOLLHUP)) && watch->writer != NULL) {
+      if (!complete(watch->writer, error)) return false;
+    }
+  }
+#else
+  struct pollfd* pfds = malloc(sizeof(struct pollfd) * (loop.watchedFds + 1));
+  int count = 0;
+  for (int fd = 0; fd < loop.fdCapacity; fd++) {
+    if (loop.fds[fd].registered == 0) continue;
+    pfds[count].fd = fd;
+    pfds[count].events = (short)loop.fds[fd].registered;
+    pfds[count].revents = 0;
+    count++;
+  }
+  int r = poll(pfds, count, timeout);
+  if (r < 0 && errno != EINTR) {
+    free(pfds);
+    *error = errnoMessage("poll()", errno);
+    return false;
+  }
+  for (int i = 0; r > 0 && i < count; i++) {
+    FdWatch* watch = &loop.fds[pfds[i].fd];
+    short ready = pfds[i].revents;
+    if ((ready & (POLLIN | POLLERR | POLLHUP)) && watch->reader != NULL &&
+        !complete(watch->reader, error)) {
+      free(pfds);
+      return false;
+    }
+    if ((ready & (POLLOUT | POLLERR | POLLHUP)) && watch->writer != NULL &&
+        !complete(watch->writer, error)) {
+      free(pfds);
+      return false;
+    }
+  }
+  free(pfds);
+#endif
+
+  double now = loopNow();
+  while (loop.timerCount > 0 && loop.timers[0]->op.deadline <= now) {
+    LoopTask* task = loop.timers[0];
+    if (task->op.kind == LOOP_OP_SLEEP) {
+      unpark(task);
+      enqueueReady(task, NIL_VAL);
+      continue;
+    }
+    // Polled op: retry, re-arming the timer while it is still pending
+    timerRemove(task);
+    Value result = NIL_VAL;
+    LoopStatus status = loopTry(&task->op, &result, error);
+    if (status == LOOP_FAILED) return false;
+    if (status == LOOP_AGAIN) {
+      task->op.deadline = now + LOOP_WAIT_POLL_INTERVAL;
+      if (!timerPush(task)) {
+        *error = "Error: out of memory.";
+        return false;
+      }
+      continue;
+    }
+    task->parked = false;
+    enqueueReady(task, result);
+  }
+  return true;
+}
+
+void loopReset(void) {
+  while (loop.tasks != NULL) loopTaskFinished(loop.tasks);
+  loop.readyHead = NULL;
+  loop.readyTail = NULL;
+}
+
+void markEventLoop(void) {
+  for (LoopTask* task = loop.tasks; task != NULL; task = task->next) {
+    markObject((Obj*)task->fiber);
+    markValue(task->resumeValue);
+    markValue(task->op.data);
+  }
+}
+
+void freeEventLoop(void) {
+  loopReset();
+  free(loop.timers);
+  free(loop.fds);
+  if (loop.pollFd >= 0) close(loop.pollFd);
+  loop = (EventLoop){ .pollFd = -1 };
+}
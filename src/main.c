@@ -5,6 +5,8 @@
 
 #include "common.h"
 #include "vm.h"
+#include "isolate.h"
+#include "print.h"
 #include "lx/lxlx.h"
 
 int main(int argc, const char* argv[]) {
@@ -14,6 +16,8 @@ int main(int argc, const char* argv[]) {
 
   LX_ARGC = argc;
   LX_ARGV = argv;
+  initIsolates(lxlx_bytecode);
+  initStdout();
 
   initVM();
 
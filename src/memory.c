@@ -1,6 +1,9 @@
 #include <stdlib.h>
 
+#include "loop.h"
 #include "memory.h"
+#include "objloader.h"
+#include "text.h"
 #include "vm.h"
 
 #ifdef DEBUG_LOG_GC
@@ -96,6 +99,8 @@ static void blackenObject(Obj* object) {
       markObject((Obj*)function->name);
       markObject((Obj*)function->filename);
       markArray(&function->chunk.constants);
+      markValue(function->moduleValue);
+      if (function->lazyUnit != NULL) markLazyUnit(function->lazyUnit);
       break;
     }
     case OBJ_UPVALUE:
@@ -118,6 +123,9 @@ static void blackenObject(Obj* object) {
       markArray(&((ObjArray*)object)->array);
       break;
     }
+    case OBJ_TYPED_ARRAY:
+      // Unboxed numbers, nothing to trace
+      break;
     case OBJ_FIBER: {
       ObjFiber* fiber = (ObjFiber*)object;
 
@@ -166,6 +174,7 @@ static void freeObject(Obj* object) {
     }
     case OBJ_FUNCTION: {
       ObjFunction* function = (ObjFunction*)object;
+      if (function->lazyUnit != NULL) releaseLazyFunction(function);
       freeChunk(&function->chunk);
       FREE(ObjFunction, object);
       break;
@@ -175,7 +184,10 @@ static void freeObject(Obj* object) {
       break;
     case OBJ_STRING: {
       ObjString* string = (ObjString*)object;
-      FREE_ARRAY(char, string->chars, string->length + 1);
+      if (!object->isBorrowed) {
+        FREE_ARRAY(char, string->chars, string->length + 1);
+      }
+      textIndexFree(string->index);
       FREE(ObjString, object);
       break;
     }
@@ -202,6 +214,9 @@ static void freeObject(Obj* object) {
       FREE(ObjArray, object);
       break;
     }
+    case OBJ_TYPED_ARRAY:
+      freeTypedArray((ObjTypedArray*)object);
+      break;
     case OBJ_FIBER: {
       ObjFiber* fiber = (ObjFiber*)object;
       if (fiber->ownsStack && fiber->stack != NULL) {
@@ -223,6 +238,7 @@ void freeObjects() {
     freeObject(object);
     object = next;
   }
+  sweepLazyUnits();
 
   free(vm.grayStack);
 }
@@ -259,6 +275,8 @@ static void markRoots() {
   markTable(&vm.globals);
   markValue(vm.lastResult);
   markValue(vm.lastError);
+  markEventLoop();
+  markLoaderRoots();
 }
 
 static void traceReferences() {
@@ -307,6 +325,7 @@ void collectGarbage() {
   traceReferences();
   tableRemoveWhite(&vm.strings);
   sweep();
+  sweepLazyUnits();
 
   vm.nextGC = vm.bytesAllocated * GC_HEAP_GROW_FACTOR;
 
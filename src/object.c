@@ -1,3 +1,4 @@
+#include <math.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -18,6 +19,7 @@ static Obj* allocateObject(size_t size, ObjType type) {
   Obj* object = (Obj*)reallocate(NULL, 0, size);
   object->type = type;
   object->isMarked = false;
+  object->isBorrowed = false;
 
   object->next = vm.objects;
   vm.objects = object;
@@ -48,6 +50,11 @@ ObjFunction* newFunction() {
   function->upvalueCount = 0;
   function->name = NULL;
   function->filename = NULL;
+  function->lazyUnit = NULL;
+  function->lazyBody = NULL;
+  function->sharedModule = false;
+  function->moduleLoaded = false;
+  function->moduleValue = NIL_VAL;
   initChunk(&function->chunk);
   return function;
 }
@@ -64,6 +71,7 @@ static ObjString* allocateString(char* chars, int length, uint64_t hash) {
   string->length = length;
   string->chars = chars;
   string->hash = hash;
+  string->index = NULL;
 
   push(OBJ_VAL(string));
   tableSet(&vm.strings, OBJ_VAL(string), NIL_VAL);
@@ -161,6 +169,7 @@ ObjString* takeString(char* chars, int length) {
   string->length = length;
   string->chars = chars;
   string->hash = hash;
+  string->index = NULL;
   return string;
 }
 
@@ -189,6 +198,33 @@ ObjString* copyString(const char* chars, size_t length) {
   string->length = length;
   string->chars = heapChars;
   string->hash = hash;
+  string->index = NULL;
+  return string;
+}
+
+// Wrap NUL-terminated bytes owned by someone else (a mapped lxobj) without
+// copying them. The caller guarantees chars[length] == '\0' and that the
+// bytes outlive every reference to the string.
+ObjString* borrowString(const char* chars, size_t length) {
+  uint64_t hash = hashString(chars, length);
+
+  if (length <= (size_t)INTERN_MAX_LEN) {
+    ObjString* interned = tableFindString(&vm.strings, chars, length, hash);
+    if (interned != NULL) return interned;
+  }
+
+  ObjString* string = ALLOCATE_OBJ(ObjString, OBJ_STRING);
+  string->obj.isBorrowed = true;
+  string->length = length;
+  string->chars = (char*)chars;
+  string->hash = hash;
+  string->index = NULL;
+
+  if (length <= (size_t)INTERN_MAX_LEN) {
+    push(OBJ_VAL(string));
+    tableSet(&vm.strings, OBJ_VAL(string), NIL_VAL);
+    pop();
+  }
   return string;
 }
 
@@ -220,6 +256,72 @@ ObjArray* newArray() {
   return array;
 }
 
+size_t typedArrayElementSize(TypedArrayKind kind) {
+  switch (kind) {
+    case TYPED_FLOAT64: return sizeof(double);
+    case TYPED_INT32: return sizeof(int32_t);
+    case TYPED_UINT8:
+    case TYPED_BYTES: return sizeof(uint8_t);
+  }
+  return 1;
+}
+
+ObjTypedArray* newTypedArray(TypedArrayKind kind, int count) {
+  // Allocate storage before the object so a GC triggered by either
+  // allocation never sees a half-initialized typed array.
+  size_t bytes = typedArrayElementSize(kind) * (size_t)count;
+  void* data = NULL;
+  if (bytes > 0) {
+    data = reallocate(NULL, 0, bytes);
+    memset(data, 0, bytes);
+  }
+  ObjTypedArray* array = ALLOCATE_OBJ(ObjTypedArray, OBJ_TYPED_ARRAY);
+  array->kind = kind;
+  array->count = count;
+  array->capacity = count;
+  array->as.u8 = (uint8_t*)data;
+  return array;
+}
+
+void freeTypedArray(ObjTypedArray* array) {
+  if (array->as.u8 != NULL) {
+    reallocate(array->as.u8, typedArrayElementSize(array->kind) * (size_t)array->capacity, 0);
+  }
+  FREE(ObjTypedArray, array);
+}
+
+// Grow storage to hold at least `capacity` elements; new slots are zeroed.
+// The caller must keep `array` reachable, since this may trigger a GC.
+void typedArrayReserve(ObjTypedArray* array, int capacity) {
+  if (capacity <= array->capacity) return;
+  int newCapacity = GROW_CAPACITY(array->capacity);
+  if (newCapacity < capacity) newCapacity = capacity;
+  size_t elementSize = typedArrayElementSize(array->kind);
+  size_t oldBytes = elementSize * (size_t)array->capacity;
+  size_t newBytes = elementSize * (size_t)newCapacity;
+  array->as.u8 = reallocate(array->as.u8, oldBytes, newBytes);
+  memset(array->as.u8 + oldBytes, 0, newBytes - oldBytes);
+  array->capacity = newCapacity;
+}
+
+const char* typedArrayKindName(TypedArrayKind kind) {
+  switch (kind) {
+    case TYPED_FLOAT64: return "Float64Array";
+    case TYPED_INT32: return "Int32Array";
+    case TYPED_UINT8: return "Uint8Array";
+    case TYPED_BYTES: return "Bytes";
+  }
+  return "TypedArray";
+}
+
+uint32_t doubleToUint32Bits(double value) {
+  // ToUint32: truncate, then wrap modulo 2^32 (NaN/Inf become 0)
+  if (!isfinite(value)) return 0;
+  double wrapped = fmod(trunc(value), 4294967296.0);
+  if (wrapped < 0) wrapped += 4294967296.0;
+  return (uint32_t)wrapped;
+}
+
 #define INITIAL_FIBER_STACK_CAPACITY STACK_MAX
 #define INITIAL_FIBER_FRAME_CAPACITY FRAMES_MAX
 
@@ -383,6 +485,17 @@ void writeObject(Writer* writer, Value value) {
         writerWrite(writer, "]", 1);
         break;
       }
+    case OBJ_TYPED_ARRAY:
+      {
+        ObjTypedArray* array = AS_TYPED_ARRAY(value);
+        writerPrintf(writer, "%s[", typedArrayKindName(array->kind));
+        for (int i = 0; i < array->count; ++i) {
+          if (i > 0) writerWrite(writer, ",", 1);
+          writeValue(writer, typedArrayGet(array, i));
+        }
+        writerWrite(writer, "]", 1);
+        break;
+      }
     case OBJ_FIBER:
       {
         ObjFiber* fiber = AS_FIBER(value);
@@ -3,22 +3,22 @@
 #include <math.h>
 #include <stdlib.h>
 #include <zlib.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "debug.h"
 #include "objloader.h"
 #include "object.h"
 
-// functions contains actual function, or a index ref (-> functions[index])
-ValueArray functions;
-ChunkIndexes chunkIndexes;
-
 // Filepath table for v2 format
 typedef struct {
   ObjString** paths;
   int count;
 } FilepathTable;
 
-static FilepathTable filepathTable;
+static _Thread_local FilepathTable filepathTable;
 
 // lxobj layout v2
 //
@@ -28,6 +28,8 @@ static FilepathTable filepathTable;
 //   FLAGS:               1
 //     bit0 (0x01): debug sections present
 //     bit1 (0x02): payload is zlib-compressed
+//     bit2 (0x04): mappable (never compressed; every STRING const is
+//                  followed by a NUL byte counted in CONST_SEC_SIZE)
 //   OBJSIZE:             4  u32 LE (total file size: header + stored payload)
 //   CHUNKS:              4  u32 LE (number of chunks)
 //   MAIN_ID:             4  u32 LE (entry chunk id)
@@ -62,6 +64,15 @@ static FilepathTable filepathTable;
 //           DEBUG_SIZE:  4  u32 LE
 //           FILEPATH_INDEX: 2 u16 LE (index into filepath table)
 //           LINE_RLE:    repeated records of (REPEAT:1 u8, LINE:2 u16 LE)
+//
+// A mappable obj loaded through loadObjFile is not copied: chunk code and
+// string constants point straight into a private read-only mapping of the
+// file that lives for the rest of the process, so cold start pays for one
+// checksum pass over the file instead of inflating and copying it.
+
+#define OBJ_FLAG_DEBUG      0x01
+#define OBJ_FLAG_COMPRESSED 0x02
+#define OBJ_FLAG_MAPPABLE   0x04
 
 double readDouble(const uint8_t* bytes) {
   double n = 0;
@@ -227,28 +238,6 @@ bool objIsValid(uint8_t* bytes) {
   return true;
 }
 
-void initChunkIndexes(ChunkIndexes* array) {
-  array->values = NULL;
-  array->capacity = 0;
-  array->count = 0;
-}
-
-void writeChunkIndexes(ChunkIndexes* array, ChunkValueIndex value) {
-  if (array->capacity < array->count + 1) {
-    int oldCapacity = array->capacity;
-    array->capacity = GROW_CAPACITY(oldCapacity);
-    array->values = GROW_ARRAY(ChunkValueIndex, array->values,
-                               oldCapacity, array->capacity);
-  }
-  array->values[array->count] = value;
-  array->count++;
-}
-
-void freeChunkIndexes(ChunkIndexes* array) {
-  FREE_ARRAY(ChunkValueIndex, array->values, array->capacity);
-  initChunkIndexes(array);
-}
-
 // Decompress payload for v2 format
 static uint8_t* decompressPayload(uint8_t* compressed, size_t compressedLen, size_t* uncompressedLen) {
   // Start with reasonable buffer and grow if needed
@@ -295,7 +284,7 @@ static bool parseFilepathTable(uint8_t* bytes, size_t tableSize) {
   ptr += 2;
 
   filepathTable.count = count;
-  filepathTable.paths = malloc(sizeof(ObjString*) * count);
+  filepathTable.paths = calloc(count, sizeof(ObjString*));
   if (!filepathTable.paths) {
     fprintf(stderr, "Failed to allocate filepath table\n");
     return false;
@@ -311,51 +300,38 @@ static bool parseFilepathTable(uint8_t* bytes, size_t tableSize) {
   return true;
 }
 
-ObjFunction* loadFunction(uint8_t* bytes, uint8_t flags, uint8_t version) {
-  bool debug = (flags & 0b00000001) > 0;
+// Decode the part of an ACTUAL chunk every caller needs up front: arity,
+// upvalue count, name and (debug) filename. Code and constants are left for
+// decodeFunctionBody; *body is set to the CODE_SIZE field.
+static ObjFunction* loadFunctionHeader(uint8_t* bytes, uint8_t flags, uint8_t version,
+                                       uint8_t** body) {
+  bool debug = (flags & OBJ_FLAG_DEBUG) > 0;
 
   ObjFunction* func = newFunction();
   push(OBJ_VAL(func));
-  Chunk* chunk = &func->chunk;
-
-  uint8_t* code_start = bytes;
 
-  func->arity = code_start[0];
-  func->upvalueCount = code_start[1];
-  code_start += 2;
-
-  // read function name
-  size_t funcNameLength = getShortSize(code_start);
+  uint8_t* ptr = bytes;
+  func->arity = ptr[0];
+  func->upvalueCount = ptr[1];
+  ptr += 2;
 
-  code_start += 2;
+  size_t funcNameLength = getShortSize(ptr);
+  ptr += 2;
   if (funcNameLength > 0) {
-    func->name = copyString((char*)code_start, funcNameLength);
-    code_start += funcNameLength;
+    func->name = copyString((char*)ptr, funcNameLength);
+    ptr += funcNameLength;
   }
+  *body = ptr;
 
-  size_t code_size = getSize(code_start);
-  code_start += 4;
-
-  if (!debug) {
-    for (size_t i = 0; i < code_size; i++) {
-      writeChunk(chunk, code_start[i], 1);
-    }
-  } else {
-    // to gather debug line info, we must fastforward
-    // to debug line section first, so we can write chunk with line info
-    uint8_t* ptr = &code_start[code_size];
-    size_t constSectionSize = getSize(ptr);
-
-    // const section size (4) + actual consts
-    ptr += 4 + constSectionSize;
-    // debug lines size (4)
-    // size_t debugLinesSize = getSize(ptr);
+  if (debug) {
+    // CODE_SIZE + CODE, CONST_SEC_SIZE + CONSTS, DEBUG_SIZE
+    ptr += 4 + getSize(ptr);
+    ptr += 4 + getSize(ptr);
     ptr += 4;
 
     // v2 uses filepath index, v1 uses full filepath string
     if (version == 2) {
       size_t filepathIndex = getShortSize(ptr);
-      ptr += 2;
       if (filepathIndex < (size_t)filepathTable.count) {
         func->filename = filepathTable.paths[filepathIndex];
       } else {
@@ -363,10 +339,48 @@ ObjFunction* loadFunction(uint8_t* bytes, uint8_t flags, uint8_t version) {
         func->filename = copyString("[unknown]", 9);
       }
     } else {
-      size_t filenameSize = getShortSize(ptr);
+      func->filename = copyString((char*)&ptr[2], getShortSize(ptr));
+    }
+  }
+  return func;
+}
+
+// Decode code, line info and constants of a chunk whose header was read by
+// loadFunctionHeader. Function constants resolve through `functions`, so
+// every chunk in the obj must already have its stub.
+static bool decodeFunctionBody(ObjFunction* func, uint8_t* body, uint8_t flags,
+                               uint8_t version, bool borrow, ValueArray* functions) {
+  bool debug = (flags & OBJ_FLAG_DEBUG) > 0;
+  bool mappable = (flags & OBJ_FLAG_MAPPABLE) > 0;
+  Chunk* chunk = &func->chunk;
+
+  uint8_t* code_start = body;
+  size_t code_size = getSize(code_start);
+  code_start += 4;
+
+  if (borrow) {
+    chunk->borrowed = true;
+    chunk->code = code_start;
+    chunk->count = code_size;
+  }
+
+  if (!debug) {
+    // borrowed chunks carry no line table outside debug builds
+    if (!borrow) {
+      for (size_t i = 0; i < code_size; i++) {
+        writeChunk(chunk, code_start[i], 1);
+      }
+    }
+  } else {
+    // line info lives after the constants: skip CONST_SEC_SIZE + consts and
+    // DEBUG_SIZE, then the filepath index (v2) or filepath string (v1)
+    uint8_t* ptr = &code_start[code_size];
+    ptr += 4 + getSize(ptr);
+    ptr += 4;
+    if (version == 2) {
       ptr += 2;
-      func->filename = copyString((char*)ptr, filenameSize);
-      ptr += filenameSize;
+    } else {
+      ptr += 2 + getShortSize(ptr);
     }
     // ptr is now at the start of line numbers!!!
 
@@ -375,6 +389,9 @@ ObjFunction* loadFunction(uint8_t* bytes, uint8_t flags, uint8_t version) {
     ptr++;
     size_t line = getShortSize(ptr);
 
+    if (borrow && code_size > 0) {
+      chunk->lines = ALLOCATE(uint32_t, code_size);
+    }
     for (size_t i = 0; i < code_size; i++) {
       if (++repeated > repeatTimes) {
         ptr += 2;
@@ -383,7 +400,11 @@ ObjFunction* loadFunction(uint8_t* bytes, uint8_t flags, uint8_t version) {
         ptr++;
         line = getShortSize(ptr);
       }
-      writeChunk(chunk, code_start[i], line);
+      if (borrow) {
+        chunk->lines[i] = line;
+      } else {
+        writeChunk(chunk, code_start[i], line);
+      }
     }
   }
 
@@ -421,51 +442,139 @@ ObjFunction* loadFunction(uint8_t* bytes, uint8_t flags, uint8_t version) {
         switch (objType) {
           case OBJ_FUNCTION: {
             int functionId = (int)getSize(&constSection[2]);
-            // add nil constant, & save the value pointer to an array
-            // after all chunks(functions) are loaded and saved to global functions var,
-            // we will iterate through value pointer,
-            // and do valuePointer[i] = OBJ_VAL(functions[i])
-            int index = addConstant(chunk, NIL_VAL);
-            writeChunkIndexes(&chunkIndexes, (ChunkValueIndex){chunk, index, functionId});
+            if (functionId >= functions->count) {
+              fprintf(stderr, "Invalid lxobj: function index out of bounds.\n");
+              return false;
+            }
+            Value funcValue = functions->values[functionId];
+            if (IS_NUMBER(funcValue)) {
+              // REF chunk: shared module compiled once under another id
+              funcValue = functions->values[(int)AS_NUMBER(funcValue)];
+            }
+            addConstant(chunk, funcValue);
             // value type + obj type + function id
             constSection += (1 + 1 + 4);
             break;
           }
           case OBJ_STRING: {
             size_t ssize = getSize(&constSection[2]);
-            addConstant(chunk,
-                OBJ_VAL(copyString((char*)&constSection[6], ssize)));
-            // value type + obj type + 4(ssize) + actual string
-            constSection += (1 + 1 + 4 + ssize);
+            const char* chars = (const char*)&constSection[6];
+            addConstant(chunk, OBJ_VAL(borrow ? borrowString(chars, ssize)
+                                              : copyString(chars, ssize)));
+            // value type + obj type + 4(ssize) + actual string (+ NUL)
+            constSection += (1 + 1 + 4 + ssize + (mappable ? 1 : 0));
             break;
           }
           default:
             fprintf(stderr, "Invalid object type %x\n", objType);
-            return NULL;
+            return false;
         }
         break;
       }
 
       default:
         fprintf(stderr, "Invalid value type %x\n", type);
-        return NULL;
+        return false;
     }
   }
-  return func;
+  return true;
 }
 
-ObjFunction* loadObj(uint8_t* bytes, bool printCode) {
+// Lazy units
+//
+// A lazily loaded obj keeps its payload and chunk table in a LazyUnit. Every
+// function stub points at the unit until its body is decoded on first call
+// (see materializeFunction). A reachable stub keeps the whole unit alive, so
+// function constants decoded later can still resolve to their stubs; once no
+// stub is pending the unit and its payload are released.
+
+static _Thread_local LazyUnit* lazyUnits = NULL;
+
+static LazyUnit* newLazyUnit(uint8_t* payload, bool ownsPayload, uint8_t flags,
+                             uint8_t version, bool borrow) {
+  LazyUnit* unit = ALLOCATE(LazyUnit, 1);
+  unit->payload = payload;
+  unit->ownsPayload = ownsPayload;
+  unit->flags = flags;
+  unit->version = version;
+  unit->borrow = borrow;
+  // held by the loader until every stub is attached, see loadObjBytes
+  unit->pending = 1;
+  unit->isMarked = false;
+  initValueArray(&unit->functions);
+  unit->next = lazyUnits;
+  lazyUnits = unit;
+  return unit;
+}
+
+void markLazyUnit(LazyUnit* unit) {
+  if (unit->isMarked) return;
+  unit->isMarked = true;
+  for (int i = 0; i < unit->functions.count; i++) {
+    markValue(unit->functions.values[i]);
+  }
+}
+
+void sweepLazyUnits() {
+  LazyUnit** link = &lazyUnits;
+  while (*link != NULL) {
+    LazyUnit* unit = *link;
+    unit->isMarked = false;
+    if (unit->pending > 0) {
+      link = &unit->next;
+      continue;
+    }
+    *link = unit->next;
+    if (unit->ownsPayload) free(unit->payload);
+    freeValueArray(&unit->functions);
+    FREE(LazyUnit, unit);
+  }
+}
+
+void releaseLazyFunction(ObjFunction* function) {
+  function->lazyUnit->pending--;
+  function->lazyUnit = NULL;
+  function->lazyBody = NULL;
+}
+
+bool materializeFunction(ObjFunction* function) {
+  LazyUnit* unit = function->lazyUnit;
+  // the stub keeps unit reachable while constants allocate
+  bool ok = decodeFunctionBody(function, function->lazyBody, unit->flags,
+                               unit->version, unit->borrow, &unit->functions);
+  releaseLazyFunction(function);
+  return ok;
+}
+
+// Path strings are only referenced from this table until the functions
+// that use them are created.
+void markLoaderRoots() {
+  for (int i = 0; i < filepathTable.count; i++) {
+    if (filepathTable.paths[i] != NULL) markObject((Obj*)filepathTable.paths[i]);
+  }
+}
+
+static void freeFilepathTable() {
+  if (filepathTable.paths) {
+    free(filepathTable.paths);
+  }
+  filepathTable.paths = NULL;
+  filepathTable.count = 0;
+}
+
+static ObjFunction* loadObjBytes(uint8_t* bytes, bool printCode, bool borrow,
+                                 bool shareModules) {
   if (!objIsValid(bytes)) {
     return NULL;
   }
   ObjFunction* main = NULL;
+  ValueArray functions;
   initValueArray(&functions);
-  initChunkIndexes(&chunkIndexes);
 
   uint8_t version = bytes[2];
   uint8_t flags = bytes[3];
-  bool debug = (flags & 0b00000001) > 0;
-  bool compressed = (flags & 0b00000010) > 0;
+  bool debug = (flags & OBJ_FLAG_DEBUG) > 0;
+  bool compressed = (flags & OBJ_FLAG_COMPRESSED) > 0;
   int mainId = (int)getSize(&bytes[12]);
   size_t chunks_count = getSize(&bytes[8]);
 
@@ -473,6 +582,8 @@ ObjFunction* loadObj(uint8_t* bytes, bool printCode) {
   uint8_t* payload = &bytes[32];
   size_t payloadSize = getSize(&bytes[4]) - 32;
   uint8_t* allocatedPayload = NULL;
+  filepathTable.count = 0;
+  filepathTable.paths = NULL;
 
   if (version == 2) {
     uint32_t expectedCrc = getSize(&bytes[16]);
@@ -490,7 +601,9 @@ ObjFunction* loadObj(uint8_t* bytes, bool printCode) {
       payloadSize = uncompressedSize;
     }
 
-    // Validate CRC32
+    // Validate CRC32. Borrowed loads check it too: a mapped file may have
+    // been truncated or corrupted on disk (compile cache entries live in the
+    // user's cache dir), and its code runs in place.
     uLong actualCrc = crc32(0L, Z_NULL, 0);
     actualCrc = crc32(actualCrc, payload, payloadSize);
     if (actualCrc != expectedCrc) {
@@ -505,10 +618,29 @@ ObjFunction* loadObj(uint8_t* bytes, bool printCode) {
         if (allocatedPayload) free(allocatedPayload);
         return NULL;
       }
+    }
+  }
+
+  // Bodies are decoded on first call for v2 objs, unless the whole obj is
+  // about to be disassembled anyway. A lazy unit needs the payload to outlive
+  // this call: a mapping or decompressed buffer already does, caller bytes
+  // are copied.
+  LazyUnit* unit = NULL;
+  if (version == 2 && !printCode) {
+    if (borrow || allocatedPayload != NULL) {
+      unit = newLazyUnit(payload, allocatedPayload != NULL, flags, version, borrow);
     } else {
-      filepathTable.count = 0;
-      filepathTable.paths = NULL;
+      uint8_t* owned = malloc(payloadSize);
+      if (owned == NULL) {
+        fprintf(stderr, "Failed to allocate lxobj payload\n");
+        freeFilepathTable();
+        return NULL;
+      }
+      memcpy(owned, payload, payloadSize);
+      payload = owned;
+      unit = newLazyUnit(payload, true, flags, version, borrow);
     }
+    allocatedPayload = NULL;
   }
 
   // Find start of chunks (after filepath table for v2)
@@ -517,7 +649,11 @@ ObjFunction* loadObj(uint8_t* bytes, bool printCode) {
     chunk_start += getSize(&bytes[20]); // Skip filepath table
   }
 
-  uint8_t shared_module_count = 0;
+  // Pass 1: a stub per ACTUAL chunk; REF chunks record their target id
+  ValueArray* table = unit != NULL ? &unit->functions : &functions;
+  uint8_t** bodies = ALLOCATE(uint8_t*, chunks_count);
+  ObjFunction** stubs = ALLOCATE(ObjFunction*, chunks_count);
+  size_t actual_count = 0;
 
   for (size_t i = 0; i < chunks_count; i++) {
     size_t chunk_size = getSize(chunk_start);
@@ -527,42 +663,45 @@ ObjFunction* loadObj(uint8_t* bytes, bool printCode) {
 
     int chunkId = (int)getSize(ptr);
     ptr += 4;
+    bodies[i] = NULL;
+    stubs[i] = NULL;
 
     if (chunkType == CHUNK_TYPE_REF) {
       int targetId = (int)getSize(ptr);
-      writeValueArrayAt(&functions, chunkId, NUMBER_VAL(targetId));
-      shared_module_count++;
+      writeValueArrayAt(table, chunkId, NUMBER_VAL(targetId));
     } else {
-      ObjFunction* func = loadFunction(ptr, flags, version);
-      if (func == NULL) {
-        if (allocatedPayload) free(allocatedPayload);
-        return NULL;
-      }
+      ObjFunction* func = loadFunctionHeader(ptr, flags, version, &bodies[i]);
+      func->sharedModule = shareModules;
+      stubs[i] = func;
+      actual_count++;
       if (chunkId == mainId) main = func;
-      writeValueArrayAt(&functions, chunkId, OBJ_VAL(func));
+      writeValueArrayAt(table, chunkId, OBJ_VAL(func));
+      if (unit != NULL) {
+        func->lazyUnit = unit;
+        func->lazyBody = bodies[i];
+        unit->pending++;
+      }
     }
     chunk_start += 4 + chunk_size;
   }
 
-  for (size_t i = 0; i < chunkIndexes.count; i++) {
-    ChunkValueIndex chunkIndex = chunkIndexes.values[i];
-    int functionId = chunkIndex.functionId;
-    if (functionId >= functions.count) {
-      fprintf(stderr, "Invalid lxobj: function index out of bounds.\n");
-      return NULL;
-    }
-
-    Value funcValue = functions.values[functionId];
-    if (IS_NUMBER(funcValue)) {
-      int index = AS_NUMBER(funcValue);
-      funcValue = functions.values[index];
+  // Pass 2: decode every body now unless they are left for first call
+  bool ok = true;
+  if (unit == NULL) {
+    for (size_t i = 0; i < chunks_count && ok; i++) {
+      if (stubs[i] == NULL) continue;
+      ok = decodeFunctionBody(stubs[i], bodies[i], flags, version, borrow, &functions);
     }
-    chunkIndex.chunk->constants.values[chunkIndex.index] = funcValue;
   }
+  FREE_ARRAY(uint8_t*, bodies, chunks_count);
+  FREE_ARRAY(ObjFunction*, stubs, chunks_count);
 
-  for (size_t i = 0; i < chunks_count - shared_module_count; i++) pop();
+  // stubs were kept on the stack while bodies allocated
+  for (size_t i = 0; i < actual_count; i++) pop();
+  if (unit != NULL) unit->pending--;
+  if (!ok) main = NULL;
 
-  if (printCode) {
+  if (ok && printCode) {
     for (int i = 0; i < functions.count; i++) {
       if (IS_NUMBER(functions.values[i])) {
         int index = AS_NUMBER(functions.values[i]);
@@ -582,17 +721,50 @@ ObjFunction* loadObj(uint8_t* bytes, bool printCode) {
   }
 
   freeValueArray(&functions);
-  freeChunkIndexes(&chunkIndexes);
-
-  // Cleanup v2 resources
   if (allocatedPayload) {
     free(allocatedPayload);
   }
-  if (version == 2 && filepathTable.paths) {
-    free(filepathTable.paths);
-    filepathTable.paths = NULL;
-    filepathTable.count = 0;
+  freeFilepathTable();
+
+  return main;
+}
+
+ObjFunction* loadObj(uint8_t* bytes, bool printCode) {
+  return loadObjBytes(bytes, printCode, false, false);
+}
+
+ObjFunction* loadObjSharingModules(uint8_t* bytes) {
+  return loadObjBytes(bytes, false, false, true);
+}
+
+ObjFunction* loadObjFile(const char* path, bool printCode, bool* isObj) {
+  *isObj = false;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return NULL;
+
+  struct stat st;
+  uint8_t header[32];
+  if (fstat(fd, &st) != 0 || st.st_size < 32 ||
+      pread(fd, header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+      header[0] != 'L' || header[1] != 'X' || header[2] != 2 ||
+      getSize(&header[4]) != (size_t)st.st_size) {
+    close(fd);
+    return NULL;
+  }
+  *isObj = true;
+
+  uint8_t* bytes = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (bytes == MAP_FAILED) {
+    fprintf(stderr, "Failed to map lxobj %s\n", path);
+    return NULL;
   }
 
+  uint8_t flags = header[3];
+  bool borrow = (flags & OBJ_FLAG_MAPPABLE) && !(flags & OBJ_FLAG_COMPRESSED);
+  ObjFunction* main = loadObjBytes(bytes, printCode, borrow, false);
+  // Borrowed code and strings (possibly already interned, even when the load
+  // failed) keep pointing into the mapping, so it is never unmapped.
+  if (!borrow) munmap(bytes, st.st_size);
   return main;
 }
@@ -1,6 +1,7 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include "print.h"
 
@@ -46,6 +47,10 @@ static void fileWrite(void* ctx, const char* data, size_t len) {
   (void)fwrite(data, 1, len, (FILE*)ctx);
 }
 
+void initStdout(void) {
+  setvbuf(stdout, NULL, isatty(STDOUT_FILENO) ? _IOLBF : _IOFBF, STDOUT_BUFFER_SIZE);
+}
+
 Writer writerForFile(FILE* file) {
   Writer writer;
   writer.write = fileWrite;
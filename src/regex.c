@@ -0,0 +1,1559 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "regex.h"
+
+#define REGEX_MAX_PROGRAM 50000
+#define REGEX_MAX_REPEAT 1000
+#define REGEX_MAX_DEPTH 250
+#define REGEX_CACHE_SIZE 64
+// Past this many bytes of states a DFA starts over from an empty cache, so
+// a pattern that explodes into many states costs time, never memory.
+#define DFA_CACHE_BYTES (2 * 1024 * 1024)
+
+static _Thread_local char regexError[160];
+
+// Like reallocate(), running out of memory here is fatal; the engine's
+// structures are plain C memory and never seen by the GC.
+static void* grow(void* pointer, size_t size) {
+  void* result = realloc(pointer, size);
+  if (result == NULL) exit(1);
+  return result;
+}
+
+// ============================================================================
+// Programs
+// ============================================================================
+
+typedef enum {
+  INST_BYTES,   // consume one byte in sets[x]
+  INST_SPLIT,   // continue at x, then (lower priority) at y
+  INST_JMP,     // continue at x
+  INST_SAVE,    // record the position in slot x
+  INST_ASSERT,  // continue only if assertion x holds here
+  INST_MATCH,
+} InstOp;
+
+typedef enum {
+  ASSERT_BEGIN_TEXT,
+  ASSERT_END_TEXT,
+  ASSERT_WORD_BOUNDARY,
+  ASSERT_NOT_WORD_BOUNDARY,
+} AssertKind;
+
+typedef struct {
+  uint8_t op;
+  int x;
+  int y;
+} Inst;
+
+typedef struct {
+  Inst* code;
+  int count;
+  int capacity;
+  int start;  // first instruction of the pattern itself
+} Program;
+
+typedef struct {
+  uint64_t bits[4];
+} ByteSet;
+
+static inline bool setHas(const ByteSet* set, uint8_t byte) {
+  return (set->bits[byte >> 6] >> (byte & 63)) & 1;
+}
+
+static void setAddRange(ByteSet* set, int lo, int hi) {
+  for (int b = lo; b <= hi; b++) set->bits[b >> 6] |= (uint64_t)1 << (b & 63);
+}
+
+// ============================================================================
+// DFA state cache
+// ============================================================================
+
+// A state is the ordered list of NFA threads alive before following empty
+// transitions, plus whether start-of-text assertions hold. The consuming
+// instructions reached from there are computed once, when the state is made.
+typedef struct DState {
+  struct DState** next;  // per byte class, NULL until first taken
+  int* pcs;
+  int count;
+  int* threads;
+  int threadCount;
+  uint64_t hash;
+  bool start;
+  bool match;       // a match ends here
+  bool matchAtEnd;  // a match ends here if this is the end of the input
+} DState;
+
+typedef struct {
+  const Program* program;
+  bool longest;  // keep going after a match instead of cutting lower threads
+  DState** table;
+  int capacity;
+  int stateCount;
+  size_t memory;
+  DState* startStates[2];
+  int* stack;
+  int* pcs;
+  int* closure;
+  uint32_t* mark;
+  uint32_t generation;
+} Dfa;
+
+typedef struct {
+  int* pcs;
+  size_t* slots;  // slotCount per thread
+  uint32_t* mark;
+  uint32_t generation;
+  int count;
+} ThreadList;
+
+typedef struct {
+  int pc;  // -1: restore slots[slot] to old
+  int slot;
+  size_t old;
+} Frame;
+
+struct Regex {
+  Program forward;  // unanchored prefix, then SAVE 0, pattern, SAVE 1, MATCH
+  Program reverse;  // the pattern reversed, then MATCH
+  ByteSet* sets;
+  int setCount;
+  int setCapacity;
+  int groups;
+  char** names;
+  bool dfaUsable;
+  uint8_t classOf[256];
+  uint8_t classRep[256];
+  int classCount;
+  Dfa* forwardDfa;
+  Dfa* reverseDfa;
+  Frame* pikeStack;  // Pike VM buffers, made on first use
+  ThreadList pikeLists[2];
+};
+
+// ============================================================================
+// Parsing
+// ============================================================================
+
+typedef enum {
+  NODE_EMPTY,
+  NODE_BYTES,
+  NODE_CONCAT,
+  NODE_ALT,
+  NODE_REPEAT,
+  NODE_GROUP,
+  NODE_ASSERT,
+} NodeKind;
+
+typedef struct Node {
+  NodeKind kind;
+  int value;     // set index, group index (0 = non-capturing) or assertion
+  int min, max;  // NODE_REPEAT; max -1 means unbounded
+  bool greedy;
+  struct Node** children;
+  int count;
+  int capacity;
+} Node;
+
+typedef struct {
+  uint32_t lo, hi;
+} Range;
+
+typedef struct {
+  Range* items;
+  int count;
+  int capacity;
+} Ranges;
+
+typedef struct {
+  const char* start;
+  const char* at;
+  const char* end;
+  Regex* re;
+  bool caseless;
+  bool dotAll;
+  Node** nodes;  // every node, for freeing
+  int nodeCount;
+  int nodeCapacity;
+  int nameCapacity;
+  const char* message;
+} ReParser;
+
+static bool fail(ReParser* parser, const char* message) {
+  if (parser->message == NULL) parser->message = message;
+  return false;
+}
+
+static Node* newNode(ReParser* parser, NodeKind kind) {
+  if (parser->nodeCount == parser->nodeCapacity) {
+    parser->nodeCapacity = parser->nodeCapacity < 16 ? 16 : parser->nodeCapacity * 2;
+    parser->nodes = grow(parser->nodes, sizeof(Node*) * (size_t)parser->nodeCapacity);
+  }
+  Node* node = calloc(1, sizeof(Node));
+  if (node == NULL) exit(1);
+  node->kind = kind;
+  parser->nodes[parser->nodeCount++] = node;
+  return node;
+}
+
+static void addChild(Node* node, Node* child) {
+  if (node->count == node->capacity) {
+    node->capacity = node->capacity < 4 ? 4 : node->capacity * 2;
+    node->children = grow(node->children, sizeof(Node*) * (size_t)node->capacity);
+  }
+  node->children[node->count++] = child;
+}
+
+static int newSet(Regex* re) {
+  if (re->setCount == re->setCapacity) {
+    re->setCapacity = re->setCapacity < 16 ? 16 : re->setCapacity * 2;
+    re->sets = grow(re->sets, sizeof(ByteSet) * (size_t)re->setCapacity);
+  }
+  memset(&re->sets[re->setCount], 0, sizeof(ByteSet));
+  return re->setCount++;
+}
+
+static Node* bytesNode(ReParser* parser, int lo, int hi) {
+  Node* node = newNode(parser, NODE_BYTES);
+  node->value = newSet(parser->re);
+  setAddRange(&parser->re->sets[node->value], lo, hi);
+  return node;
+}
+
+static void addRange(Ranges* ranges, uint32_t lo, uint32_t hi) {
+  if (ranges->count == ranges->capacity) {
+    ranges->capacity = ranges->capacity < 8 ? 8 : ranges->capacity * 2;
+    ranges->items = grow(ranges->items, sizeof(Range) * (size_t)ranges->capacity);
+  }
+  ranges->items[ranges->count++] = (Range){lo, hi};
+}
+
+static int compareRanges(const void* a, const void* b) {
+  uint32_t x = ((const Range*)a)->lo;
+  uint32_t y = ((const Range*)b)->lo;
+  return x < y ? -1 : x > y;
+}
+
+static void normalizeRanges(Ranges* ranges) {
+  if (ranges->count == 0) return;
+  qsort(ranges->items, (size_t)ranges->count, sizeof(Range), compareRanges);
+  int out = 0;
+  for (int i = 1; i < ranges->count; i++) {
+    Range* last = &ranges->items[out];
+    Range next = ranges->items[i];
+    if (next.lo <= last->hi + 1) {
+      if (next.hi > last->hi) last->hi = next.hi;
+    } else {
+      ranges->items[++out] = next;
+    }
+  }
+  ranges->count = out + 1;
+}
+
+static void foldRanges(Ranges* ranges) {
+  int count = ranges->count;
+  for (int i = 0; i < count; i++) {
+    uint32_t lo = ranges->items[i].lo;
+    uint32_t hi = ranges->items[i].hi;
+    if (lo <= 'Z' && hi >= 'A') {
+      addRange(ranges, (lo < 'A' ? 'A' : lo) + 32, (hi > 'Z' ? 'Z' : hi) + 32);
+    }
+    if (lo <= 'z' && hi >= 'a') {
+      addRange(ranges, (lo < 'a' ? 'a' : lo) - 32, (hi > 'z' ? 'z' : hi) - 32);
+    }
+  }
+}
+
+static void negateRanges(Ranges* ranges) {
+  normalizeRanges(ranges);
+  Ranges result = {NULL, 0, 0};
+  uint32_t next = 0;
+  for (int i = 0; i < ranges->count; i++) {
+    if (ranges->items[i].lo > next) addRange(&result, next, ranges->items[i].lo - 1);
+    next = ranges->items[i].hi + 1;
+  }
+  if (next <= 0x10ffff) addRange(&result, next, 0x10ffff);
+  free(ranges->items);
+  *ranges = result;
+}
+
+static int encodeUtf8(uint32_t c, uint8_t* out) {
+  if (c < 0x80) {
+    out[0] = (uint8_t)c;
+    return 1;
+  }
+  if (c < 0x800) {
+    out[0] = (uint8_t)(0xc0 | (c >> 6));
+    out[1] = (uint8_t)(0x80 | (c & 0x3f));
+    return 2;
+  }
+  if (c < 0x10000) {
+    out[0] = (uint8_t)(0xe0 | (c >> 12));
+    out[1] = (uint8_t)(0x80 | ((c >> 6) & 0x3f));
+    out[2] = (uint8_t)(0x80 | (c & 0x3f));
+    return 3;
+  }
+  out[0] = (uint8_t)(0xf0 | (c >> 18));
+  out[1] = (uint8_t)(0x80 | ((c >> 12) & 0x3f));
+  out[2] = (uint8_t)(0x80 | ((c >> 6) & 0x3f));
+  out[3] = (uint8_t)(0x80 | (c & 0x3f));
+  return 4;
+}
+
+// Adds to `alt` one byte-range sequence per piece of [lo, hi]: the range is
+// split until every piece has a single encoded length and each byte
+// position ranges independently of the others.
+static void utf8Sequences(ReParser* parser, Node* alt, uint32_t lo, uint32_t hi) {
+  static const uint32_t lengthLimits[] = {0x7f, 0x7ff, 0xffff};
+  for (int i = 0; i < 3; i++) {
+    uint32_t limit = lengthLimits[i];
+    if (lo <= limit && limit < hi) {
+      utf8Sequences(parser, alt, lo, limit);
+      utf8Sequences(parser, alt, limit + 1, hi);
+      return;
+    }
+  }
+  for (int i = 1; i < 4; i++) {
+    uint32_t mask = ((uint32_t)1 << (6 * i)) - 1;
+    if ((lo & ~mask) != (hi & ~mask)) {
+      if ((lo & mask) != 0) {
+        utf8Sequences(parser, alt, lo, lo | mask);
+        utf8Sequences(parser, alt, (lo | mask) + 1, hi);
+        return;
+      }
+      if ((hi & mask) != mask) {
+        utf8Sequences(parser, alt, lo, (hi & ~mask) - 1);
+        utf8Sequences(parser, alt, hi & ~mask, hi);
+        return;
+      }
+    }
+  }
+  uint8_t first[4], last[4];
+  int length = encodeUtf8(lo, first);
+  encodeUtf8(hi, last);
+  Node* sequence = newNode(parser, NODE_CONCAT);
+  for (int i = 0; i < length; i++) addChild(sequence, bytesNode(parser, first[i], last[i]));
+  addChild(alt, sequence);
+}
+
+// Builds the node matching any one codepoint in `ranges`, consuming them.
+static Node* classNode(ReParser* parser, Ranges* ranges, bool negate) {
+  if (parser->caseless) foldRanges(ranges);
+  if (negate) negateRanges(ranges);
+  normalizeRanges(ranges);
+
+  Node* alt = newNode(parser, NODE_ALT);
+  Node* ascii = newNode(parser, NODE_BYTES);
+  ascii->value = newSet(parser->re);
+  addChild(alt, ascii);
+  for (int i = 0; i < ranges->count; i++) {
+    uint32_t lo = ranges->items[i].lo;
+    uint32_t hi = ranges->items[i].hi;
+    if (lo < 0x80) setAddRange(&parser->re->sets[ascii->value], (int)lo, hi < 0x80 ? (int)hi : 0x7f);
+    if (hi >= 0x80) utf8Sequences(parser, alt, lo < 0x80 ? 0x80 : lo, hi);
+  }
+  free(ranges->items);
+  return alt->count == 1 ? ascii : alt;
+}
+
+static Node* literalNode(ReParser* parser, uint32_t c) {
+  bool letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+  if (parser->caseless && letter) {
+    Node* node = bytesNode(parser, (int)(c | 0x20), (int)(c | 0x20));
+    setAddRange(&parser->re->sets[node->value], (int)(c & ~0x20u), (int)(c & ~0x20u));
+    return node;
+  }
+  uint8_t bytes[4];
+  int length = encodeUtf8(c, bytes);
+  if (length == 1) return bytesNode(parser, bytes[0], bytes[0]);
+  Node* sequence = newNode(parser, NODE_CONCAT);
+  for (int i = 0; i < length; i++) addChild(sequence, bytesNode(parser, bytes[i], bytes[i]));
+  return sequence;
+}
+
+static bool atEnd(ReParser* parser) {
+  return parser->at >= parser->end;
+}
+
+// Reads the next codepoint of the pattern. Returns false, having read a
+// single byte, where the pattern isn't valid UTF-8.
+static bool nextCodepoint(ReParser* parser, uint32_t* c) {
+  static const uint32_t minimum[] = {0, 0, 0x80, 0x800, 0x10000};
+  const uint8_t* at = (const uint8_t*)parser->at;
+  size_t left = (size_t)(parser->end - parser->at);
+  uint8_t lead = at[0];
+  int length = lead < 0x80 ? 1 : lead >= 0xf0 ? 4 : lead >= 0xe0 ? 3 : lead >= 0xc0 ? 2 : 0;
+  *c = lead;
+  parser->at++;
+  if (length == 1) return true;
+  if (length == 0 || (size_t)length > left) return false;
+  uint32_t value = lead & (0xff >> (length + 1));
+  for (int i = 1; i < length; i++) {
+    if ((at[i] & 0xc0) != 0x80) return false;
+    value = (value << 6) | (at[i] & 0x3f);
+  }
+  if (value < minimum[length] || value > 0x10ffff) return false;
+  parser->at += length - 1;
+  *c = value;
+  return true;
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static bool parseHex(ReParser* parser, int digits, uint32_t* value) {
+  *value = 0;
+  for (int i = 0; i < digits; i++) {
+    if (atEnd(parser) || hexValue(*parser->at) < 0) return fail(parser, "bad hex escape");
+    *value = *value * 16 + (uint32_t)hexValue(*parser->at++);
+  }
+  return true;
+}
+
+// The ranges of \d, \w and \s; their capitals add the complement.
+static void addPerlClass(Ranges* ranges, char letter) {
+  Ranges base = {NULL, 0, 0};
+  switch (letter | 0x20) {
+    case 'd':
+      addRange(&base, '0', '9');
+      break;
+    case 'w':
+      addRange(&base, '0', '9');
+      addRange(&base, 'A', 'Z');
+      addRange(&base, '_', '_');
+      addRange(&base, 'a', 'z');
+      break;
+    default:
+      addRange(&base, '\t', '\r');
+      addRange(&base, ' ', ' ');
+      break;
+  }
+  if (letter >= 'A' && letter <= 'Z') negateRanges(&base);
+  for (int i = 0; i < base.count; i++) addRange(ranges, base.items[i].lo, base.items[i].hi);
+  free(base.items);
+}
+
+static bool isPerlClass(char c) {
+  return c == 'd' || c == 'D' || c == 'w' || c == 'W' || c == 's' || c == 'S';
+}
+
+// Escapes standing for one codepoint, shared by classes and the top level.
+// Expects the backslash to be consumed already.
+static bool parseEscapedChar(ReParser* parser, uint32_t* c) {
+  if (atEnd(parser)) return fail(parser, "trailing backslash");
+  char escape = *parser->at++;
+  switch (escape) {
+    case 'n': *c = '\n'; return true;
+    case 't': *c = '\t'; return true;
+    case 'r': *c = '\r'; return true;
+    case 'f': *c = '\f'; return true;
+    case 'v': *c = '\v'; return true;
+    case '0': *c = 0; return true;
+    case 'x':
+      if (!atEnd(parser) && *parser->at == '{') {
+        parser->at++;
+        *c = 0;
+        int digits = 0;
+        while (!atEnd(parser) && hexValue(*parser->at) >= 0 && digits < 6) {
+          *c = *c * 16 + (uint32_t)hexValue(*parser->at++);
+          digits++;
+        }
+        if (digits == 0 || atEnd(parser) || *parser->at != '}' || *c > 0x10ffff) {
+          return fail(parser, "bad hex escape");
+        }
+        parser->at++;
+        return true;
+      }
+      return parseHex(parser, 2, c);
+    case 'u':
+      return parseHex(parser, 4, c);
+    default:
+      if ((uint8_t)escape < 0x80 && !((escape >= 'a' && escape <= 'z') ||
+                                      (escape >= 'A' && escape <= 'Z') ||
+                                      (escape >= '0' && escape <= '9'))) {
+        *c = (uint8_t)escape;
+        return true;
+      }
+      parser->at--;
+      return fail(parser, "unknown escape");
+  }
+}
+
+static Node* parseClass(ReParser* parser) {
+  Ranges ranges = {NULL, 0, 0};
+  bool negate = false;
+  if (!atEnd(parser) && *parser->at == '^') {
+    negate = true;
+    parser->at++;
+  }
+  bool first = true;
+  for (;;) {
+    if (atEnd(parser)) {
+      free(ranges.items);
+      fail(parser, "missing ']'");
+      return NULL;
+    }
+    if (*parser->at == ']' && !first) {
+      parser->at++;
+      break;
+    }
+    first = false;
+
+    uint32_t lo;
+    if (*parser->at == '\\') {
+      parser->at++;
+      if (!atEnd(parser) && isPerlClass(*parser->at)) {
+        addPerlClass(&ranges, *parser->at++);
+        continue;
+      }
+      if (!parseEscapedChar(parser, &lo)) {
+        free(ranges.items);
+        return NULL;
+      }
+    } else {
+      nextCodepoint(parser, &lo);
+    }
+
+    uint32_t hi = lo;
+    if (parser->end - parser->at >= 2 && parser->at[0] == '-' && parser->at[1] != ']') {
+      parser->at++;
+      if (*parser->at == '\\') {
+        parser->at++;
+        if (!parseEscapedChar(parser, &hi)) {
+          free(ranges.items);
+          return NULL;
+        }
+      } else {
+        nextCodepoint(parser, &hi);
+      }
+      if (hi < lo) {
+        free(ranges.items);
+        fail(parser, "bad class range");
+        return NULL;
+      }
+    }
+    addRange(&ranges, lo, hi);
+  }
+  return classNode(parser, &ranges, negate);
+}
+
+static Node* parseAlternation(ReParser* parser, int depth);
+
+// Group names are identifiers, kept for ${name} and the `named` map.
+static bool parseGroupName(ReParser* parser, int group) {
+  const char* name = parser->at;
+  while (!atEnd(parser) && (*parser->at == '_' || (*parser->at >= 'a' && *parser->at <= 'z') ||
+                            (*parser->at >= 'A' && *parser->at <= 'Z') ||
+                            (parser->at > name && *parser->at >= '0' && *parser->at <= '9'))) {
+    parser->at++;
+  }
+  size_t length = (size_t)(parser->at - name);
+  if (length == 0 || atEnd(parser) || *parser->at != '>') return fail(parser, "bad group name");
+  parser->at++;
+
+  Regex* re = parser->re;
+  for (int i = 1; i < group; i++) {
+    if (re->names[i] != NULL && strlen(re->names[i]) == length &&
+        memcmp(re->names[i], name, length) == 0) {
+      return fail(parser, "duplicate group name");
+    }
+  }
+  re->names[group] = grow(NULL, length + 1);
+  memcpy(re->names[group], name, length);
+  re->names[group][length] = '\0';
+  return true;
+}
+
+static int newGroup(ReParser* parser) {
+  Regex* re = parser->re;
+  int group = ++re->groups;
+  if (group >= parser->nameCapacity) {
+    int capacity = parser->nameCapacity < 8 ? 8 : parser->nameCapacity * 2;
+    re->names = grow(re->names, sizeof(char*) * (size_t)capacity);
+    memset(re->names + parser->nameCapacity, 0,
+           sizeof(char*) * (size_t)(capacity - parser->nameCapacity));
+    parser->nameCapacity = capacity;
+  }
+  return group;
+}
+
+// Parses what follows "(": a group, or inline flags like "(?i)" which stay
+// in effect until the enclosing group closes.
+static Node* parseGroup(ReParser* parser, int depth) {
+  if (depth > REGEX_MAX_DEPTH) {
+    fail(parser, "groups nest too deeply");
+    return NULL;
+  }
+  bool caseless = parser->caseless;
+  bool dotAll = parser->dotAll;
+  int group = 0;
+
+  if (!atEnd(parser) && *parser->at == '?') {
+    parser->at++;
+    if (!atEnd(parser) && (*parser->at == '<' || *parser->at == 'P')) {
+      if (*parser->at == 'P') parser->at++;
+      if (atEnd(parser) || *parser->at != '<') {
+        fail(parser, "bad group name");
+        return NULL;
+      }
+      parser->at++;
+      group = newGroup(parser);
+      if (!parseGroupName(parser, group)) return NULL;
+    } else {
+      bool on = true;
+      for (;;) {
+        if (atEnd(parser)) {
+          fail(parser, "missing ')'");
+          return NULL;
+        }
+        char c = *parser->at++;
+        if (c == 'i') {
+          parser->caseless = on;
+        } else if (c == 's') {
+          parser->dotAll = on;
+        } else if (c == '-' && on) {
+          on = false;
+        } else if (c == ')') {
+          // Flags for the rest of the enclosing group
+          return newNode(parser, NODE_EMPTY);
+        } else if (c == ':') {
+          break;
+        } else {
+          parser->at--;
+          fail(parser, "unknown group flag");
+          return NULL;
+        }
+      }
+    }
+  } else {
+    group = newGroup(parser);
+  }
+
+  Node* inner = parseAlternation(parser, depth + 1);
+  if (inner == NULL) return NULL;
+  if (atEnd(parser) || *parser->at != ')') {
+    fail(parser, "missing ')'");
+    return NULL;
+  }
+  parser->at++;
+  parser->caseless = caseless;
+  parser->dotAll = dotAll;
+
+  Node* node = newNode(parser, NODE_GROUP);
+  node->value = group;
+  addChild(node, inner);
+  return node;
+}
+
+static Node* assertNode(ReParser* parser, AssertKind kind) {
+  Node* node = newNode(parser, NODE_ASSERT);
+  node->value = kind;
+  if (kind == ASSERT_WORD_BOUNDARY || kind == ASSERT_NOT_WORD_BOUNDARY) {
+    parser->re->dfaUsable = false;
+  }
+  return node;
+}
+
+static Node* parseAtom(ReParser* parser, int depth) {
+  char c = *parser->at;
+  switch (c) {
+    case '(':
+      parser->at++;
+      return parseGroup(parser, depth);
+    case '[':
+      parser->at++;
+      return parseClass(parser);
+    case '.': {
+      parser->at++;
+      Ranges ranges = {NULL, 0, 0};
+      if (parser->dotAll) {
+        addRange(&ranges, 0, 0x10ffff);
+      } else {
+        addRange(&ranges, 0, '\n' - 1);
+        addRange(&ranges, '\n' + 1, 0x10ffff);
+      }
+      bool caseless = parser->caseless;
+      parser->caseless = false;
+      Node* node = classNode(parser, &ranges, false);
+      parser->caseless = caseless;
+      return node;
+    }
+    case '^':
+      parser->at++;
+      return assertNode(parser, ASSERT_BEGIN_TEXT);
+    case '$':
+      parser->at++;
+      return assertNode(parser, ASSERT_END_TEXT);
+    case '*':
+    case '+':
+    case '?':
+      fail(parser, "nothing to repeat");
+      return NULL;
+    case '\\': {
+      parser->at++;
+      if (!atEnd(parser)) {
+        char escape = *parser->at;
+        if (isPerlClass(escape)) {
+          parser->at++;
+          Ranges ranges = {NULL, 0, 0};
+          addPerlClass(&ranges, escape);
+          return classNode(parser, &ranges, false);
+        }
+        if (escape == 'b' || escape == 'B') {
+          parser->at++;
+          return assertNode(parser, escape == 'b' ? ASSERT_WORD_BOUNDARY
+                                                  : ASSERT_NOT_WORD_BOUNDARY);
+        }
+      }
+      uint32_t codepoint;
+      if (!parseEscapedChar(parser, &codepoint)) return NULL;
+      return literalNode(parser, codepoint);
+    }
+    default: {
+      uint32_t codepoint;
+      if (!nextCodepoint(parser, &codepoint)) return bytesNode(parser, (int)codepoint, (int)codepoint);
+      return literalNode(parser, codepoint);
+    }
+  }
+}
+
+static bool parseCount(ReParser* parser, int* value) {
+  if (atEnd(parser) || *parser->at < '0' || *parser->at > '9') return false;
+  int count = 0;
+  while (!atEnd(parser) && *parser->at >= '0' && *parser->at <= '9') {
+    if (count <= REGEX_MAX_REPEAT) count = count * 10 + (*parser->at - '0');
+    parser->at++;
+  }
+  *value = count;
+  return true;
+}
+
+// Reads {n}, {n,} or {n,m}. Anything else leaves the brace to be matched
+// literally.
+static bool parseBraces(ReParser* parser, int* min, int* max) {
+  const char* open = parser->at;
+  parser->at++;
+  if (!parseCount(parser, min)) {
+    parser->at = open;
+    return false;
+  }
+  *max = *min;
+  if (!atEnd(parser) && *parser->at == ',') {
+    parser->at++;
+    *max = -1;
+    if (!atEnd(parser) && *parser->at != '}' && !parseCount(parser, max)) {
+      parser->at = open;
+      return false;
+    }
+  }
+  if (atEnd(parser) || *parser->at != '}') {
+    parser->at = open;
+    return false;
+  }
+  parser->at++;
+  return true;
+}
+
+static Node* parseRepeat(ReParser* parser, int depth) {
+  Node* atom = parseAtom(parser, depth);
+  if (atom == NULL) return NULL;
+
+  bool repeated = false;
+  while (!atEnd(parser)) {
+    int min, max;
+    const char* operator = parser->at;
+    char c = *parser->at;
+    if (c == '*') {
+      min = 0, max = -1;
+      parser->at++;
+    } else if (c == '+') {
+      min = 1, max = -1;
+      parser->at++;
+    } else if (c == '?') {
+      min = 0, max = 1;
+      parser->at++;
+    } else if (c == '{' && parseBraces(parser, &min, &max)) {
+      if (min > REGEX_MAX_REPEAT || max > REGEX_MAX_REPEAT) {
+        parser->at = operator;
+        fail(parser, "repeat count too large");
+        return NULL;
+      }
+      if (max != -1 && max < min) {
+        parser->at = operator;
+        fail(parser, "bad repeat range");
+        return NULL;
+      }
+    } else {
+      break;
+    }
+    if (repeated) {
+      parser->at = operator;
+      fail(parser, "nothing to repeat");
+      return NULL;
+    }
+    repeated = true;
+
+    Node* node = newNode(parser, NODE_REPEAT);
+    node->min = min;
+    node->max = max;
+    node->greedy = true;
+    if (!atEnd(parser) && *parser->at == '?') {
+      node->greedy = false;
+      parser->at++;
+    }
+    addChild(node, atom);
+    atom = node;
+  }
+  return atom;
+}
+
+static Node* parseConcat(ReParser* parser, int depth) {
+  Node* concat = newNode(parser, NODE_CONCAT);
+  while (!atEnd(parser) && *parser->at != '|' && *parser->at != ')') {
+    Node* node = parseRepeat(parser, depth);
+    if (node == NULL) return NULL;
+    addChild(concat, node);
+  }
+  return concat;
+}
+
+static Node* parseAlternation(ReParser* parser, int depth) {
+  Node* first = parseConcat(parser, depth);
+  if (first == NULL || atEnd(parser) || *parser->at != '|') return first;
+  Node* alt = newNode(parser, NODE_ALT);
+  addChild(alt, first);
+  while (!atEnd(parser) && *parser->at == '|') {
+    parser->at++;
+    Node* next = parseConcat(parser, depth);
+    if (next == NULL) return NULL;
+    addChild(alt, next);
+  }
+  return alt;
+}
+
+// ============================================================================
+// Compiling
+// ============================================================================
+
+static int emit(Program* program, InstOp op, int x, int y) {
+  if (program->count == program->capacity) {
+    program->capacity = program->capacity < 64 ? 64 : program->capacity * 2;
+    program->code = grow(program->code, sizeof(Inst) * (size_t)program->capacity);
+  }
+  program->code[program->count] = (Inst){(uint8_t)op, x, y};
+  return program->count++;
+}
+
+// Emits `node`; with `reverse` the program matches the reversed strings,
+// which is what the backward DFA runs. Returns false once the program
+// outgrows REGEX_MAX_PROGRAM.
+static bool compileNode(Program* program, const Node* node, bool reverse) {
+  if (program->count > REGEX_MAX_PROGRAM) return false;
+  switch (node->kind) {
+    case NODE_EMPTY:
+      return true;
+    case NODE_BYTES:
+      emit(program, INST_BYTES, node->value, 0);
+      return true;
+    case NODE_CONCAT:
+      for (int i = 0; i < node->count; i++) {
+        const Node* child = node->children[reverse ? node->count - 1 - i : i];
+        if (!compileNode(program, child, reverse)) return false;
+      }
+      return true;
+    case NODE_ALT: {
+      int jumps[node->count];
+      for (int i = 0; i < node->count; i++) {
+        int split = -1;
+        if (i < node->count - 1) split = emit(program, INST_SPLIT, program->count + 1, 0);
+        if (!compileNode(program, node->children[i], reverse)) return false;
+        if (split >= 0) {
+          jumps[i] = emit(program, INST_JMP, 0, 0);
+          program->code[split].y = program->count;
+        }
+      }
+      for (int i = 0; i < node->count - 1; i++) program->code[jumps[i]].x = program->count;
+      return true;
+    }
+    case NODE_GROUP:
+      if (node->value > 0 && !reverse) emit(program, INST_SAVE, node->value * 2, 0);
+      if (!compileNode(program, node->children[0], reverse)) return false;
+      if (node->value > 0 && !reverse) emit(program, INST_SAVE, node->value * 2 + 1, 0);
+      return true;
+    case NODE_ASSERT: {
+      int kind = node->value;
+      if (reverse && kind == ASSERT_BEGIN_TEXT) kind = ASSERT_END_TEXT;
+      else if (reverse && kind == ASSERT_END_TEXT) kind = ASSERT_BEGIN_TEXT;
+      emit(program, INST_ASSERT, kind, 0);
+      return true;
+    }
+    case NODE_REPEAT: {
+      const Node* child = node->children[0];
+      if (node->max == -1 && node->min > 0) {
+        // x{n,} is x{n-1} then x+, and x+ loops back to its own body: an
+        // empty last iteration can still leave the loop, as in Perl.
+        for (int i = 0; i < node->min - 1; i++) {
+          if (!compileNode(program, child, reverse)) return false;
+        }
+        int body = program->count;
+        if (!compileNode(program, child, reverse)) return false;
+        int loop = emit(program, INST_SPLIT, 0, 0);
+        program->code[loop].x = node->greedy ? body : loop + 1;
+        program->code[loop].y = node->greedy ? loop + 1 : body;
+        return true;
+      }
+      for (int i = 0; i < node->min; i++) {
+        if (!compileNode(program, child, reverse)) return false;
+      }
+      if (node->max == -1) {
+        // loop: SPLIT body, out; body; JMP loop
+        int loop = emit(program, INST_SPLIT, 0, 0);
+        if (!compileNode(program, child, reverse)) return false;
+        emit(program, INST_JMP, loop, 0);
+        int body = loop + 1, out = program->count;
+        program->code[loop].x = node->greedy ? body : out;
+        program->code[loop].y = node->greedy ? out : body;
+        return true;
+      }
+      int optional = node->max - node->min;
+      int splits[optional > 0 ? optional : 1];
+      for (int i = 0; i < optional; i++) {
+        splits[i] = emit(program, INST_SPLIT, 0, 0);
+        if (!compileNode(program, child, reverse)) return false;
+      }
+      for (int i = 0; i < optional; i++) {
+        int body = splits[i] + 1, out = program->count;
+        program->code[splits[i]].x = node->greedy ? body : out;
+        program->code[splits[i]].y = node->greedy ? out : body;
+      }
+      return true;
+    }
+  }
+  return true;
+}
+
+static bool compileProgram(Regex* re, const Node* root, bool reverse) {
+  Program* program = reverse ? &re->reverse : &re->forward;
+  if (!reverse) {
+    // An unanchored search is the pattern preceded by a lazy loop over any
+    // byte: at every position the pattern is tried at lowest priority.
+    int any = newSet(re);
+    setAddRange(&re->sets[any], 0, 255);
+    emit(program, INST_SPLIT, 3, 1);
+    emit(program, INST_BYTES, any, 0);
+    emit(program, INST_JMP, 0, 0);
+    program->start = emit(program, INST_SAVE, 0, 0);
+  } else {
+    program->start = 0;
+  }
+  if (!compileNode(program, root, reverse)) return false;
+  if (!reverse) emit(program, INST_SAVE, 1, 0);
+  emit(program, INST_MATCH, 0, 0);
+  return program->count <= REGEX_MAX_PROGRAM;
+}
+
+// Splits the 256 byte values into classes no set tells apart; the DFAs
+// keep one transition per class instead of one per byte.
+static void computeByteClasses(Regex* re) {
+  bool boundary[256] = {false};
+  for (int s = 0; s < re->setCount; s++) {
+    const ByteSet* set = &re->sets[s];
+    for (int b = 1; b < 256; b++) {
+      if (setHas(set, (uint8_t)b) != setHas(set, (uint8_t)(b - 1))) boundary[b] = true;
+    }
+  }
+  int cls = 0;
+  re->classRep[0] = 0;
+  for (int b = 0; b < 256; b++) {
+    if (b > 0 && boundary[b]) re->classRep[++cls] = (uint8_t)b;
+    re->classOf[b] = (uint8_t)cls;
+  }
+  re->classCount = cls + 1;
+}
+
+static void freeDfa(Dfa* dfa);
+
+static void freeRegex(Regex* re) {
+  if (re == NULL) return;
+  free(re->forward.code);
+  free(re->reverse.code);
+  free(re->sets);
+  if (re->names != NULL) {
+    for (int i = 1; i <= re->groups; i++) free(re->names[i]);
+    free(re->names);
+  }
+  freeDfa(re->forwardDfa);
+  freeDfa(re->reverseDfa);
+  free(re->pikeStack);
+  for (int i = 0; i < 2; i++) {
+    free(re->pikeLists[i].pcs);
+    free(re->pikeLists[i].slots);
+    free(re->pikeLists[i].mark);
+  }
+  free(re);
+}
+
+static Regex* compileRegex(const char* pattern, size_t length, const char** error) {
+  Regex* re = calloc(1, sizeof(Regex));
+  if (re == NULL) exit(1);
+  re->dfaUsable = true;
+
+  ReParser parser = {
+    .start = pattern, .at = pattern, .end = pattern + length, .re = re,
+  };
+  Node* root = parseAlternation(&parser, 0);
+  if (root != NULL && !atEnd(&parser)) {
+    root = NULL;
+    fail(&parser, "unmatched ')'");
+  }
+  if (root != NULL && (!compileProgram(re, root, false) || !compileProgram(re, root, true))) {
+    root = NULL;
+    parser.at = parser.start;
+    fail(&parser, "pattern too large");
+  }
+  for (int i = 0; i < parser.nodeCount; i++) {
+    free(parser.nodes[i]->children);
+    free(parser.nodes[i]);
+  }
+  free(parser.nodes);
+
+  if (root == NULL) {
+    snprintf(regexError, sizeof(regexError), "Error: bad regex: %s at offset %d.",
+             parser.message, (int)(parser.at - parser.start));
+    *error = regexError;
+    freeRegex(re);
+    return NULL;
+  }
+  computeByteClasses(re);
+  return re;
+}
+
+int regexGroupCount(const Regex* re) {
+  return re->groups;
+}
+
+const char* regexGroupName(const Regex* re, int group) {
+  return re->names != NULL && group >= 1 && group <= re->groups ? re->names[group] : NULL;
+}
+
+// ============================================================================
+// Lazy DFA
+// ============================================================================
+
+static Dfa* newDfa(const Program* program, bool longest) {
+  Dfa* dfa = calloc(1, sizeof(Dfa));
+  if (dfa == NULL) exit(1);
+  size_t count = (size_t)program->count;
+  dfa->program = program;
+  dfa->longest = longest;
+  dfa->stack = grow(NULL, sizeof(int) * (2 * count + 2));
+  dfa->pcs = grow(NULL, sizeof(int) * count);
+  dfa->closure = grow(NULL, sizeof(int) * count);
+  dfa->mark = calloc(count, sizeof(uint32_t));
+  if (dfa->mark == NULL) exit(1);
+  return dfa;
+}
+
+static void clearDfaStates(Dfa* dfa) {
+  for (int i = 0; i < dfa->capacity; i++) free(dfa->table[i]);
+  if (dfa->table != NULL) memset(dfa->table, 0, sizeof(DState*) * (size_t)dfa->capacity);
+  dfa->stateCount = 0;
+  dfa->memory = 0;
+  dfa->startStates[0] = dfa->startStates[1] = NULL;
+}
+
+static void freeDfa(Dfa* dfa) {
+  if (dfa == NULL) return;
+  clearDfaStates(dfa);
+  free(dfa->table);
+  free(dfa->stack);
+  free(dfa->pcs);
+  free(dfa->closure);
+  free(dfa->mark);
+  free(dfa);
+}
+
+// Follows empty transitions from `pcs` in priority order, writing the
+// consuming instructions reached to `out` (when not NULL). Returns whether
+// MATCH was reached; unless the DFA wants the longest match, threads of
+// lower priority than that MATCH are dropped.
+static bool closure(Dfa* dfa, const int* pcs, int count, bool atStart, bool atEnd,
+                    int* out, int* outCount) {
+  const Inst* code = dfa->program->code;
+  if (++dfa->generation == 0) {
+    memset(dfa->mark, 0, sizeof(uint32_t) * (size_t)dfa->program->count);
+    dfa->generation = 1;
+  }
+  uint32_t generation = dfa->generation;
+  int found = 0;
+  bool matched = false;
+  for (int i = 0; i < count && !(matched && !dfa->longest); i++) {
+    int top = 0;
+    dfa->stack[top++] = pcs[i];
+    while (top > 0) {
+      int pc = dfa->stack[--top];
+      if (dfa->mark[pc] == generation) continue;
+      dfa->mark[pc] = generation;
+      const Inst* inst = &code[pc];
+      switch (inst->op) {
+        case INST_JMP:
+          dfa->stack[top++] = inst->x;
+          break;
+        case INST_SPLIT:
+          dfa->stack[top++] = inst->y;
+          dfa->stack[top++] = inst->x;
+          break;
+        case INST_SAVE:
+          dfa->stack[top++] = pc + 1;
+          break;
+        case INST_ASSERT:
+          if ((inst->x == ASSERT_BEGIN_TEXT && atStart) || (inst->x == ASSERT_END_TEXT && atEnd)) {
+            dfa->stack[top++] = pc + 1;
+          }
+          break;
+        case INST_BYTES:
+          if (out != NULL) out[found++] = pc;
+          break;
+        case INST_MATCH:
+          matched = true;
+          if (!dfa->longest) top = 0;
+          break;
+      }
+    }
+  }
+  if (outCount != NULL) *outCount = found;
+  return matched;
+}
+
+static uint64_t hashState(const int* pcs, int count, bool start) {
+  uint64_t hash = start ? 0x9e3779b97f4a7c15u : 14695981039346656037u;
+  for (int i = 0; i < count; i++) {
+    hash ^= (uint32_t)pcs[i];
+    hash *= 1099511628211u;
+  }
+  return hash;
+}
+
+static void insertState(Dfa* dfa, DState* state) {
+  int mask = dfa->capacity - 1;
+  int i = (int)(state->hash & (uint64_t)mask);
+  while (dfa->table[i] != NULL) i = (i + 1) & mask;
+  dfa->table[i] = state;
+}
+
+// The state for `pcs`, made if new. Sets *flushed when making it meant
+// emptying the cache first, in which case every older state is gone.
+static DState* internState(Dfa* dfa, Regex* re, const int* pcs, int count, bool start,
+                           bool* flushed) {
+  uint64_t hash = hashState(pcs, count, start);
+  *flushed = false;
+  if (dfa->capacity > 0) {
+    int mask = dfa->capacity - 1;
+    for (int i = (int)(hash & (uint64_t)mask); dfa->table[i] != NULL; i = (i + 1) & mask) {
+      DState* state = dfa->table[i];
+      if (state->hash == hash && state->count == count && state->start == start &&
+          memcmp(state->pcs, pcs, sizeof(int) * (size_t)count) == 0) {
+        return state;
+      }
+    }
+  }
+
+  int threadCount;
+  bool match = closure(dfa, pcs, count, start, false, dfa->closure, &threadCount);
+  bool matchAtEnd = match || closure(dfa, pcs, count, start, true, NULL, NULL);
+
+  size_t size = sizeof(DState) + sizeof(DState*) * (size_t)re->classCount +
+                sizeof(int) * (size_t)(count + threadCount);
+  if (dfa->memory + size > DFA_CACHE_BYTES && dfa->stateCount > 0) {
+    clearDfaStates(dfa);
+    *flushed = true;
+  }
+  if ((dfa->stateCount + 1) * 2 > dfa->capacity) {
+    int oldCapacity = dfa->capacity;
+    DState** old = dfa->table;
+    dfa->capacity = oldCapacity < 64 ? 64 : oldCapacity * 2;
+    dfa->table = calloc((size_t)dfa->capacity, sizeof(DState*));
+    if (dfa->table == NULL) exit(1);
+    for (int i = 0; i < oldCapacity; i++) {
+      if (old[i] != NULL) insertState(dfa, old[i]);
+    }
+    free(old);
+  }
+
+  DState* state = calloc(1, size);
+  if (state == NULL) exit(1);
+  state->next = (DState**)(state + 1);
+  state->pcs = (int*)(state->next + re->classCount);
+  state->threads = state->pcs + count;
+  memcpy(state->pcs, pcs, sizeof(int) * (size_t)count);
+  memcpy(state->threads, dfa->closure, sizeof(int) * (size_t)threadCount);
+  state->count = count;
+  state->threadCount = threadCount;
+  state->hash = hash;
+  state->start = start;
+  state->match = match;
+  state->matchAtEnd = matchAtEnd;
+  insertState(dfa, state);
+  dfa->stateCount++;
+  dfa->memory += size;
+  return state;
+}
+
+// Both programs begin at instruction 0: the forward one with its
+// unanchored prefix, the reverse one with the reversed pattern.
+static DState* startState(Dfa* dfa, Regex* re, bool atStart) {
+  DState* state = dfa->startStates[atStart];
+  if (state == NULL) {
+    bool flushed;
+    int pc = 0;
+    state = internState(dfa, re, &pc, 1, atStart, &flushed);
+    dfa->startStates[atStart] = state;
+  }
+  return state;
+}
+
+static DState* nextState(Dfa* dfa, Regex* re, DState* state, uint8_t byte) {
+  const Inst* code = dfa->program->code;
+  int count = 0;
+  for (int i = 0; i < state->threadCount; i++) {
+    int pc = state->threads[i];
+    if (setHas(&re->sets[code[pc].x], byte)) dfa->pcs[count++] = pc + 1;
+  }
+  bool flushed;
+  DState* next = internState(dfa, re, dfa->pcs, count, false, &flushed);
+  if (!flushed) state->next[re->classOf[byte]] = next;
+  return next;
+}
+
+// Scans forward from `from` for the end of the leftmost-first match. With
+// `stopEarly` any match end will do.
+static bool forwardScan(Regex* re, const uint8_t* text, size_t length, size_t from,
+                        bool stopEarly, size_t* end) {
+  if (re->forwardDfa == NULL) re->forwardDfa = newDfa(&re->forward, false);
+  Dfa* dfa = re->forwardDfa;
+  DState* state = startState(dfa, re, from == 0);
+  bool found = false;
+  for (size_t at = from;; at++) {
+    if (state->match || (at == length && state->matchAtEnd)) {
+      found = true;
+      *end = at;
+      if (stopEarly) return true;
+    }
+    if (at == length) break;
+    DState* next = state->next[re->classOf[text[at]]];
+    state = next != NULL ? next : nextState(dfa, re, state, text[at]);
+    if (state->count == 0) break;
+  }
+  return found;
+}
+
+// Scans back from `end` (not below `limit`) for the earliest start of a
+// match ending there.
+static size_t reverseScan(Regex* re, const uint8_t* text, size_t length, size_t limit,
+                          size_t end) {
+  if (re->reverseDfa == NULL) re->reverseDfa = newDfa(&re->reverse, true);
+  Dfa* dfa = re->reverseDfa;
+  DState* state = startState(dfa, re, end == length);
+  size_t start = end;
+  for (size_t at = end;; at--) {
+    if (state->match || (at == 0 && state->matchAtEnd)) start = at;
+    if (at == limit) break;
+    DState* next = state->next[re->classOf[text[at - 1]]];
+    state = next != NULL ? next : nextState(dfa, re, state, text[at - 1]);
+    if (state->count == 0) break;
+  }
+  return start;
+}
+
+// ============================================================================
+// Pike VM
+// ============================================================================
+
+typedef struct {
+  const Regex* re;
+  const uint8_t* text;
+  size_t length;
+  int slotCount;
+  Frame* stack;
+} Pike;
+
+static bool isWordByte(uint8_t c) {
+  return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+         c == '_';
+}
+
+static bool assertionHolds(const Pike* pike, int kind, size_t at) {
+  switch (kind) {
+    case ASSERT_BEGIN_TEXT: return at == 0;
+    case ASSERT_END_TEXT: return at == pike->length;
+    default: {
+      bool before = at > 0 && isWordByte(pike->text[at - 1]);
+      bool after = at < pike->length && isWordByte(pike->text[at]);
+      return (before != after) == (kind == ASSERT_WORD_BOUNDARY);
+    }
+  }
+}
+
+static void clearList(ThreadList* list, int capacity) {
+  list->count = 0;
+  if (++list->generation == 0) {
+    memset(list->mark, 0, sizeof(uint32_t) * (size_t)capacity);
+    list->generation = 1;
+  }
+}
+
+// Adds the threads reachable from `pc0` by empty transitions at `at`, in
+// priority order. `slots` is scratch that SAVE updates and restores.
+static void addThread(Pike* pike, ThreadList* list, int pc0, size_t* slots, size_t at) {
+  const Inst* code = pike->re->forward.code;
+  int top = 0;
+  pike->stack[top++] = (Frame){pc0, 0, 0};
+  while (top > 0) {
+    Frame frame = pike->stack[--top];
+    if (frame.pc < 0) {
+      slots[frame.slot] = frame.old;
+      continue;
+    }
+    int pc = frame.pc;
+    if (list->mark[pc] == list->generation) continue;
+    list->mark[pc] = list->generation;
+    const Inst* inst = &code[pc];
+    switch (inst->op) {
+      case INST_JMP:
+        pike->stack[top++] = (Frame){inst->x, 0, 0};
+        break;
+      case INST_SPLIT:
+        pike->stack[top++] = (Frame){inst->y, 0, 0};
+        pike->stack[top++] = (Frame){inst->x, 0, 0};
+        break;
+      case INST_SAVE:
+        pike->stack[top++] = (Frame){-1, inst->x, slots[inst->x]};
+        slots[inst->x] = at;
+        pike->stack[top++] = (Frame){pc + 1, 0, 0};
+        break;
+      case INST_ASSERT:
+        if (assertionHolds(pike, inst->x, at)) pike->stack[top++] = (Frame){pc + 1, 0, 0};
+        break;
+      default: {
+        int index = list->count++;
+        list->pcs[index] = pc;
+        memcpy(list->slots + (size_t)index * (size_t)pike->slotCount, slots,
+               sizeof(size_t) * (size_t)pike->slotCount);
+        break;
+      }
+    }
+  }
+}
+
+// Leftmost-first match with captures, starting at `from` (only there when
+// `anchored`). Stops after position `stopAt`, where the DFAs have already
+// found the match to end.
+static bool pikeSearch(Regex* re, const uint8_t* text, size_t length, size_t from,
+                       bool anchored, size_t stopAt, size_t* slots) {
+  size_t count = (size_t)re->forward.count;
+  int slotCount = (re->groups + 1) * 2;
+  if (re->pikeStack == NULL) {
+    re->pikeStack = grow(NULL, sizeof(Frame) * (3 * count + 1));
+    for (int i = 0; i < 2; i++) {
+      re->pikeLists[i].pcs = grow(NULL, sizeof(int) * count);
+      re->pikeLists[i].slots = grow(NULL, sizeof(size_t) * count * (size_t)slotCount);
+      re->pikeLists[i].mark = calloc(count, sizeof(uint32_t));
+      if (re->pikeLists[i].mark == NULL) exit(1);
+    }
+  }
+  Pike pike = {re, text, length, slotCount, re->pikeStack};
+  size_t scratch[slotCount];
+  for (int i = 0; i < slotCount; i++) scratch[i] = REGEX_UNSET;
+
+  ThreadList* current = &re->pikeLists[0];
+  ThreadList* next = &re->pikeLists[1];
+  clearList(current, (int)count);
+  addThread(&pike, current, anchored ? re->forward.start : 0, scratch, from);
+
+  bool matched = false;
+  for (size_t at = from;; at++) {
+    clearList(next, (int)count);
+    for (int i = 0; i < current->count; i++) {
+      const Inst* inst = &re->forward.code[current->pcs[i]];
+      size_t* threadSlots = current->slots + (size_t)i * (size_t)slotCount;
+      if (inst->op == INST_MATCH) {
+        matched = true;
+        memcpy(slots, threadSlots, sizeof(size_t) * (size_t)slotCount);
+        break;  // lower-priority threads lose to this match
+      }
+      if (at < length && setHas(&re->sets[inst->x], text[at])) {
+        memcpy(scratch, threadSlots, sizeof(size_t) * (size_t)slotCount);
+        addThread(&pike, next, current->pcs[i] + 1, scratch, at + 1);
+      }
+    }
+    if (at == length || at == stopAt || next->count == 0) break;
+    ThreadList* swap = current;
+    current = next;
+    next = swap;
+  }
+
+  return matched;
+}
+
+// ============================================================================
+// Searching
+// ============================================================================
+
+bool regexFind(Regex* re, const char* text, size_t length, size_t from, size_t* slots) {
+  const uint8_t* bytes = (const uint8_t*)text;
+  if (from > length) return false;
+  if (!re->dfaUsable) return pikeSearch(re, bytes, length, from, false, SIZE_MAX, slots);
+
+  size_t end;
+  if (!forwardScan(re, bytes, length, from, false, &end)) return false;
+  size_t start = reverseScan(re, bytes, length, from, end);
+  if (re->groups == 0) {
+    slots[0] = start;
+    slots[1] = end;
+    return true;
+  }
+  return pikeSearch(re, bytes, length, start, true, end, slots);
+}
+
+bool regexTest(Regex* re, const char* text, size_t length) {
+  if (re->dfaUsable) {
+    size_t end;
+    return forwardScan(re, (const uint8_t*)text, length, 0, true, &end);
+  }
+  int slotCount = (re->groups + 1) * 2;
+  size_t slots[slotCount];
+  return pikeSearch(re, (const uint8_t*)text, length, 0, false, SIZE_MAX, slots);
+}
+
+void regexAppend(RegexBuffer* out, const char* bytes, size_t length) {
+  if (out->length + length > out->capacity) {
+    size_t capacity = out->capacity < 64 ? 64 : out->capacity;
+    while (capacity < out->length + length) capacity *= 2;
+    out->data = grow(out->data, capacity);
+    out->capacity = capacity;
+  }
+  memcpy(out->data + out->length, bytes, length);
+  out->length += length;
+}
+
+static int groupByName(const Regex* re, const char* name, size_t length) {
+  bool numeric = length > 0;
+  int number = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (name[i] < '0' || name[i] > '9' || number > re->groups) {
+      numeric = false;
+      break;
+    }
+    number = number * 10 + (name[i] - '0');
+  }
+  if (numeric) return number <= re->groups ? number : -1;
+  for (int i = 1; i <= re->groups; i++) {
+    const char* candidate = regexGroupName(re, i);
+    if (candidate != NULL && strlen(candidate) == length && memcmp(candidate, name, length) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void regexExpand(const Regex* re, const char* replacement, size_t replacementLength,
+                 const char* text, const size_t* slots, RegexBuffer* out) {
+  size_t i = 0;
+  while (i < replacementLength) {
+    const char* dollar = memchr(replacement + i, '$', replacementLength - i);
+    size_t stop = dollar != NULL ? (size_t)(dollar - replacement) : replacementLength;
+    regexAppend(out, replacement + i, stop - i);
+    i = stop;
+    if (i == replacementLength) break;
+
+    // Unknown references are kept as written
+    int group = -1;
+    size_t after = i + 1;
+    if (after < replacementLength && replacement[after] == '$') {
+      regexAppend(out, "$", 1);
+      i = after + 1;
+      continue;
+    }
+    if (after < replacementLength && replacement[after] >= '0' && replacement[after] <= '9') {
+      group = groupByName(re, replacement + after, 1);
+      after++;
+    } else if (after < replacementLength && replacement[after] == '{') {
+      const char* close = memchr(replacement + after, '}', replacementLength - after);
+      if (close != NULL) {
+        size_t nameStart = after + 1;
+        size_t nameEnd = (size_t)(close - replacement);
+        group = groupByName(re, replacement + nameStart, nameEnd - nameStart);
+        after = nameEnd + 1;
+      }
+    }
+    if (group < 0) {
+      regexAppend(out, "$", 1);
+      i++;
+      continue;
+    }
+    if (slots[group * 2] != REGEX_UNSET) {
+      regexAppend(out, text + slots[group * 2],
+             slots[group * 2 + 1] - slots[group * 2]);
+    }
+    i = after;
+  }
+}
+
+// ============================================================================
+// Pattern cache
+// ============================================================================
+
+typedef struct {
+  char* pattern;
+  size_t length;
+  uint64_t hash;
+  Regex* re;
+} CacheEntry;
+
+static _Thread_local CacheEntry regexCache[REGEX_CACHE_SIZE];
+static _Thread_local int regexCacheNext;
+
+Regex* regexGet(const char* pattern, size_t length, const char** error) {
+  uint64_t hash = 14695981039346656037u;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)pattern[i];
+    hash *= 1099511628211u;
+  }
+  for (int i = 0; i < REGEX_CACHE_SIZE; i++) {
+    CacheEntry* entry = &regexCache[i];
+    if (entry->re != NULL && entry->hash == hash && entry->length == length &&
+        memcmp(entry->pattern, pattern, length) == 0) {
+      return entry->re;
+    }
+  }
+
+  Regex* re = compileRegex(pattern, length, error);
+  if (re == NULL) return NULL;
+
+  // Evict round-robin: cheap, and a working set that fits never churns
+  CacheEntry* entry = &regexCache[regexCacheNext];
+  regexCacheNext = (regexCacheNext + 1) % REGEX_CACHE_SIZE;
+  freeRegex(entry->re);
+  free(entry->pattern);
+  entry->pattern = grow(NULL, length > 0 ? length : 1);
+  memcpy(entry->pattern, pattern, length);
+  entry->length = length;
+  entry->hash = hash;
+  entry->re = re;
+  return re;
+}
+
+void freeRegexCache(void) {
+  for (int i = 0; i < REGEX_CACHE_SIZE; i++) {
+    freeRegex(regexCache[i].re);
+    free(regexCache[i].pattern);
+    regexCache[i] = (CacheEntry){NULL, 0, 0, NULL};
+  }
+  regexCacheNext = 0;
+}
@@ -0,0 +1,330 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory.h"
+#include "object.h"
+#include "scan.h"
+#include "vm.h"
+
+typedef struct {
+  const char* source;
+  size_t length;
+  size_t start;
+  size_t current;
+  int line;
+  int col;
+  char* scratch;          // decoded string literal bodies
+  size_t scratchCapacity;
+  Value* columns;         // the result arrays, rooted on the VM stack
+} Scanner;
+
+enum { TYPES, LEXEMES, LINES, COLS, LITERALS, COLUMN_COUNT };
+
+static const char* columnNames[COLUMN_COUNT] = {
+  "types", "lexemes", "lines", "cols", "literals",
+};
+
+typedef struct {
+  const char* name;
+  TokenType type;
+} Keyword;
+
+static const Keyword keywords[] = {
+  {"and", TOKEN_AND},       {"or", TOKEN_OR},
+  {"if", TOKEN_IF},         {"else", TOKEN_ELSE},
+  {"fn", TOKEN_FN},         {"for", TOKEN_FOR},
+  {"nil", TOKEN_NIL},       {"return", TOKEN_RETURN},
+  {"true", TOKEN_TRUE},     {"false", TOKEN_FALSE},
+  {"let", TOKEN_LET},       {"enum", TOKEN_ENUM},
+  {"break", TOKEN_BREAK},   {"continue", TOKEN_CONTINUE},
+  {"import", TOKEN_IMPORT}, {"in", TOKEN_IN},
+  {"collect", TOKEN_COLLECT},
+};
+
+static bool isAtEnd(Scanner* scanner) {
+  return scanner->current >= scanner->length;
+}
+
+static char peekByte(Scanner* scanner) {
+  return isAtEnd(scanner) ? '\0' : scanner->source[scanner->current];
+}
+
+static char peekNextByte(Scanner* scanner) {
+  size_t next = scanner->current + 1;
+  return next < scanner->length ? scanner->source[next] : '\0';
+}
+
+static bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+static bool isAlpha(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+// Bytes in the UTF-8 character at `current`, judged by its lead byte.
+static size_t charLength(Scanner* scanner) {
+  uint8_t lead = (uint8_t)scanner->source[scanner->current];
+  size_t length = lead < 128 ? 1 : lead < 224 ? 2 : lead < 240 ? 3 : 4;
+  size_t left = scanner->length - scanner->current;
+  return length < left ? length : left;
+}
+
+// Columns count bytes, like the lx scanner did.
+static void advanceBy(Scanner* scanner, size_t count) {
+  scanner->current += count;
+  scanner->col += (int)count;
+}
+
+static bool match(Scanner* scanner, char expected) {
+  if (peekByte(scanner) != expected || isAtEnd(scanner)) return false;
+  advanceBy(scanner, 1);
+  return true;
+}
+
+static void appendScratch(Scanner* scanner, size_t* length, const char* bytes, size_t count) {
+  if (*length + count > scanner->scratchCapacity) {
+    size_t capacity = scanner->scratchCapacity < 256 ? 256 : scanner->scratchCapacity;
+    while (capacity < *length + count) capacity *= 2;
+    scanner->scratch = GROW_ARRAY(char, scanner->scratch, scanner->scratchCapacity, capacity);
+    scanner->scratchCapacity = capacity;
+  }
+  memcpy(scanner->scratch + *length, bytes, count);
+  *length += count;
+}
+
+// Appends one token to every column. The lexeme and literal are pushed
+// first so growing the arrays can't collect them.
+static void addToken(Scanner* scanner, TokenType type, Value lexeme, Value literal) {
+  push(lexeme);
+  push(literal);
+  Value* columns = scanner->columns;
+  writeValueArray(&AS_ARRAY(columns[TYPES]), FIXNUM_VAL(type));
+  writeValueArray(&AS_ARRAY(columns[LEXEMES]), vm.stackTop[-2]);
+  writeValueArray(&AS_ARRAY(columns[LINES]), FIXNUM_VAL(scanner->line));
+  writeValueArray(&AS_ARRAY(columns[COLS]), FIXNUM_VAL(scanner->col));
+  writeValueArray(&AS_ARRAY(columns[LITERALS]), vm.stackTop[-1]);
+  pop();
+  pop();
+}
+
+static Value lexeme(Scanner* scanner) {
+  return OBJ_VAL(copyString(scanner->source + scanner->start,
+                            scanner->current - scanner->start));
+}
+
+static void simpleToken(Scanner* scanner, TokenType type) {
+  addToken(scanner, type, lexeme(scanner), NIL_VAL);
+}
+
+static void errorToken(Scanner* scanner, const char* message, size_t length) {
+  addToken(scanner, TOKEN_ERROR, OBJ_VAL(copyString(message, length)), NIL_VAL);
+}
+
+static void skipWhitespace(Scanner* scanner) {
+  while (!isAtEnd(scanner)) {
+    char c = peekByte(scanner);
+    if (c == ' ' || c == '\r' || c == '\t') {
+      advanceBy(scanner, 1);
+    } else if (c == '\n') {
+      scanner->current++;
+      scanner->line++;
+      scanner->col = 0;
+    } else if (c == '/' && peekNextByte(scanner) == '/') {
+      const char* newline = memchr(scanner->source + scanner->current, '\n',
+                                   scanner->length - scanner->current);
+      size_t end = newline != NULL ? (size_t)(newline - scanner->source) : scanner->length;
+      advanceBy(scanner, end - scanner->current);
+    } else {
+      return;
+    }
+  }
+}
+
+static void identifier(Scanner* scanner) {
+  while (isAlpha(peekByte(scanner)) || isDigit(peekByte(scanner))) advanceBy(scanner, 1);
+  const char* text = scanner->source + scanner->start;
+  size_t length = scanner->current - scanner->start;
+  TokenType type = TOKEN_IDENTIFIER;
+  for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++) {
+    if (strlen(keywords[i].name) == length && memcmp(keywords[i].name, text, length) == 0) {
+      type = keywords[i].type;
+      break;
+    }
+  }
+  simpleToken(scanner, type);
+}
+
+static void number(Scanner* scanner) {
+  while (isDigit(peekByte(scanner))) advanceBy(scanner, 1);
+  if (peekByte(scanner) == '.' && isDigit(peekNextByte(scanner))) {
+    advanceBy(scanner, 1);
+    while (isDigit(peekByte(scanner))) advanceBy(scanner, 1);
+  }
+
+  // strtod on a copy: the source may continue with something like "e5"
+  size_t length = 0;
+  appendScratch(scanner, &length, scanner->source + scanner->start,
+                scanner->current - scanner->start);
+  appendScratch(scanner, &length, "", 1);
+  double value = strtod(scanner->scratch, NULL);
+
+  // Same representation tonumber() picks
+  Value literal = NUMBER_VAL(value);
+  if (value == (double)(int64_t)value && fixnumFitsInt64((int64_t)value)) {
+    literal = FIXNUM_VAL((int64_t)value);
+  }
+  addToken(scanner, TOKEN_NUMBER, lexeme(scanner), literal);
+}
+
+static void string(Scanner* scanner) {
+  size_t length = 0;
+  while (!isAtEnd(scanner) && peekByte(scanner) != '"') {
+    char c = peekByte(scanner);
+    if (c == '\n') {
+      // The newline itself still counts towards the column
+      scanner->line++;
+      scanner->col = 0;
+    }
+    if (c == '\\') {
+      advanceBy(scanner, 1);
+      if (isAtEnd(scanner)) break;
+      c = peekByte(scanner);
+      const char* replacement = NULL;
+      switch (c) {
+        case 'n': replacement = "\n"; break;
+        case 'r': replacement = "\r"; break;
+        case 't': replacement = "\t"; break;
+        case 'e': replacement = "\x1b"; break;
+        case '"': replacement = "\""; break;
+        case '\\': replacement = "\\"; break;
+      }
+      size_t count = charLength(scanner);
+      if (replacement != NULL) {
+        appendScratch(scanner, &length, replacement, 1);
+      } else {
+        appendScratch(scanner, &length, scanner->source + scanner->current, count);
+      }
+      advanceBy(scanner, count);
+      continue;
+    }
+    // Copy up to the next character that needs a look
+    size_t from = scanner->current;
+    size_t to = from + 1;
+    while (to < scanner->length) {
+      char next = scanner->source[to];
+      if (next == '"' || next == '\\' || next == '\n') break;
+      to++;
+    }
+    appendScratch(scanner, &length, scanner->source + from, to - from);
+    advanceBy(scanner, to - from);
+  }
+
+  if (isAtEnd(scanner)) {
+    errorToken(scanner, "Unterminated string.", strlen("Unterminated string."));
+    return;
+  }
+
+  advanceBy(scanner, 1); // closing quote
+  push(OBJ_VAL(copyString(scanner->scratch != NULL ? scanner->scratch : "", length)));
+  addToken(scanner, TOKEN_STRING, lexeme(scanner), vm.stackTop[-1]);
+  pop();
+}
+
+static void scanToken(Scanner* scanner) {
+  char c = peekByte(scanner);
+  if (isAlpha(c)) {
+    identifier(scanner);
+    return;
+  }
+  if (isDigit(c)) {
+    number(scanner);
+    return;
+  }
+
+  size_t count = charLength(scanner);
+  advanceBy(scanner, count);
+  switch (c) {
+    case '(': simpleToken(scanner, TOKEN_LEFT_PAREN); return;
+    case ')': simpleToken(scanner, TOKEN_RIGHT_PAREN); return;
+    case '{': simpleToken(scanner, TOKEN_LEFT_BRACE); return;
+    case '}': simpleToken(scanner, TOKEN_RIGHT_BRACE); return;
+    case '[': simpleToken(scanner, TOKEN_LEFT_BRACKET); return;
+    case ']': simpleToken(scanner, TOKEN_RIGHT_BRACKET); return;
+    case ';': simpleToken(scanner, TOKEN_SEMICOLON); return;
+    case ':': simpleToken(scanner, TOKEN_COLON); return;
+    case ',': simpleToken(scanner, TOKEN_COMMA); return;
+    case '%': simpleToken(scanner, TOKEN_MOD); return;
+    case '+': simpleToken(scanner, TOKEN_PLUS); return;
+    case '/': simpleToken(scanner, TOKEN_SLASH); return;
+    case '*': simpleToken(scanner, TOKEN_STAR); return;
+    case '&': simpleToken(scanner, TOKEN_AMPERSAND); return;
+    case '|': simpleToken(scanner, TOKEN_PIPE); return;
+    case '^': simpleToken(scanner, TOKEN_CARET); return;
+    case '.':
+      simpleToken(scanner, match(scanner, '{') ? TOKEN_DOT_BRACE : TOKEN_DOT);
+      return;
+    case '-':
+      simpleToken(scanner, match(scanner, '>') ? TOKEN_MINUS_GREATER : TOKEN_MINUS);
+      return;
+    case '!':
+      simpleToken(scanner, match(scanner, '=') ? TOKEN_BANG_EQUAL : TOKEN_BANG);
+      return;
+    case '=':
+      simpleToken(scanner, match(scanner, '=') ? TOKEN_EQUAL_EQUAL
+                           : match(scanner, '>') ? TOKEN_ARROW : TOKEN_EQUAL);
+      return;
+    case '<':
+      simpleToken(scanner, match(scanner, '=') ? TOKEN_LESS_EQUAL
+                           : match(scanner, '<') ? TOKEN_LESS_LESS : TOKEN_LESS);
+      return;
+    case '>':
+      simpleToken(scanner, match(scanner, '=') ? TOKEN_GREATER_EQUAL
+                           : match(scanner, '>') ? TOKEN_GREATER_GREATER : TOKEN_GREATER);
+      return;
+    case '"':
+      string(scanner);
+      return;
+  }
+
+  char message[32] = "Unexpected character: ";
+  size_t prefix = strlen(message);
+  memcpy(message + prefix, scanner->source + scanner->start, count);
+  errorToken(scanner, message, prefix + count);
+}
+
+Value scanSource(const char* source, size_t length) {
+  Scanner scanner = {
+    .source = source, .length = length,
+    .start = 0, .current = 0, .line = 1, .col = 0,
+    .scratch = NULL, .scratchCapacity = 0,
+  };
+
+  push(OBJ_VAL(newHashmap()));
+  scanner.columns = vm.stackTop;
+  for (int i = 0; i < COLUMN_COUNT; i++) push(OBJ_VAL(newArray()));
+
+  // A leading "#!" line is skipped like whitespace
+  if (length >= 2 && source[0] == '#' && source[1] == '!') {
+    const char* newline = memchr(source, '\n', length);
+    advanceBy(&scanner, newline != NULL ? (size_t)(newline - source) : length);
+  }
+
+  for (;;) {
+    skipWhitespace(&scanner);
+    scanner.start = scanner.current;
+    if (isAtEnd(&scanner)) break;
+    scanToken(&scanner);
+  }
+  simpleToken(&scanner, TOKEN_EOF);
+  FREE_ARRAY(char, scanner.scratch, scanner.scratchCapacity);
+
+  Table* result = &AS_HASHMAP(scanner.columns[-1]);
+  for (int i = 0; i < COLUMN_COUNT; i++) {
+    push(OBJ_VAL(copyString(columnNames[i], strlen(columnNames[i]))));
+    tableSet(result, vm.stackTop[-1], scanner.columns[i]);
+    pop();
+  }
+  vm.stackTop = scanner.columns;
+  return pop();
+}
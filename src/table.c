@@ -26,6 +26,7 @@ void initTable(Table* table) {
   table->bucketMask = 0;
   table->entries = NULL;
   table->control = NULL;
+  table->layout = 0;
 }
 
 void freeTable(Table* table) {
@@ -146,6 +147,7 @@ static void ensureArrayCapacity(Table* table, uint32_t minCapacity) {
   table->arrayValues = newValues;
   table->arrayPresent = newPresent;
   table->arrayCapacity = newCapacity;
+  table->layout++;
 }
 
 static inline uint8_t h2hash(uint32_t hash) { return (uint8_t)(hash & H2_MASK); }
@@ -256,6 +258,7 @@ static void adjustCapacity(Table* table, int capacity) {
   table->bucketMask = newTable.bucketMask;
   table->count = newTable.count;
   table->tombstones = newTable.tombstones;
+  table->layout++;
 
   // Free old hash storage
   FREE_ARRAY(Entry, oldEntries, oldCapacity);
@@ -369,18 +372,15 @@ bool tableSet(Table* table, Value key, Value value) {
   if (numberKeyToArrayIndex(key, &arrayIndex)) {
     if (arrayIndex < (uint32_t)table->arrayCapacity ||
         shouldGrowArrayForIndex(table, arrayIndex)) {
-      bool existedInHash = false;
       if (table->hasIntKeysInHash && table->bucketCount != 0) {
+        // An int key already in the hash part is updated where it is:
+        // moving it into the array part would move it under a for-in walk
         uint32_t hash = hashValue(key);
         Entry* existing = findExisting(table, key, hash);
         if (existing != NULL) {
-          int index = (int)(existing - table->entries);
-          table->control[index] = CTRL_TOMB;
-          existing->key = NIL_VAL;
-          existing->value = NIL_VAL;
-          table->count--;
-          table->tombstones++;
-          existedInHash = true;
+          existing->value = value;
+          result = false;
+          goto cleanup;
         }
       }
 
@@ -395,23 +395,35 @@ bool tableSet(Table* table, Value key, Value value) {
         table->count++;
       }
       table->arrayValues[arrayIndex] = value;
-      result = !wasPresent && !existedInHash;
+      result = !wasPresent;
       goto cleanup;
     }
     table->hasIntKeysInHash = true;
   }
 
+  // Updating an existing key never resizes, so it never moves other keys
+  uint32_t hash = hashValue(key);
+  ProbeResult probe = {NULL, NULL, false};
+  if (table->bucketCount != 0) {
+    probe = findSlot(table, key, hash);
+    if (probe.found) {
+      probe.entry->value = value;
+      result = false;
+      goto cleanup;
+    }
+  }
+
   if (tableShouldGrow(table)) {
+    // A table that is mostly tombstones (vm.strings after a GC sweep) is
+    // rehashed at its current size; doubling it every cycle would grow the
+    // heap without bound under steady string churn.
+    int hashCount = table->count - table->arrayCount;
     int newCapacity = table->capacity == 0 ? GROUP_WIDTH : GROW_CAPACITY(table->capacity);
+    if ((double)(hashCount + 1) * 2 <= (double)table->capacity * TABLE_MAX_LOAD) {
+      newCapacity = table->capacity;
+    }
     adjustCapacity(table, newCapacity);
-  }
-
-  uint32_t hash = hashValue(key);
-  ProbeResult probe = findSlot(table, key, hash);
-  if (probe.found) {
-    probe.entry->value = value;
-    result = false;
-    goto cleanup;
+    probe = findSlot(table, key, hash);
   }
 
   if (*probe.ctrl == CTRL_TOMB) {
@@ -0,0 +1,471 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "text.h"
+
+// SSE2 is part of x86-64, so the choice made at run time is between AVX2
+// and SSE2. Other targets take the scalar loops only.
+#if defined(__x86_64__) && defined(__GNUC__)
+#define TEXT_SIMD 1
+#include <immintrin.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+static bool hasAvx2(void) {
+  return __builtin_cpu_supports("avx2");
+}
+#endif
+
+// ============================================================================
+// Substring search
+// ============================================================================
+
+// Vector loops only report candidates where both the first and the last
+// needle byte line up; memcmp confirms the bytes in between. Each loop
+// returns a match or sets *stop to where the scalar tail takes over.
+// Requires needleLength >= 2.
+
+#ifdef TEXT_SIMD
+TARGET_AVX2
+static const char* findAvx2(const char* haystack, size_t length, const char* needle,
+                            size_t needleLength, size_t* stop) {
+  const __m256i first = _mm256_set1_epi8(needle[0]);
+  const __m256i last = _mm256_set1_epi8(needle[needleLength - 1]);
+  size_t i = 0;
+  for (; i + needleLength - 1 + 32 <= length; i += 32) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(haystack + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(haystack + i + needleLength - 1));
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+    while (mask != 0) {
+      size_t at = i + (size_t)__builtin_ctz(mask);
+      if (memcmp(haystack + at + 1, needle + 1, needleLength - 2) == 0) return haystack + at;
+      mask &= mask - 1;
+    }
+  }
+  *stop = i;
+  return NULL;
+}
+
+static const char* findSse2(const char* haystack, size_t length, const char* needle,
+                            size_t needleLength, size_t* stop) {
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i last = _mm_set1_epi8(needle[needleLength - 1]);
+  size_t i = 0;
+  for (; i + needleLength - 1 + 16 <= length; i += 16) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(haystack + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(haystack + i + needleLength - 1));
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+    while (mask != 0) {
+      size_t at = i + (size_t)__builtin_ctz(mask);
+      if (memcmp(haystack + at + 1, needle + 1, needleLength - 2) == 0) return haystack + at;
+      mask &= mask - 1;
+    }
+  }
+  *stop = i;
+  return NULL;
+}
+#endif
+
+const char* textFind(const char* haystack, size_t length,
+                     const char* needle, size_t needleLength) {
+  if (needleLength == 0) return haystack;
+  if (needleLength > length) return NULL;
+  if (needleLength == 1) return memchr(haystack, needle[0], length);
+
+  size_t i = 0;
+#ifdef TEXT_SIMD
+  const char* found = hasAvx2() ? findAvx2(haystack, length, needle, needleLength, &i)
+                                : findSse2(haystack, length, needle, needleLength, &i);
+  if (found != NULL) return found;
+#endif
+  while (i + needleLength <= length) {
+    const char* hit = memchr(haystack + i, needle[0], length - needleLength + 1 - i);
+    if (hit == NULL) return NULL;
+    if (memcmp(hit, needle, needleLength) == 0) return hit;
+    i = (size_t)(hit - haystack) + 1;
+  }
+  return NULL;
+}
+
+// ============================================================================
+// ASCII case mapping
+// ============================================================================
+
+// Flips bit 0x20 of the bytes in [first, first + 25]. Adding 0x80 - first
+// moves that range to the bottom of the signed bytes, so a single signed
+// compare finds it.
+
+#ifdef TEXT_SIMD
+TARGET_AVX2
+static size_t caseMapAvx2(char* dst, const char* src, size_t length, char first) {
+  const __m256i shift = _mm256_set1_epi8((char)(0x80 - first));
+  const __m256i limit = _mm256_set1_epi8((char)(-128 + 26));
+  const __m256i flip = _mm256_set1_epi8(0x20);
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32) {
+    __m256i c = _mm256_loadu_si256((const __m256i*)(src + i));
+    __m256i letter = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(c, shift));
+    _mm256_storeu_si256((__m256i*)(dst + i),
+                        _mm256_xor_si256(c, _mm256_and_si256(letter, flip)));
+  }
+  return i;
+}
+
+static size_t caseMapSse2(char* dst, const char* src, size_t length, char first) {
+  const __m128i shift = _mm_set1_epi8((char)(0x80 - first));
+  const __m128i limit = _mm_set1_epi8((char)(-128 + 26));
+  const __m128i flip = _mm_set1_epi8(0x20);
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i c = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i letter = _mm_cmplt_epi8(_mm_add_epi8(c, shift), limit);
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(c, _mm_and_si128(letter, flip)));
+  }
+  return i;
+}
+#endif
+
+static void caseMap(char* dst, const char* src, size_t length, char first) {
+  size_t i = 0;
+#ifdef TEXT_SIMD
+  i = hasAvx2() ? caseMapAvx2(dst, src, length, first) : caseMapSse2(dst, src, length, first);
+#endif
+  for (; i < length; i++) {
+    char c = src[i];
+    dst[i] = c >= first && c <= first + 25 ? (char)(c ^ 0x20) : c;
+  }
+}
+
+void textLower(char* dst, const char* src, size_t length) {
+  caseMap(dst, src, length, 'A');
+}
+
+void textUpper(char* dst, const char* src, size_t length) {
+  caseMap(dst, src, length, 'a');
+}
+
+// ============================================================================
+// UTF-8
+// ============================================================================
+
+#ifdef TEXT_SIMD
+TARGET_AVX2
+static size_t asciiPrefixAvx2(const char* bytes, size_t length) {
+  size_t i = 0;
+  while (i + 32 <= length &&
+         _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)(bytes + i))) == 0) {
+    i += 32;
+  }
+  return i;
+}
+
+static size_t asciiPrefixSse2(const char* bytes, size_t length) {
+  size_t i = 0;
+  while (i + 16 <= length &&
+         _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(bytes + i))) == 0) {
+    i += 16;
+  }
+  return i;
+}
+
+// Continuation bytes (0x80-0xbf) are exactly the signed bytes below -64.
+TARGET_AVX2
+static size_t continuationsAvx2(const char* bytes, size_t length, size_t* stop) {
+  const __m256i limit = _mm256_set1_epi8((char)0xc0);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32) {
+    __m256i c = _mm256_loadu_si256((const __m256i*)(bytes + i));
+    count += (size_t)__builtin_popcount((uint32_t)_mm256_movemask_epi8(
+        _mm256_cmpgt_epi8(limit, c)));
+  }
+  *stop = i;
+  return count;
+}
+
+static size_t continuationsSse2(const char* bytes, size_t length, size_t* stop) {
+  const __m128i limit = _mm_set1_epi8((char)0xc0);
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i c = _mm_loadu_si128((const __m128i*)(bytes + i));
+    count += (size_t)__builtin_popcount((uint32_t)_mm_movemask_epi8(_mm_cmplt_epi8(c, limit)));
+  }
+  *stop = i;
+  return count;
+}
+#endif
+
+// Length of the well-formed sequence starting at `at`, 0 if there isn't one.
+static size_t sequenceLength(const uint8_t* at, size_t left) {
+  uint8_t lead = at[0];
+  if (lead < 0x80) return 1;
+  if (lead >= 0xc2 && lead <= 0xdf) {
+    return left >= 2 && (at[1] & 0xc0) == 0x80 ? 2 : 0;
+  }
+  if (lead >= 0xe0 && lead <= 0xef) {
+    if (left < 3 || (at[1] & 0xc0) != 0x80 || (at[2] & 0xc0) != 0x80) return 0;
+    if (lead == 0xe0 && at[1] < 0xa0) return 0;  // overlong
+    if (lead == 0xed && at[1] > 0x9f) return 0;  // surrogate
+    return 3;
+  }
+  if (lead >= 0xf0 && lead <= 0xf4) {
+    if (left < 4 || (at[1] & 0xc0) != 0x80 || (at[2] & 0xc0) != 0x80 ||
+        (at[3] & 0xc0) != 0x80) {
+      return 0;
+    }
+    if (lead == 0xf0 && at[1] < 0x90) return 0;  // overlong
+    if (lead == 0xf4 && at[1] > 0x8f) return 0;  // past U+10FFFF
+    return 4;
+  }
+  return 0;
+}
+
+bool textUtf8Valid(const char* bytes, size_t length) {
+  const uint8_t* data = (const uint8_t*)bytes;
+  size_t i = 0;
+  while (i < length) {
+    // Skip whole blocks of ASCII, then check sequences one by one until
+    // the next block boundary or so
+#ifdef TEXT_SIMD
+    i += hasAvx2() ? asciiPrefixAvx2(bytes + i, length - i)
+                   : asciiPrefixSse2(bytes + i, length - i);
+#endif
+    size_t stop = length - i > 32 ? i + 32 : length;
+    while (i < stop) {
+      size_t n = sequenceLength(data + i, length - i);
+      if (n == 0) return false;
+      i += n;
+    }
+  }
+  return true;
+}
+
+size_t textUtf8Count(const char* bytes, size_t length) {
+  size_t continuations = 0;
+  size_t i = 0;
+#ifdef TEXT_SIMD
+  continuations = hasAvx2() ? continuationsAvx2(bytes, length, &i)
+                            : continuationsSse2(bytes, length, &i);
+#endif
+  for (; i < length; i++) {
+    if (((uint8_t)bytes[i] & 0xc0) == 0x80) continuations++;
+  }
+  return length - continuations;
+}
+
+// ============================================================================
+// Codepoint index
+// ============================================================================
+
+uint32_t textDecode(const char* bytes, size_t length, size_t at, size_t* width) {
+  const uint8_t* data = (const uint8_t*)bytes + at;
+  size_t n = sequenceLength(data, length - at);
+  *width = n == 0 ? 1 : n;
+  switch (n) {
+    case 1:
+      return data[0];
+    case 2:
+      return ((uint32_t)(data[0] & 0x1f) << 6) | (data[1] & 0x3f);
+    case 3:
+      return ((uint32_t)(data[0] & 0x0f) << 12) | ((uint32_t)(data[1] & 0x3f) << 6) |
+             (data[2] & 0x3f);
+    case 4:
+      return ((uint32_t)(data[0] & 0x07) << 18) | ((uint32_t)(data[1] & 0x3f) << 12) |
+             ((uint32_t)(data[2] & 0x3f) << 6) | (data[3] & 0x3f);
+  }
+  return 0xfffd;
+}
+
+typedef struct {
+  size_t offset;
+  size_t units;
+} Checkpoint;
+
+struct TextIndex {
+  const char* bytes;
+  size_t length;
+  size_t codepoints;
+  size_t units;
+  // Checkpoint k sits at codepoint k * TEXT_INDEX_STRIDE; NULL when every
+  // byte is ASCII and offsets, codepoints and units all coincide
+  Checkpoint* checkpoints;
+  size_t count;
+  // Where the last textIndexOffset landed, so reading codepoints in order
+  // decodes each one once instead of walking from its checkpoint
+  size_t cursor;
+  size_t cursorOffset;
+};
+
+// Like reallocate(), running out of memory here is fatal.
+static void* indexGrow(void* pointer, size_t size) {
+  void* result = realloc(pointer, size);
+  if (result == NULL) exit(1);
+  return result;
+}
+
+static size_t asciiRun(const char* bytes, size_t length) {
+  size_t i = 0;
+#ifdef TEXT_SIMD
+  i = hasAvx2() ? asciiPrefixAvx2(bytes, length) : asciiPrefixSse2(bytes, length);
+#endif
+  while (i < length && (uint8_t)bytes[i] < 0x80) i++;
+  return i;
+}
+
+// Bytes of the codepoint at `at`; its UTF-16 units go to *units.
+static size_t indexStep(const TextIndex* index, size_t at, size_t* units) {
+  size_t n = sequenceLength((const uint8_t*)index->bytes + at, index->length - at);
+  *units = n == 4 ? 2 : 1;
+  return n == 0 ? 1 : n;
+}
+
+TextIndex* textIndexNew(const char* bytes, size_t length) {
+  TextIndex* index = indexGrow(NULL, sizeof(TextIndex));
+  index->bytes = bytes;
+  index->length = length;
+  index->checkpoints = NULL;
+  index->count = 0;
+  index->cursor = 0;
+  index->cursorOffset = 0;
+
+  if (asciiRun(bytes, length) == length) {
+    index->codepoints = length;
+    index->units = length;
+    return index;
+  }
+
+  // There are never more codepoints than bytes; trimmed below
+  Checkpoint* checkpoints =
+      indexGrow(NULL, (length / TEXT_INDEX_STRIDE + 1) * sizeof(Checkpoint));
+  size_t codepoint = 0;
+  size_t units = 0;
+  size_t i = 0;
+  while (i < length) {
+    size_t run = asciiRun(bytes + i, length - i);
+    if (run > 0) {
+      // Within a run of ASCII, offsets and units advance with codepoints
+      size_t next = (codepoint + TEXT_INDEX_STRIDE - 1) / TEXT_INDEX_STRIDE * TEXT_INDEX_STRIDE;
+      for (; next < codepoint + run; next += TEXT_INDEX_STRIDE) {
+        checkpoints[next / TEXT_INDEX_STRIDE] =
+            (Checkpoint){i + next - codepoint, units + next - codepoint};
+      }
+      i += run;
+      codepoint += run;
+      units += run;
+      continue;
+    }
+    if (codepoint % TEXT_INDEX_STRIDE == 0) {
+      checkpoints[codepoint / TEXT_INDEX_STRIDE] = (Checkpoint){i, units};
+    }
+    size_t width;
+    i += indexStep(index, i, &width);
+    codepoint++;
+    units += width;
+  }
+
+  index->codepoints = codepoint;
+  index->units = units;
+  index->count = (codepoint - 1) / TEXT_INDEX_STRIDE + 1;
+  index->checkpoints = indexGrow(checkpoints, index->count * sizeof(Checkpoint));
+  return index;
+}
+
+void textIndexFree(TextIndex* index) {
+  if (index == NULL) return;
+  free(index->checkpoints);
+  free(index);
+}
+
+size_t textIndexCodepoints(const TextIndex* index) {
+  return index->codepoints;
+}
+
+size_t textIndexUtf16Length(const TextIndex* index) {
+  return index->units;
+}
+
+// Last checkpoint at or before byte offset (or UTF-16 column) `key`.
+// Checkpoint 0 is at the start, so there always is one.
+static size_t findCheckpoint(const TextIndex* index, size_t key, bool byUnits) {
+  size_t lo = 0;
+  size_t hi = index->count;
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    const Checkpoint* at = &index->checkpoints[mid];
+    if ((byUnits ? at->units : at->offset) <= key) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+size_t textIndexOffset(TextIndex* index, size_t codepoint) {
+  if (codepoint >= index->codepoints) return index->length;
+  if (index->checkpoints == NULL) return codepoint;
+
+  size_t from = codepoint / TEXT_INDEX_STRIDE * TEXT_INDEX_STRIDE;
+  size_t at = index->checkpoints[codepoint / TEXT_INDEX_STRIDE].offset;
+  if (index->cursor >= from && index->cursor <= codepoint) {
+    from = index->cursor;
+    at = index->cursorOffset;
+  }
+  size_t units;
+  for (; from < codepoint; from++) at += indexStep(index, at, &units);
+
+  index->cursor = codepoint;
+  index->cursorOffset = at;
+  return at;
+}
+
+size_t textIndexCodepointAt(const TextIndex* index, size_t offset) {
+  if (offset >= index->length) return index->codepoints;
+  if (index->checkpoints == NULL) return offset;
+
+  size_t k = findCheckpoint(index, offset, false);
+  size_t codepoint = k * TEXT_INDEX_STRIDE;
+  size_t at = index->checkpoints[k].offset;
+  size_t units;
+  for (;;) {
+    size_t n = indexStep(index, at, &units);
+    if (at + n > offset) return codepoint;
+    at += n;
+    codepoint++;
+  }
+}
+
+size_t textIndexUtf16At(const TextIndex* index, size_t offset) {
+  if (offset >= index->length) return index->units;
+  if (index->checkpoints == NULL) return offset;
+
+  size_t k = findCheckpoint(index, offset, false);
+  size_t at = index->checkpoints[k].offset;
+  size_t units = index->checkpoints[k].units;
+  for (;;) {
+    size_t width;
+    size_t n = indexStep(index, at, &width);
+    if (at + n > offset) return units;
+    at += n;
+    units += width;
+  }
+}
+
+size_t textIndexFromUtf16(const TextIndex* index, size_t units) {
+  if (units >= index->units) return index->length;
+  if (index->checkpoints == NULL) return units;
+
+  size_t k = findCheckpoint(index, units, true);
+  size_t at = index->checkpoints[k].offset;
+  size_t column = index->checkpoints[k].units;
+  for (;;) {
+    size_t width;
+    size_t n = indexStep(index, at, &width);
+    if (column + width > units) return at;
+    at += n;
+    column += width;
+  }
+}
@@ -61,7 +61,18 @@ void writeValue(Writer* writer, Value value) {
     double num = AS_NUMBER(value);
     int64_t val_i = num;
     if (num == (double)val_i) {
-      writerPrintf(writer, "%" PRId64, val_i);
+      // Integers are formatted by hand: printing them is hot and printf
+      // costs more than the write itself.
+      char digits[24];
+      char* end = digits + sizeof(digits);
+      char* p = end;
+      uint64_t magnitude = val_i < 0 ? 0 - (uint64_t)val_i : (uint64_t)val_i;
+      do {
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+      } while (magnitude != 0);
+      if (val_i < 0) *--p = '-';
+      writerWrite(writer, p, (size_t)(end - p));
     } else {
       writerPrintf(writer, "%f", num);
     }
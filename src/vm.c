@@ -5,6 +5,7 @@
 #include <string.h>
 #include <math.h>
 
+#include "loop.h"
 #include "objloader.h"
 #include "object.h"
 #include "memory.h"
@@ -16,7 +17,7 @@
 #include "debug.h"
 #endif
 
-VM vm;
+_Thread_local VM vm;
 
 // Forward declarations
 inline static void closeUpvalues(Value* last);
@@ -303,7 +304,8 @@ static void runtimeError(const char* format, ...) {
     longjmp(handler->buf, 1);
   }
 
-  // Default mode: print like before.
+  // Default mode: print like before, after whatever stdout still buffers
+  fflush(stdout);
   fputs(message, stderr);
   fputs("\n", stderr);
   free(message);
@@ -329,7 +331,8 @@ static void runtimeError(const char* format, ...) {
     } else {
       fprintf(stderr, "[");
     }
-    fprintf(stderr, "L%d] in ", function->chunk.lines[instruction]);
+    fprintf(stderr, "L%d] in ",
+            function->chunk.lines != NULL ? (int)function->chunk.lines[instruction] : 0);
     if (function->name == NULL) {
       fprintf(stderr, "script\n");
     } else {
@@ -600,6 +603,9 @@ void freeVM() {
   vm.stackSampleFile = NULL;
 #endif
 
+  freeEventLoop();
+  closeFiles();
+  freeRegexCache();
   freeTable(&vm.globals);
   freeTable(&vm.strings);
   freeObjects();
@@ -613,6 +619,12 @@ static bool call(ObjClosure* closure, int argCount) {
     return false;
   }
 
+  if (closure->function->lazyUnit != NULL &&
+      !materializeFunction(closure->function)) {
+    runtimeError("Failed to load function chunk.");
+    return false;
+  }
+
   // push nil for insufficient args passed
   for (int i = 0; i < arity - argCount; i++) {
     push(NIL_VAL);
@@ -759,13 +771,19 @@ static void pcallSetField(ObjHashmap* map, const char* key, Value value) {
   pop();
 }
 
+// value and error are often already off the stack (a popped return value,
+// vm.lastError), so they stay rooted while the result map allocates.
 static Value pcallResult(bool ok, Value value, Value error) {
+  push(value);
+  push(error);
   ObjHashmap* out = newHashmap();
   push(OBJ_VAL(out));
   pcallSetField(out, "ok", BOOL_VAL(ok));
   pcallSetField(out, "value", value);
   pcallSetField(out, "error", error);
   pop();
+  pop();
+  pop();
   return OBJ_VAL(out);
 }
 
@@ -773,6 +791,9 @@ static Value pcallResult(bool ok, Value value, Value error) {
 // Returns: {tag: "yield"|"return"|"error", value: ..., error: ...}
 // Note: 'value' will become 'values' array when multi-value yield/resume is added
 static Value fiberResult(const char* tag, Value value, Value error) {
+  // Rooted for the same reason as in pcallResult
+  push(value);
+  push(error);
   ObjHashmap* out = newHashmap();
   push(OBJ_VAL(out));
 
@@ -792,6 +813,8 @@ static Value fiberResult(const char* tag, Value value, Value error) {
     pcallSetField(out, "error", error);
   }
 
+  pop();
+  pop();
   pop();
   return OBJ_VAL(out);
 }
@@ -1104,6 +1127,84 @@ static bool fiberCurrentNative(int argCount, Value* args) {
   return true;
 }
 
+// Lx.loop.spawn(fn) - queues fn as a new event loop task, returns its fiber
+static bool loopSpawnNative(int argCount, Value* args) {
+  if (argCount != 1 || !IS_CLOSURE(args[0])) {
+    args[-1] = CSTRING_VAL("Error: Lx.loop.spawn takes a function.");
+    return false;
+  }
+  if (!fiberCreateNative(argCount, args)) return false;
+  loopSpawn(AS_FIBER(args[-1]));
+  return true;
+}
+
+// Message of a failed task's Fiber.resume result
+static Value loopTaskError(Value result) {
+  Value err = NIL_VAL;
+  if (IS_HASHMAP(result)) {
+    tableGet(&AS_HASHMAP(result), CSTRING_VAL("error"), &err);
+  }
+  if (IS_HASHMAP(err)) {
+    Value message = NIL_VAL;
+    tableGet(&AS_HASHMAP(err), CSTRING_VAL("message"), &message);
+    err = message;
+  }
+  return IS_STRING(err) ? err : CSTRING_VAL("Error: Lx.loop task failed.");
+}
+
+// Lx.loop.run() - resumes tasks until every one has returned. A task that
+// errors (or whose parked I/O fails) stops the loop, drops the remaining
+// tasks and raises here.
+static bool loopRunNative(int argCount, Value* args) {
+  if (loopIsRunning()) {
+    args[-1] = CSTRING_VAL("Error: Lx.loop.run is already running.");
+    return false;
+  }
+  loopSetRunning(true);
+
+  Value failure = NIL_VAL;
+  while (IS_NIL(failure) && loopHasTasks()) {
+    Value resumeValue;
+    LoopTask* task;
+    while (IS_NIL(failure) && (task = loopNextReady(&resumeValue)) != NULL) {
+      ObjFiber* fiber = loopTaskFiber(task);
+      // [result slot, fiber, resume value], laid out like a native call
+      push(NIL_VAL);
+      push(OBJ_VAL(fiber));
+      push(resumeValue);
+      bool resumed = fiberResumeNative(2, vm.stackTop - 2);
+      if (!resumed) {
+        failure = vm.stackTop[-3];
+        loopTaskFinished(task);
+      } else if (fiber->state == FIBER_SUSPENDED) {
+        loopTaskSuspended(task);
+      } else {
+        if (fiber->state == FIBER_ERROR) {
+          vm.stackTop[-2] = loopTaskError(vm.stackTop[-3]);
+          failure = vm.stackTop[-2];
+        }
+        loopTaskFinished(task);
+      }
+      vm.stackTop -= 3;
+    }
+
+    const char* error = NULL;
+    if (IS_NIL(failure) && loopHasTasks() && !loopPoll(&error)) {
+      failure = CSTRING_VAL(error);
+    }
+  }
+
+  if (!IS_NIL(failure)) {
+    args[-1] = failure;  // rooted by the caller's stack slot from here on
+    loopReset();
+    loopSetRunning(false);
+    return false;
+  }
+  loopSetRunning(false);
+  args[-1] = NIL_VAL;
+  return true;
+}
+
 static bool pcallNative(int argCount, Value* args) {
   if (argCount < 1) {
     args[-1] = CSTRING_VAL("Error: Lx.pcall takes at least 1 arg (fn).");
@@ -1197,6 +1298,484 @@ inline static bool isFalsey(Value value) {
   return IS_NIL(value) || (IS_BOOL(value) && !AS_BOOL(value));
 }
 
+// ============================================================================
+// Native sorting: sort / stableSort / sortBy
+// ============================================================================
+
+typedef enum {
+  SORT_NUMBERS,     // no comparator, every key is a number
+  SORT_STRINGS,     // no comparator (or stringLess), every key is a string
+  SORT_COMPARATOR,  // lx comparator called through runUntil
+} SortOrder;
+
+// Keys are what gets compared; values are what ends up in the result.
+// Plain sorts use the element as its own key, sortBy uses keyFn(element).
+typedef struct {
+  Value key;
+  Value value;
+} SortItem;
+
+typedef struct {
+  SortOrder order;
+  Value comparator;
+} SortContext;
+
+static inline int compareSortStrings(ObjString* a, ObjString* b) {
+  int length = a->length < b->length ? a->length : b->length;
+  int cmp = memcmp(a->chars, b->chars, (size_t)length);
+  if (cmp != 0) return cmp;
+  return a->length - b->length;
+}
+
+// Call an lx function synchronously from a native (sorting, Lx.fs.lines).
+// Runtime errors longjmp to the handler the native installed.
+static Value callFromNative(Value function, int argCount, Value a, Value b) {
+  int baseFrameCount = vm.frameCount;
+  push(function);
+  push(a);
+  if (argCount > 1) push(b);
+  if (callValue(peek(argCount), argCount) != CALL_OK) {
+    runtimeError("Cannot yield from non-yieldable context.");
+  }
+  // Natives complete inside callValue; closures need the run loop.
+  if (vm.frameCount > baseFrameCount) runUntil(baseFrameCount);
+  return pop();
+}
+
+static inline bool sortLess(SortContext* ctx, SortItem* a, SortItem* b) {
+  switch (ctx->order) {
+    case SORT_NUMBERS:
+      return AS_NUMBER(a->key) < AS_NUMBER(b->key);
+    case SORT_STRINGS:
+      return compareSortStrings(AS_STRING(a->key), AS_STRING(b->key)) < 0;
+    case SORT_COMPARATOR:
+      return !isFalsey(callFromNative(ctx->comparator, 2, a->key, b->key));
+  }
+  return false;
+}
+
+static void insertionSortItems(SortContext* ctx, SortItem* items, int lo, int hi) {
+  for (int i = lo + 1; i < hi; i++) {
+    SortItem item = items[i];
+    int j = i;
+    while (j > lo && sortLess(ctx, &item, &items[j - 1])) {
+      items[j] = items[j - 1];
+      j--;
+    }
+    items[j] = item;
+  }
+}
+
+// Stable: sorted runs of 16 by insertion, then bottom-up merges through
+// scratch. Ties always take the left run.
+static void mergeSortItems(SortContext* ctx, SortItem* items, SortItem* scratch, int count) {
+  const int run = 16;
+  for (int lo = 0; lo < count; lo += run) {
+    int hi = lo + run < count ? lo + run : count;
+    insertionSortItems(ctx, items, lo, hi);
+  }
+
+  SortItem* from = items;
+  SortItem* to = scratch;
+  for (int width = run; width < count; width *= 2) {
+    for (int lo = 0; lo < count; lo += 2 * width) {
+      int mid = lo + width < count ? lo + width : count;
+      int hi = lo + 2 * width < count ? lo + 2 * width : count;
+      int i = lo, j = mid, k = lo;
+      // Already ordered runs are copied without comparing every pair
+      if (mid < hi && !sortLess(ctx, &from[mid], &from[mid - 1])) {
+        memcpy(&to[lo], &from[lo], sizeof(SortItem) * (size_t)(hi - lo));
+        continue;
+      }
+      while (i < mid && j < hi) {
+        if (sortLess(ctx, &from[j], &from[i])) {
+          to[k++] = from[j++];
+        } else {
+          to[k++] = from[i++];
+        }
+      }
+      while (i < mid) to[k++] = from[i++];
+      while (j < hi) to[k++] = from[j++];
+    }
+    SortItem* swap = from;
+    from = to;
+    to = swap;
+  }
+  if (from != items) {
+    memcpy(items, from, sizeof(SortItem) * (size_t)count);
+  }
+}
+
+static inline void swapItems(SortItem* items, int a, int b) {
+  SortItem tmp = items[a];
+  items[a] = items[b];
+  items[b] = tmp;
+}
+
+static void siftDownItems(SortContext* ctx, SortItem* items, int lo, int root, int count) {
+  for (;;) {
+    int child = 2 * root + 1;
+    if (child >= count) return;
+    if (child + 1 < count && sortLess(ctx, &items[lo + child], &items[lo + child + 1])) {
+      child++;
+    }
+    if (!sortLess(ctx, &items[lo + root], &items[lo + child])) return;
+    swapItems(items, lo + root, lo + child);
+    root = child;
+  }
+}
+
+static void heapSortItems(SortContext* ctx, SortItem* items, int lo, int hi) {
+  int count = hi - lo;
+  for (int i = count / 2 - 1; i >= 0; i--) siftDownItems(ctx, items, lo, i, count);
+  for (int end = count - 1; end > 0; end--) {
+    swapItems(items, lo, lo + end);
+    siftDownItems(ctx, items, lo, 0, end);
+  }
+}
+
+// Unstable introsort: median-of-three quicksort, insertion sort for short
+// ranges, heapsort once the depth budget runs out. Partitioning is
+// bounds-checked so inconsistent comparators cannot run off the range.
+static void introSortItems(SortContext* ctx, SortItem* items, int lo, int hi, int depth) {
+  while (hi - lo > 16) {
+    if (depth-- == 0) {
+      heapSortItems(ctx, items, lo, hi);
+      return;
+    }
+    int mid = lo + (hi - lo) / 2;
+    if (sortLess(ctx, &items[mid], &items[lo])) swapItems(items, mid, lo);
+    if (sortLess(ctx, &items[hi - 1], &items[mid])) {
+      swapItems(items, hi - 1, mid);
+      if (sortLess(ctx, &items[mid], &items[lo])) swapItems(items, mid, lo);
+    }
+    SortItem pivot = items[mid];
+    int i = lo;
+    int j = hi - 1;
+    for (;;) {
+      while (i < hi - 1 && sortLess(ctx, &items[i], &pivot)) i++;
+      while (j > lo && sortLess(ctx, &pivot, &items[j])) j--;
+      if (i >= j) break;
+      swapItems(items, i, j);
+      i++;
+      j--;
+    }
+    // Recurse into the smaller side to bound C stack depth
+    if (j + 1 - lo < hi - (j + 1)) {
+      introSortItems(ctx, items, lo, j + 1, depth);
+      lo = j + 1;
+    } else {
+      introSortItems(ctx, items, j + 1, hi, depth);
+      hi = j + 1;
+    }
+  }
+  insertionSortItems(ctx, items, lo, hi);
+}
+
+// Pick a comparator-free order when every key is a number or every key is
+// a string; otherwise report which one the caller must supply.
+static bool naturalSortOrder(SortItem* items, int count, SortOrder* order) {
+  bool numbers = true;
+  bool strings = true;
+  for (int i = 0; i < count && (numbers || strings); i++) {
+    if (!IS_NUMBER(items[i].key)) numbers = false;
+    if (!IS_STRING(items[i].key)) strings = false;
+  }
+  if (numbers) {
+    *order = SORT_NUMBERS;
+    return true;
+  }
+  if (strings) {
+    *order = SORT_STRINGS;
+    return true;
+  }
+  return false;
+}
+
+// Sort `result` (a fresh copy of the input, which also keeps every element
+// reachable) in place. With a keyFn, keys are computed once up front and
+// rooted in `keys`.
+static bool sortItems(Value* args, ObjArray* result, ObjArray* keys, Value keyFn,
+                      Value comparator, bool stable, const char* name) {
+  int count = result->array.count;
+  // volatile: both are freed on the longjmp path below
+  SortItem* volatile items = (SortItem*)malloc(sizeof(SortItem) * (size_t)(count > 0 ? count : 1));
+  SortItem* volatile scratch = stable && count > 16
+      ? (SortItem*)malloc(sizeof(SortItem) * (size_t)count)
+      : NULL;
+  if (items == NULL || (stable && count > 16 && scratch == NULL)) {
+    free(items);
+    free(scratch);
+    args[-1] = CSTRING_VAL("Error: out of memory.");
+    return false;
+  }
+  for (int i = 0; i < count; i++) {
+    items[i].key = result->array.values[i];
+    items[i].value = result->array.values[i];
+  }
+
+  // Calls back into lx run under a local handler: a raising comparator or
+  // keyFn unwinds to here and fails this native with the same message.
+  int baseFrameCount = vm.frameCount;
+  Value* baseStackTop = vm.stackTop;
+  bool guarded = !IS_NIL(keyFn) || !IS_NIL(comparator);
+  ScopedErrorHandler scoped;
+  if (guarded) {
+    pushErrorHandler(&scoped, vm.currentFiber);
+    if (setjmp(scoped.handler.buf) != 0) {
+      closeUpvalues(baseStackTop);
+      vm.stackTop = baseStackTop;
+      vm.frameCount = baseFrameCount;
+      vm.nonYieldableDepth--;
+      popErrorHandler(&scoped);
+      free(items);
+      free(scratch);
+      Value message = NIL_VAL;
+      if (IS_HASHMAP(vm.lastError)) {
+        tableGet(&AS_HASHMAP(vm.lastError), CSTRING_VAL("message"), &message);
+      }
+      args[-1] = IS_STRING(message) ? message : CSTRING_VAL("Error: sort callback failed.");
+      return false;
+    }
+    vm.nonYieldableDepth++;
+  }
+
+  if (!IS_NIL(keyFn)) {
+    for (int i = 0; i < count; i++) {
+      Value key = callFromNative(keyFn, 1, items[i].value, NIL_VAL);
+      push(key);
+      writeValueArray(&keys->array, key);
+      pop();
+      items[i].key = key;
+    }
+  }
+
+  SortContext ctx = {.order = SORT_COMPARATOR, .comparator = comparator};
+  bool ok = true;
+  if (IS_NIL(comparator)) {
+    ok = naturalSortOrder(items, count, &ctx.order);
+  } else if (IS_NATIVE(comparator) && AS_NATIVE(comparator)->function == stringLessNative &&
+             naturalSortOrder(items, count, &ctx.order) && ctx.order == SORT_STRINGS) {
+    // sort(xs, stringLess) is common enough to skip the native call per pair
+  } else {
+    ctx.order = SORT_COMPARATOR;
+  }
+
+  if (ok) {
+    if (stable) {
+      mergeSortItems(&ctx, items, scratch, count);
+    } else {
+      int depth = 0;
+      for (int n = count; n > 1; n >>= 1) depth += 2;
+      introSortItems(&ctx, items, 0, count, depth);
+    }
+    for (int i = 0; i < count; i++) {
+      result->array.values[i] = items[i].value;
+    }
+  }
+
+  if (guarded) {
+    vm.nonYieldableDepth--;
+    popErrorHandler(&scoped);
+  }
+  free(items);
+  free(scratch);
+
+  if (!ok) {
+    char message[128];
+    snprintf(message, sizeof(message),
+             "Error: %s without a comparator needs all numbers or all strings.", name);
+    args[-1] = CSTRING_VAL(message);
+    return false;
+  }
+  args[-1] = OBJ_VAL(result);
+  return true;
+}
+
+static bool sortArray(Value* args, Value keyFn, Value comparator,
+                      bool stable, const char* name) {
+  ObjArray* result = newArray();
+  push(OBJ_VAL(result));
+  ValueArray* input = &AS_ARRAY(args[0]);
+  for (int i = 0; i < input->count; i++) {
+    writeValueArray(&result->array, input->values[i]);
+  }
+  ObjArray* keys = newArray();
+  push(OBJ_VAL(keys));
+  bool ok = sortItems(args, result, keys, keyFn, comparator, stable, name);
+  pop();
+  pop();
+  return ok;
+}
+
+// sort(array, compare?) -> array
+// Returns a new sorted array; compare(a, b) is true when a goes first.
+// Without a comparator every element must be a number or every element a
+// string. Not stable; see stableSort.
+static bool sortNative(int argCount, Value* args) {
+  if (argCount < 1 || !IS_ARRAY(args[0])) {
+    args[-1] = CSTRING_VAL("Error: sort takes an array.");
+    return false;
+  }
+  Value comparator = argCount >= 2 ? args[1] : NIL_VAL;
+  return sortArray(args, NIL_VAL, comparator, false, "sort");
+}
+
+// stableSort(array, compare?) -> array
+// Like sort, but equal elements keep their original order.
+static bool stableSortNative(int argCount, Value* args) {
+  if (argCount < 1 || !IS_ARRAY(args[0])) {
+    args[-1] = CSTRING_VAL("Error: stableSort takes an array.");
+    return false;
+  }
+  Value comparator = argCount >= 2 ? args[1] : NIL_VAL;
+  return sortArray(args, NIL_VAL, comparator, true, "stableSort");
+}
+
+// sortBy(array, keyFn) -> array
+// Stable sort by keyFn(element); keys are computed once and must be all
+// numbers or all strings.
+static bool sortByNative(int argCount, Value* args) {
+  if (argCount < 2 || !IS_ARRAY(args[0])) {
+    args[-1] = CSTRING_VAL("Error: sortBy takes an array and a key function.");
+    return false;
+  }
+  return sortArray(args, args[1], NIL_VAL, true, "sortBy");
+}
+
+// Lx.fs.lines(handle, cb): calls cb(line) for each remaining line of a
+// buffered file handle, stopping early when cb returns false. Like the sort
+// callbacks, cb runs under a local handler and may not yield.
+static bool fsLinesNative(int argCount, Value* args) {
+  if (argCount < 2 || !IS_NUMBER(args[0]) ||
+      !(IS_CLOSURE(args[1]) || IS_NATIVE(args[1]))) {
+    args[-1] = CSTRING_VAL("Error: Lx.fs.lines takes a file handle and a function.");
+    return false;
+  }
+  int handle = (int)AS_NUMBER(args[0]);
+
+  int baseFrameCount = vm.frameCount;
+  Value* baseStackTop = vm.stackTop;
+  ScopedErrorHandler scoped;
+  pushErrorHandler(&scoped, vm.currentFiber);
+  if (setjmp(scoped.handler.buf) != 0) {
+    closeUpvalues(baseStackTop);
+    vm.stackTop = baseStackTop;
+    vm.frameCount = baseFrameCount;
+    vm.nonYieldableDepth--;
+    popErrorHandler(&scoped);
+    Value message = NIL_VAL;
+    if (IS_HASHMAP(vm.lastError)) {
+      tableGet(&AS_HASHMAP(vm.lastError), CSTRING_VAL("message"), &message);
+    }
+    args[-1] = IS_STRING(message) ? message : CSTRING_VAL("Error: Lx.fs.lines callback failed.");
+    return false;
+  }
+  vm.nonYieldableDepth++;
+
+  const char* error = NULL;
+  for (;;) {
+    Value line;
+    if (!fileReadLine(handle, &line, &error) || IS_NIL(line)) break;
+    Value keepGoing = callFromNative(args[1], 1, line, NIL_VAL);
+    if (IS_BOOL(keepGoing) && !AS_BOOL(keepGoing)) break;
+  }
+
+  vm.nonYieldableDepth--;
+  popErrorHandler(&scoped);
+  if (error != NULL) {
+    args[-1] = CSTRING_VAL(error);
+    return false;
+  }
+  args[-1] = NIL_VAL;
+  return true;
+}
+
+// Lx.re.replace(pattern, s, replacement): every match of pattern in s
+// replaced. A replacement string expands $1, ${name} and friends; a
+// function is called with each match map and its result stringified. Like
+// the sort callbacks, the function runs under a local handler and may not
+// yield.
+static bool reReplaceNative(int argCount, Value* args) {
+  const char* usage = "Error: Lx.re.replace takes a pattern, a string and a replacement string or function.";
+  if (argCount < 3 || !IS_STRING(args[1]) ||
+      !(IS_STRING(args[2]) || IS_CLOSURE(args[2]) || IS_NATIVE(args[2]))) {
+    args[-1] = CSTRING_VAL(usage);
+    return false;
+  }
+  Regex* re = regexArg(args[0], &args[-1], usage);
+  if (re == NULL) return false;
+  ObjString* subject = AS_STRING(args[1]);
+  int slotCount = (regexGroupCount(re) + 1) * 2;
+
+  // Heap-allocated so the handler below can free what was written so far
+  RegexBuffer* out = calloc(1, sizeof(RegexBuffer));
+  if (out == NULL) {
+    args[-1] = CSTRING_VAL("Error: out of memory.");
+    return false;
+  }
+
+  int baseFrameCount = vm.frameCount;
+  Value* baseStackTop = vm.stackTop;
+  ScopedErrorHandler scoped;
+  bool callback = !IS_STRING(args[2]);
+  if (callback) {
+    pushErrorHandler(&scoped, vm.currentFiber);
+    if (setjmp(scoped.handler.buf) != 0) {
+      closeUpvalues(baseStackTop);
+      vm.stackTop = baseStackTop;
+      vm.frameCount = baseFrameCount;
+      vm.nonYieldableDepth--;
+      popErrorHandler(&scoped);
+      free(out->data);
+      free(out);
+      Value message = NIL_VAL;
+      if (IS_HASHMAP(vm.lastError)) {
+        tableGet(&AS_HASHMAP(vm.lastError), CSTRING_VAL("message"), &message);
+      }
+      args[-1] = IS_STRING(message) ? message : CSTRING_VAL("Error: Lx.re.replace callback failed.");
+      return false;
+    }
+    vm.nonYieldableDepth++;
+  }
+
+  size_t slots[slotCount];
+  size_t from = 0, lastEnd = REGEX_UNSET, copied = 0;
+  while (regexNext(re, subject, &from, &lastEnd, slots)) {
+    regexAppend(out, subject->chars + copied, slots[0] - copied);
+    copied = slots[1];
+    if (!callback) {
+      regexExpand(re, AS_STRING(args[2])->chars, (size_t)AS_STRING(args[2])->length,
+                  subject->chars, slots, out);
+      continue;
+    }
+
+    Value replacement = callFromNative(args[2], 1, regexMatchValue(re, subject, slots), NIL_VAL);
+    if (IS_STRING(replacement)) {
+      regexAppend(out, AS_STRING(replacement)->chars,
+                  (size_t)AS_STRING(replacement)->length);
+    } else {
+      char* chars = NULL;
+      int length = valueToString(replacement, &chars);
+      regexAppend(out, chars, length < 0 ? 0 : (size_t)length);
+      free(chars);
+    }
+    // The callback may have compiled enough other patterns to evict ours
+    re = regexArg(args[0], &args[-1], usage);
+  }
+  if (callback) {
+    vm.nonYieldableDepth--;
+    popErrorHandler(&scoped);
+  }
+
+  regexAppend(out, subject->chars + copied,
+              (size_t)subject->length - copied);
+  args[-1] = OBJ_VAL(copyString(out->data != NULL ? out->data : "", (int)out->length));
+  free(out->data);
+  free(out);
+  return true;
+}
+
 inline static void concatenate() {
   ObjString* b = AS_STRING(peek(0));
   ObjString* a = AS_STRING(peek(1));
@@ -1213,10 +1792,145 @@ inline static void concatenate() {
   push(OBJ_VAL(result));
 }
 
+// for-in iteration protocol (OP_ITER_*).
+// The cursor is a fixnum counting up from -1 towards the limit that
+// OP_ITER_INIT snapshots when the loop starts. Hashmaps are walked over raw
+// slots in keys() order (array part high to low, then hash entries high to
+// low). A write that moves keys to other slots (a resize or rehash, usually
+// from adding keys) would make the walk skip or repeat keys, so a hashmap
+// limit also carries the low bits of Table.layout and each step raises once
+// it no longer matches. Updating and deleting keys never move slots.
+#define ITER_SLOT_BITS 32
+#define ITER_SLOT_MASK ((INT64_C(1) << ITER_SLOT_BITS) - 1)
+#define ITER_LAYOUT_MASK ((UINT32_C(1) << (FIXNUM_BITS - 1 - ITER_SLOT_BITS)) - 1)
+
+static inline int64_t hashmapIterLimit(Table* table) {
+  int64_t slots = (int64_t)table->arrayCapacity + table->capacity;
+  return ((int64_t)(table->layout & ITER_LAYOUT_MASK) << ITER_SLOT_BITS) | slots;
+}
+
+// Checks a hashmap loop's snapshotted limit against the table and strips it
+// down to the slot count; false (error reported) when keys have moved
+static inline bool hashmapIterSlots(Table* table, int64_t* limit) {
+  if (*limit != hashmapIterLimit(table)) {
+    runtimeError("Map modified during iteration.");
+    return false;
+  }
+  *limit &= ITER_SLOT_MASK;
+  return true;
+}
+
+static bool iterLimit(Value iterable, Value* out) {
+  if (IS_ARRAY(iterable)) {
+    *out = FIXNUM_VAL(AS_ARRAY(iterable).count);
+  } else if (IS_HASHMAP(iterable)) {
+    *out = FIXNUM_VAL(hashmapIterLimit(&AS_HASHMAP(iterable)));
+  } else if (IS_STRING(iterable)) {
+    *out = FIXNUM_VAL(AS_STRING(iterable)->length);
+  } else if (IS_ENUM(iterable)) {
+    *out = FIXNUM_VAL(AS_ENUM(iterable)->names.count);
+  } else if (IS_TYPED_ARRAY(iterable)) {
+    *out = FIXNUM_VAL(AS_TYPED_ARRAY(iterable)->count);
+  } else {
+    runtimeError("Can only iterate over array, typed array, hashmap, enum or string.");
+    return false;
+  }
+  return true;
+}
+
+static inline bool iterHashmapKey(Table* table, int64_t cursor, Value* key) {
+  int64_t arrayCapacity = table->arrayCapacity;
+  if (cursor < arrayCapacity) {
+    int64_t index = arrayCapacity - 1 - cursor;
+    if (table->arrayPresent == NULL || !table->arrayPresent[index]) return false;
+    *key = NUMBER_VAL((double)index);
+    return true;
+  }
+  int64_t index = (int64_t)table->capacity - 1 - (cursor - arrayCapacity);
+  if (index < 0) return false;
+  Entry* entry = &table->entries[index];
+  if (IS_NIL(entry->key)) return false;
+  *key = entry->key;
+  return true;
+}
+
+static inline Value iterValue(Value iterable, int64_t cursor) {
+  if (IS_ARRAY(iterable)) {
+    ValueArray* array = &AS_ARRAY(iterable);
+    if (cursor >= 0 && cursor < array->count) return array->values[cursor];
+  } else if (IS_HASHMAP(iterable)) {
+    Value key;
+    if (cursor >= 0 && iterHashmapKey(&AS_HASHMAP(iterable), cursor, &key)) return key;
+  } else if (IS_STRING(iterable)) {
+    ObjString* s = AS_STRING(iterable);
+    if (cursor >= 0 && cursor < (int64_t)s->length) {
+      return OBJ_VAL(copyString(&s->chars[cursor], 1));
+    }
+  } else if (IS_ENUM(iterable)) {
+    ValueArray* names = &AS_ENUM(iterable)->names;
+    if (cursor >= 0 && cursor < names->count) return names->values[cursor];
+  } else if (IS_TYPED_ARRAY(iterable)) {
+    ObjTypedArray* array = AS_TYPED_ARRAY(iterable);
+    if (cursor >= 0 && cursor < array->count) return typedArrayGet(array, (int)cursor);
+  }
+  return NIL_VAL;
+}
+
+// Fused ITER_NEXT + ITER_VALUE for OP_FOREACH_*. Advances the cursor in
+// place; returns 1 and stores the element when one remains, 0 when the loop
+// is exhausted and -1 on corrupted state or moved map keys (error reported).
+static inline int foreachStep(Value* cursorSlot, Value object, Value limit, Value* element) {
+  if (!IS_FIXNUM(*cursorSlot) || !IS_FIXNUM(limit)) {
+    runtimeError("Iterator state corrupted.");
+    return -1;
+  }
+  int64_t next = AS_FIXNUM(*cursorSlot) + 1;
+  int64_t limit_int = AS_FIXNUM(limit);
+
+  if (IS_ARRAY(object)) {
+    // Array fast path: bounds-checked element load
+    *cursorSlot = FIXNUM_VAL(next);
+    if (next >= limit_int) return 0;
+    ValueArray* array = &AS_ARRAY(object);
+    *element = next < array->count ? array->values[next] : NIL_VAL;
+    return 1;
+  }
+
+  if (IS_HASHMAP(object)) {
+    Table* table = &AS_HASHMAP(object);
+    if (!hashmapIterSlots(table, &limit_int)) return -1;
+    Value key;
+    while (next < limit_int && !iterHashmapKey(table, next, &key)) next++;
+    *cursorSlot = FIXNUM_VAL(next);
+    if (next >= limit_int) return 0;
+    *element = key;
+    return 1;
+  }
+
+  *cursorSlot = FIXNUM_VAL(next);
+  if (next >= limit_int) return 0;
+  *element = iterValue(object, next);
+  return 1;
+}
+
 // Helper: Get value by index (shared logic for all get-by-index operations)
 // Returns true on success, false on error (error message already set)
 static bool getByIndexImpl(Value object, Value key, Value* out) {
   if (!IS_ENUM(object) && !IS_HASHMAP(object) && !IS_ARRAY(object) && !IS_STRING(object)) {
+    if (IS_TYPED_ARRAY(object)) {
+      if (!IS_NUMBER(key)) {
+        runtimeError("Can only use number index to access array.");
+        return false;
+      }
+      int index = (int)AS_NUMBER(key);
+      if ((double)index != AS_NUMBER(key)) {
+        runtimeError("Can only use integer index to access array.");
+        return false;
+      }
+      ObjTypedArray* array = AS_TYPED_ARRAY(object);
+      *out = (index >= 0 && index < array->count) ? typedArrayGet(array, index) : NIL_VAL;
+      return true;
+    }
     runtimeError("Only array / hashmap / string can get value by index.");
     return false;
   }
@@ -1285,6 +1999,29 @@ static bool setByIndexImpl(Value object, Value key, Value value, Value* out) {
     return false;
   }
   if (!IS_HASHMAP(object) && !IS_ARRAY(object)) {
+    if (IS_TYPED_ARRAY(object)) {
+      if (!IS_NUMBER(key)) {
+        runtimeError("Can only use number index to access array.");
+        return false;
+      }
+      int index = (int)AS_NUMBER(key);
+      if ((double)index != AS_NUMBER(key)) {
+        runtimeError("Can only use integer index to access array.");
+        return false;
+      }
+      if (!IS_NUMBER(value)) {
+        runtimeError("Typed array element must be a number.");
+        return false;
+      }
+      ObjTypedArray* array = AS_TYPED_ARRAY(object);
+      if (index >= 0 && index < array->count) {
+        typedArraySet(array, index, value);
+        *out = value;
+      } else {
+        *out = NIL_VAL;
+      }
+      return true;
+    }
     runtimeError("Only array or hashmap can set value by index.");
     return false;
   }
@@ -1817,6 +2554,38 @@ static InterpretResult runUntil(int stopFrameCount) {
         break;
       }
 
+      case OP_CONCAT_N: {
+        // A string-building `+` chain, allocated once. The compiler only
+        // emits it for chains that can't be numeric addition, so a
+        // non-string operand fails as OP_ADD would.
+        int count = READ_BYTE();
+        Value* parts = vm.stackTop - count;
+        size_t length = 0;
+        for (int i = 0; i < count; i++) {
+          if (!IS_STRING(parts[i])) {
+            runtimeError("Operands must be two numbers or two strings.");
+            return INTERPRET_RUNTIME_ERROR;
+          }
+          length += (size_t)AS_STRING(parts[i])->length;
+        }
+        if (length > (size_t)INT_MAX) {
+          runtimeError("String too long.");
+          return INTERPRET_RUNTIME_ERROR;
+        }
+        char* chars = ALLOCATE(char, length + 1);
+        char* at = chars;
+        for (int i = 0; i < count; i++) {
+          ObjString* part = AS_STRING(parts[i]);
+          memcpy(at, part->chars, (size_t)part->length);
+          at += part->length;
+        }
+        *at = '\0';
+        ObjString* result = takeString(chars, (int)length);
+        vm.stackTop -= count;
+        push(OBJ_VAL(result));
+        break;
+      }
+
       case OP_BIT_AND:
         BIT_BINARY_OP(&, "&");
         break;
@@ -1905,6 +2674,8 @@ static InterpretResult runUntil(int stopFrameCount) {
           push(NUMBER_VAL(AS_STRING(pop())->length));
         } else if (IS_ARRAY(peek(0))) {
           push(NUMBER_VAL(AS_ARRAY(pop()).count));
+        } else if (IS_TYPED_ARRAY(peek(0))) {
+          push(NUMBER_VAL(AS_TYPED_ARRAY(pop())->count));
         } else {
           runtimeError("Operand must be string or array.");
           return INTERPRET_RUNTIME_ERROR;
@@ -2040,6 +2811,32 @@ static InterpretResult runUntil(int stopFrameCount) {
         break;
       }
 
+      case OP_IMPORT: {
+        // Modules of the embedded objs run once; later imports reuse the
+        // cached value and skip the OP_CALL 0 + OP_IMPORT_STORE that follow.
+        // Other modules are never cached, so each import runs the body.
+        uint16_t index = READ_SHORT();
+        ObjFunction* function = AS_FUNCTION(frame->closure->function->chunk.constants.values[index]);
+        if (function->moduleLoaded) {
+          push(function->moduleValue);
+          frame->ip += 5;
+          break;
+        }
+        ObjClosure* newClosureObj = newClosure(function);
+        push(OBJ_VAL(newClosureObj));
+        break;
+      }
+
+      case OP_IMPORT_STORE: {
+        uint16_t index = READ_SHORT();
+        ObjFunction* function = AS_FUNCTION(frame->closure->function->chunk.constants.values[index]);
+        if (function->sharedModule) {
+          function->moduleValue = peek(0);
+          function->moduleLoaded = true;
+        }
+        break;
+      }
+
       case OP_CLOSE_UPVALUE:
         closeUpvalues(vm.stackTop - 1);
         pop();
@@ -2113,6 +2910,13 @@ static InterpretResult runUntil(int stopFrameCount) {
 
         Value object = slots[arrSlot];
         Value key = slots[idxSlot];
+        if (IS_TYPED_ARRAY(object) && IS_FIXNUM(key)) {
+          // Unboxed fast path
+          ObjTypedArray* array = AS_TYPED_ARRAY(object);
+          int64_t index = AS_FIXNUM(key);
+          push(index >= 0 && index < array->count ? typedArrayGet(array, (int)index) : NIL_VAL);
+          break;
+        }
         Value result;
         if (!getByIndexImpl(object, key, &result)) return INTERPRET_RUNTIME_ERROR;
         push(result);
@@ -2128,6 +2932,13 @@ static InterpretResult runUntil(int stopFrameCount) {
         Value object = slots[arrSlot];
         Value key = slots[idxSlot];
         Value value = slots[valSlot];
+        if (IS_TYPED_ARRAY(object) && IS_FIXNUM(key) && IS_NUMBER(value)) {
+          // Unboxed fast path
+          ObjTypedArray* array = AS_TYPED_ARRAY(object);
+          int64_t index = AS_FIXNUM(key);
+          if (index >= 0 && index < array->count) typedArraySet(array, (int)index, value);
+          break;
+        }
         Value result;
         if (!setByIndexImpl(object, key, value, &result)) return INTERPRET_RUNTIME_ERROR;
         break;
@@ -2760,6 +3571,98 @@ static InterpretResult runUntil(int stopFrameCount) {
         break;
       }
 
+      case OP_ITER_INIT: {
+        // Validate iterable and replace it with the loop limit
+        Value limit;
+        if (!iterLimit(peek(0), &limit)) return INTERPRET_RUNTIME_ERROR;
+        vm.stackTop[-1] = limit;
+        break;
+      }
+
+      case OP_ITER_NEXT: {
+        // Operands: obj_slot(u8) cursor_slot(u8) limit_slot(u8) offset(u16)
+        uint8_t obj_slot = READ_BYTE();
+        uint8_t cursor_slot = READ_BYTE();
+        uint8_t limit_slot = READ_BYTE();
+        uint16_t offset = READ_SHORT();
+
+        Value cursor = slots[cursor_slot];
+        Value limit = slots[limit_slot];
+        if (!IS_FIXNUM(cursor) || !IS_FIXNUM(limit)) {
+          runtimeError("Iterator state corrupted.");
+          return INTERPRET_RUNTIME_ERROR;
+        }
+
+        int64_t next = AS_FIXNUM(cursor) + 1;
+        int64_t limit_int = AS_FIXNUM(limit);
+        Value object = slots[obj_slot];
+        if (IS_HASHMAP(object)) {
+          // Skip empty slots and tombstones
+          Table* table = &AS_HASHMAP(object);
+          if (!hashmapIterSlots(table, &limit_int)) return INTERPRET_RUNTIME_ERROR;
+          Value key;
+          while (next < limit_int && !iterHashmapKey(table, next, &key)) next++;
+        }
+        slots[cursor_slot] = FIXNUM_VAL(next);
+
+        if (next < limit_int) {
+          // Jump backward to loop body
+          frame->ip -= offset;
+        }
+        break;
+      }
+
+      case OP_ITER_VALUE: {
+        // Operands: obj_slot(u8) cursor_slot(u8)
+        uint8_t obj_slot = READ_BYTE();
+        uint8_t cursor_slot = READ_BYTE();
+        Value cursor = slots[cursor_slot];
+        if (!IS_FIXNUM(cursor)) {
+          runtimeError("Iterator state corrupted.");
+          return INTERPRET_RUNTIME_ERROR;
+        }
+        push(iterValue(slots[obj_slot], AS_FIXNUM(cursor)));
+        break;
+      }
+
+      case OP_FOREACH_PREP: {
+        // Operands: obj_slot(u8) cursor_slot(u8) limit_slot(u8) offset(u16)
+        uint8_t obj_slot = READ_BYTE();
+        uint8_t cursor_slot = READ_BYTE();
+        uint8_t limit_slot = READ_BYTE();
+        uint16_t offset = READ_SHORT();
+
+        Value element;
+        int status = foreachStep(&slots[cursor_slot], slots[obj_slot], slots[limit_slot], &element);
+        if (status < 0) return INTERPRET_RUNTIME_ERROR;
+        if (status == 0) {
+          // Empty: skip loop body
+          frame->ip += offset;
+        } else {
+          // Element becomes the body's first local
+          push(element);
+        }
+        break;
+      }
+
+      case OP_FOREACH_NEXT: {
+        // Operands: obj_slot(u8) cursor_slot(u8) limit_slot(u8) offset(u16)
+        uint8_t obj_slot = READ_BYTE();
+        uint8_t cursor_slot = READ_BYTE();
+        uint8_t limit_slot = READ_BYTE();
+        uint16_t offset = READ_SHORT();
+
+        Value element;
+        int status = foreachStep(&slots[cursor_slot], slots[obj_slot], slots[limit_slot], &element);
+        if (status < 0) return INTERPRET_RUNTIME_ERROR;
+        if (status > 0) {
+          // Jump backward to loop body with the element pushed
+          push(element);
+          frame->ip -= offset;
+        }
+        break;
+      }
+
       case OP_YIELD: {
         uint8_t yieldCount = READ_BYTE();
 
@@ -2845,7 +3748,7 @@ static InterpretResult runUntil(int stopFrameCount) {
 }
 
 InterpretResult interpret(uint8_t* obj) {
-  ObjFunction* function = loadObj(obj, false);
+  ObjFunction* function = loadObjSharingModules(obj);
   if (function == NULL) return INTERPRET_COMPILE_ERROR;
 
   push(OBJ_VAL(function));